@@ -0,0 +1,35 @@
+// ahead-of-time translator, see aot_translate() in AS32_aot.h
+//	AS32_aot in.as32 out.cpp
+//	reads an image written by asc::image_t::save and writes the C++ translation unit of its verified functions,
+//	compile it into the program and call asc::aot_install(elf) after loading and linking the same image
+#include <cstdio>
+#include "AS32_aot.h"
+#include "AS32_image.h"
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		std::printf("usage: %s in.as32 out.cpp\n", argv[0]);
+		return 2;
+	}
+	asc::image_t image;
+	asc::elf_t elf;
+	if (image.open(argv[1]) == false || image.load(elf) == false)
+	{
+		std::printf("%s: not a valid image\n", argv[1]);
+		return 1;
+	}
+	std::string out;
+	if (asc::aot_translate(elf, out) == false)
+		std::printf("%s: no function could be translated\n", argv[1]);
+	FILE* file = std::fopen(argv[2], "wb");
+	if (file == nullptr)
+	{
+		std::printf("%s: cannot write\n", argv[2]);
+		return 1;
+	}
+	bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+	ok = std::fclose(file) == 0 && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,530 @@
+#pragma once
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>     // AS32_extlib.h
+#include <cstring>
+#include <string>
+#include "AssemblyScript32.h"
+
+namespace asc {
+    // ahead-of-time translation
+    // aot_translate(elf, out) verifies an elf and writes a C++ translation unit with one native_t per verified
+    // function: the instructions of its threaded code become straight C++ with every IMM operand a constant
+    // (both operands IMM: the result itself), local IMM CALLs call the translated callee directly, import CALLs
+    // go through the bound import, IMM CALLEXTs call the extlib entry directly while the elf has no exttable_t.
+    // the same rules as the JIT keep the results equal to the interpreter: a dynamic jump target, a write into
+    // the own instructions or a CALL that re-entered or modified the function continue in func_t::run_switch(),
+    // a function called by itself runs its threaded code, heap functions are not translated. the unit needs only
+    // this header, so it builds for targets without a JIT. compiled into a program it registers itself;
+    // aot_install(elf) then sets func_t::native of every function of a loaded elf whose code is the one
+    // translated (aot_print) and returns how many. AS32_aot.cpp is the command line tool, image in, source out.
+    struct aot_regs_t
+    {
+        uint8_t *mem;
+        uint8_t *cmem;      // caller assembly
+        uint8_t *data;
+        uint32_t size;
+        uint32_t cesp;
+        uint32_t csize;
+    };
+    // -1: continue in translated code, otherwise the result of the interpreter run in its place
+    inline int aot_enter(func_t *f, elf_t *elf, func_t *caller, aot_regs_t &r)
+    {
+        if (f->native == nullptr || f->verified != elf || f->stale || f->tracking(caller) || AS32_INSTRUMENTED())
+            return f->operator()(elf, caller);
+        r.cesp = caller != nullptr ? caller->ESP : 0; // before the reset, caller may be f
+        f->ESP = 0;
+        f->EIP = f->EIP_Begin;
+        f->elf_local = elf;
+        f->caller = caller;
+        f->fault = fault_t::NONE;
+        if (caller == f) // called itself: EBP_IA follows the ESP the translation keeps in a local, run threaded
+            return f->run_decoded<true>() == state_t::RET || f->fail();
+        r.mem = f->assembly.data();
+        r.size = static_cast<uint32_t>(f->assembly.size());
+        r.data = elf->data.data();
+        r.cmem = caller != nullptr ? caller->assembly.data() : nullptr;
+        r.csize = caller != nullptr ? static_cast<uint32_t>(caller->assembly.size()) : 0;
+        return -1;
+    }
+    inline int32_t aot_ld(const uint8_t *p)
+    {
+        int32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    inline void aot_st(uint8_t *p, int32_t v)
+    {
+        std::memcpy(p, &v, sizeof(v));
+    }
+    inline bool aot_fault(func_t *f, uint32_t esp, uint32_t eip)
+    {
+        f->ESP = esp;
+        f->EIP = eip;
+        if (compact_reach(*f)) // the caller's instructions are in its assembly now, run the faulted one again
+            return f->run_switch();
+        return f->fail();
+    }
+    inline bool aot_resume(func_t *f, uint32_t esp, uint32_t eip, bool stale) // continue interpreted at eip
+    {
+        if (stale)
+            f->stale = true;
+        f->ESP = esp;
+        f->EIP = eip;
+        return f->run_switch();
+    }
+    inline bool aot_resume_call(func_t *f) // after a CALL/CALLEXT that re-entered or modified f
+    {
+        f->EIP += 2 * sizeof(uint32_t);
+        return f->run_switch();
+    }
+    inline bool aot_call_dynamic(func_t *self, int32_t ind)
+    {
+        func_t *callable;
+        elf_t *elf_callee = self->elf_local;
+        if (self->callable_addressing(oprand_t::IMM, ind, callable, elf_callee) == false)
+            return false;
+        return callable->operator()(elf_callee, self);
+    }
+    inline bool aot_call_import(const elf_t::import_t &impo, func_t *self, int32_t ind)
+    {
+        func_t *bound = impo.bound();
+        if (bound != nullptr)
+            return bound->operator()(impo.target(), self);
+        return aot_call_dynamic(self, ind);
+    }
+    inline bool aot_callext(func_t *self, int32_t ind)
+    {
+        extfunc_t ext = ext_find(self->elf_local, ind);
+        return ext != nullptr && ext(self);
+    }
+
+    // what a translation depends on: names, section sizes, tables and the instructions of every function
+    inline uint64_t aot_print(const elf_t &elf)
+    {
+        uint64_t h = 0xCBF29CE484222325;
+        auto mix = [&h](const void *p, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                h = (h ^ static_cast<const uint8_t *>(p)[i]) * 0x100000001B3;
+        };
+        auto word = [&mix](uint64_t v) { mix(&v, sizeof(v)); };
+        size_t len = 0;
+        while (len < namelen && elf.name[len] != 0)
+            len++;
+        mix(elf.name, len);
+        word(elf.data.size());
+        word(elf.imports.size());
+        word(elf.text.size());
+        for (auto &f : elf.text)
+        {
+            const func_t &c = f.code();
+            word(f.EIP_Begin);
+            word(f.assembly.size());
+            word(c.code_lo);
+            word(c.code_len);
+            if (c.code_len != 0 && c.code_lo + c.code_len <= f.assembly.size())
+                mix(&f.assembly[c.code_lo], c.code_len);
+            mix(c.compact.bytes(), c.compact.size()); // compact code, see compact_load()
+        }
+        return h;
+    }
+    struct aot_module_t
+    {
+        const char *name;
+        uint64_t print;
+        size_t count;
+        const native_t *funcs;  // per text index, nullptr: interpreted
+    };
+    inline std::vector<const aot_module_t *> &aot_modules()
+    {
+        static std::vector<const aot_module_t *> modules;
+        return modules;
+    }
+    inline bool aot_register(const aot_module_t *module)
+    {
+        aot_modules().push_back(module);
+        return true;
+    }
+    inline size_t aot_install(elf_t &elf)
+    {
+        elf.verify();
+        uint64_t print = aot_print(elf);
+        for (auto m : aot_modules())
+        {
+            if (m->print != print || m->count != elf.text.size())
+                continue;
+            size_t n = 0;
+            for (size_t i = 0; i < m->count; i++)
+                if (m->funcs[i] != nullptr && elf.text[i].verified == &elf)
+                {
+                    elf.text[i].native = m->funcs[i];
+                    n++;
+                }
+            return n;
+        }
+        return 0;
+    }
+
+    struct aot_writer_t
+    {
+        elf_t *elf;
+        func_t *f;
+        std::vector<bool> translated;   // per text index
+        std::string out;
+        std::vector<bool> targets;      // per decoded index, jumped to
+
+        inline void line(const char *fmt, ...)
+        {
+            char buf[512];
+            va_list args;
+            va_start(args, fmt);
+            std::vsnprintf(buf, sizeof(buf), fmt, args);
+            va_end(args);
+            out += "    ";
+            out += buf;
+            out += '\n';
+        }
+        static inline std::string lit(int32_t v) // INT32_MIN is no literal
+        {
+            return v == INT32_MIN ? "(-2147483647 - 1)" : std::to_string(v);
+        }
+        inline void fault(uint32_t eip, const char *cond)
+        {
+            line("if (%s) return asc::aot_fault(self, esp, %u);", cond, eip);
+        }
+        // operand value into var
+        inline void read(const char *var, oprand_t opt, int32_t op, uint32_t eip)
+        {
+            switch (opt)
+            {
+            case oprand_t::IMM:
+                line("%s = %s;", var, lit(op).c_str());
+                break;
+            case oprand_t::ESP:
+                line("%s = static_cast<int32_t>(esp + %uu);", var, static_cast<uint32_t>(op));
+                break;
+            case oprand_t::IA: // verified in bounds
+                line("%s = asc::aot_ld(r.mem + %u);", var, static_cast<uint32_t>(op));
+                break;
+            case oprand_t::ESP_IA:
+                line("o = esp + %uu;", static_cast<uint32_t>(op));
+                fault(eip, "o >= r.size");
+                line("%s = asc::aot_ld(r.mem + o);", var);
+                break;
+            case oprand_t::EBP_IA:
+                line("o = r.cesp + %uu;", static_cast<uint32_t>(op));
+                fault(eip, "o >= r.csize");
+                line("%s = asc::aot_ld(r.cmem + o);", var);
+                break;
+            case oprand_t::DATA_IA:
+                line("%s = asc::aot_ld(r.data + %u);", var, static_cast<uint32_t>(op));
+                break;
+            default:
+                fault(eip, "true");
+                break;
+            }
+        }
+        // address of a written operand into ptr, the offset of ESP/EBP relative ones into off
+        inline void address(const char *ptr, const char *off, oprand_t opt, int32_t op, uint32_t eip)
+        {
+            switch (opt)
+            {
+            case oprand_t::IA:
+                line("%s = r.mem + %u;", ptr, static_cast<uint32_t>(op));
+                break;
+            case oprand_t::ESP_IA:
+                line("%s = esp + %uu;", off, static_cast<uint32_t>(op));
+                line("if (%s >= r.size) return asc::aot_fault(self, esp, %u);", off, eip);
+                line("%s = r.mem + %s;", ptr, off);
+                break;
+            case oprand_t::EBP_IA:
+                line("%s = r.cesp + %uu;", off, static_cast<uint32_t>(op));
+                line("if (%s >= r.csize) return asc::aot_fault(self, esp, %u);", off, eip);
+                line("%s = r.cmem + %s;", ptr, off);
+                break;
+            case oprand_t::DATA_IA:
+                line("%s = r.data + %u;", ptr, static_cast<uint32_t>(op));
+                break;
+            default:
+                fault(eip, "true");
+                break;
+            }
+        }
+        // func_t::touch of a finished write, own instructions hit: stale, continue interpreted
+        inline void touch(const char *off, oprand_t opt, int32_t op, uint32_t next)
+        {
+            switch (opt)
+            {
+            case oprand_t::IA:
+                if (static_cast<uint32_t>(op) - f->code_lo < f->code_len)
+                    line("return asc::aot_resume(self, esp, %u, true);", next);
+                break;
+            case oprand_t::ESP_IA:
+                line("if (%s - %uu < %uu) return asc::aot_resume(self, esp, %u, true);", off, f->code_lo, f->code_len, next);
+                break;
+            case oprand_t::EBP_IA:
+                line("if (%s - caller->code_lo < caller->code_len) caller->stale = true;", off);
+                break;
+            default:
+                break;
+            }
+        }
+        inline void touch_esp(int32_t adjust, uint32_t next)
+        {
+            line("if (esp + %uu - %uu < %uu) return asc::aot_resume(self, esp, %u, true);", static_cast<uint32_t>(adjust),
+                f->code_lo, f->code_len, next);
+        }
+        inline void after_call(uint32_t eip, bool reload_esp)
+        {
+            line("if (self->EIP != %u || self->stale) return asc::aot_resume_call(self);", eip);
+            if (reload_esp)
+                line("esp = self->ESP;");
+            line("if (caller != nullptr) r.cesp = caller->ESP;");
+        }
+        inline void jump(const char *cond, int32_t target) // IMM target, decoded index + 1
+        {
+            line("if (%s) goto L%d;", cond, target - 1);
+        }
+        inline void jump_dynamic(const char *cond) // target in a, not proven: continue interpreted
+        {
+            line("if (%s) return asc::aot_resume(self, esp, static_cast<uint32_t>(a), false);", cond);
+        }
+
+        inline void insn(const insn_t &in)
+        {
+            uint32_t next = in.eip + (in.kind == insn_t::MOV || in.kind == insn_t::XCHG || (in.kind >= insn_t::ADD && in.kind <= insn_t::CMPGE) ? 12 : 8);
+            switch (in.kind)
+            {
+            case insn_t::MOV:
+                address("p", "o2", in.oprandT1, in.op1, in.eip);
+                read("a", in.oprandT2, in.op2, in.eip);
+                line("asc::aot_st(p, a);");
+                touch("o2", in.oprandT1, in.op1, next);
+                break;
+            case insn_t::MOVE:
+                read("a", in.oprandT2, in.op1, in.eip);
+                line("esp = static_cast<uint32_t>(a);");
+                break;
+            case insn_t::XCHG:
+                address("p", "o2", in.oprandT1, in.op1, in.eip);
+                address("q", "o3", in.oprandT2, in.op2, in.eip);
+                line("a = asc::aot_ld(p);");
+                line("asc::aot_st(p, asc::aot_ld(q));");
+                line("asc::aot_st(q, a);");
+                touch("o2", in.oprandT1, in.op1, next);
+                touch("o3", in.oprandT2, in.op2, next);
+                break;
+            case insn_t::INC:
+            case insn_t::DEC:
+            case insn_t::NEG:
+                address("p", "o2", in.oprandT1, in.op1, in.eip);
+                line(in.kind == insn_t::INC ? "asc::aot_st(p, static_cast<int32_t>(static_cast<uint32_t>(asc::aot_ld(p)) + 1u));" :
+                     in.kind == insn_t::DEC ? "asc::aot_st(p, static_cast<int32_t>(static_cast<uint32_t>(asc::aot_ld(p)) - 1u));" :
+                                              "asc::aot_st(p, static_cast<int32_t>(0u - static_cast<uint32_t>(asc::aot_ld(p))));");
+                touch("o2", in.oprandT1, in.op1, next);
+                break;
+            case insn_t::ADD: case insn_t::SUB: case insn_t::MUL: case insn_t::DIV:
+            case insn_t::AND: case insn_t::OR: case insn_t::XOR: case insn_t::SHL:
+            case insn_t::CMP: case insn_t::CMPG: case insn_t::CMPGE:
+            {
+                static const char *const names[] = { "ADD", "SUB", "MUL", "DIV", "AND", "OR", "XOR", "SHL", "CMP", "CMPG", "CMPGE" };
+                fault(in.eip, "esp >= r.size"); // no operand faults after it, it may go first
+                if (in.oprandT1 == oprand_t::IMM && in.oprandT2 == oprand_t::IMM) // folded
+                {
+                    int32_t v = 0;
+                    if (in.kind == insn_t::DIV && in.op2 == 0)
+                        fault(in.eip, "true");
+                    else if (in.kind != insn_t::SHL || in.op2 != 0) // SHL 0 leaves [ESP] alone
+                    {
+                        fold(in.kind, in.op1, in.op2, v);
+                        line("asc::aot_st(r.mem + esp, %s);", lit(v).c_str());
+                    }
+                }
+                else
+                {
+                    read("a", in.oprandT1, in.op1, in.eip);
+                    read("b", in.oprandT2, in.op2, in.eip);
+                    line("v = asc::aot_ld(r.mem + esp);");
+                    fault(in.eip, (std::string("!asc::binary_op<asc::opcode_t::") + names[in.kind - insn_t::ADD] + ">(a, b, &v)").c_str());
+                    line("asc::aot_st(r.mem + esp, v);");
+                }
+                touch_esp(0, next);
+                break;
+            }
+            case insn_t::NOT:
+                read("a", in.oprandT1, in.op1, in.eip);
+                fault(in.eip, "esp >= r.size");
+                line("asc::aot_st(r.mem + esp, ~a);");
+                touch_esp(0, next);
+                break;
+            case insn_t::PUSH:
+                read("a", in.oprandT1, in.op1, in.eip);
+                fault(in.eip, "esp >= r.size");
+                line("asc::aot_st(r.mem + esp, a);");
+                line("esp += 4;");
+                touch_esp(-4, next);
+                break;
+            case insn_t::POP:
+                fault(in.eip, "esp < 4");
+                line("esp -= 4;");
+                break;
+            case insn_t::JMP:
+                if (in.oprandT1 == oprand_t::IMM)
+                    jump("true", in.op2);
+                else
+                {
+                    read("a", in.oprandT1, in.op1, in.eip);
+                    jump_dynamic("true");
+                }
+                break;
+            case insn_t::JZ:
+            case insn_t::JNZ:
+            {
+                const char *taken = in.kind == insn_t::JZ ? "asc::aot_ld(r.mem + esp) == 0" : "asc::aot_ld(r.mem + esp) != 0";
+                read("a", in.oprandT1, in.op1, in.eip);
+                fault(in.eip, "esp >= r.size");
+                if (in.oprandT1 == oprand_t::IMM)
+                    jump(taken, in.op2);
+                else
+                    jump_dynamic(taken);
+                break;
+            }
+            case insn_t::CALL:
+                if (in.oprandT1 == oprand_t::IMM && in.op1 >= 0)
+                {
+                    line("self->ESP = esp, self->EIP = %u;", in.eip);
+                    if (translated[in.op1])
+                        line("if (!f%d(&elf->text[%d], elf, self)) return self->fail();", in.op1, in.op1);
+                    else
+                        line("if (!elf->text[%d](elf, self)) return self->fail();", in.op1);
+                }
+                else if (in.oprandT1 == oprand_t::IMM)
+                {
+                    line("self->ESP = esp, self->EIP = %u;", in.eip);
+                    line("if (!asc::aot_call_import(elf->imports[%d], self, %d)) return self->fail();", -1 - in.op1, in.op1);
+                }
+                else
+                {
+                    read("a", in.oprandT1, in.op1, in.eip);
+                    line("self->ESP = esp, self->EIP = %u;", in.eip);
+                    line("if (!asc::aot_call_dynamic(self, a)) return self->fail();");
+                }
+                after_call(in.eip, false);
+                break;
+            case insn_t::CALLEXT:
+                if (in.oprandT1 == oprand_t::IMM)
+                {
+                    line("self->ESP = esp, self->EIP = %u;", in.eip);
+                    if (in.op1 >= 0 && static_cast<size_t>(in.op1) < extlib_count)
+                        line("if (!(elf->ext == nullptr ? asc::extlib[%d](self) : asc::aot_callext(self, %d))) return self->fail();", in.op1, in.op1);
+                    else
+                        line("if (!asc::aot_callext(self, %d)) return self->fail();", in.op1);
+                }
+                else
+                {
+                    read("a", in.oprandT1, in.op1, in.eip);
+                    line("self->ESP = esp, self->EIP = %u;", in.eip);
+                    line("if (!asc::aot_callext(self, a)) return self->fail();");
+                }
+                after_call(in.eip, true);
+                break;
+            case insn_t::RET:
+                line("self->ESP = esp, self->EIP = %u;", in.eip);
+                line("return true;");
+                break;
+            case insn_t::NOP:
+            case insn_t::YIELD: // translated code runs recursively, nothing to hand control back to
+                break;
+            case insn_t::GOTO:
+                jump("true", in.op2);
+                break;
+            default:
+                fault(in.eip, "true");
+                break;
+            }
+        }
+        static inline void fold(insn_t::kind_t kind, int32_t a, int32_t b, int32_t &v)
+        {
+            static constexpr bool (*ops[])(int32_t, int32_t, int32_t *) = {
+                &binary_op<opcode_t::ADD>, &binary_op<opcode_t::SUB>, &binary_op<opcode_t::MUL>, &binary_op<opcode_t::DIV>,
+                &binary_op<opcode_t::AND>, &binary_op<opcode_t::OR>, &binary_op<opcode_t::XOR>, &binary_op<opcode_t::SHL>,
+                &binary_op<opcode_t::CMP>, &binary_op<opcode_t::CMPG>, &binary_op<opcode_t::CMPGE> };
+            ops[kind - insn_t::ADD](a, b, &v);
+        }
+        // false if f cannot be translated
+        static inline bool translatable(const func_t &func, const elf_t *elf)
+        {
+            if (func.verified != elf || func.decoded.size() == 0)
+                return false;
+            for (auto &it : func.decoded)
+            {
+                if (it.kind == insn_t::ALLOC || it.kind == insn_t::FREE || it.oprandT1 == oprand_t::HEAP_IA || it.oprandT2 == oprand_t::HEAP_IA)
+                    return false; // the heap stays with the interpreter
+                if ((it.kind == insn_t::GOTO || ((it.kind == insn_t::JMP || it.kind == insn_t::JZ || it.kind == insn_t::JNZ) &&
+                    it.oprandT1 == oprand_t::IMM)) && (it.op2 <= 0 || static_cast<size_t>(it.op2) > func.decoded.size()))
+                    return false;
+            }
+            return true;
+        }
+        inline void function(size_t index)
+        {
+            f = &elf->text[index];
+            targets.assign(f->decoded.size(), false);
+            for (auto &it : f->decoded)
+                if (it.kind == insn_t::GOTO || ((it.kind == insn_t::JMP || it.kind == insn_t::JZ || it.kind == insn_t::JNZ) && it.oprandT1 == oprand_t::IMM))
+                    targets[it.op2 - 1] = true;
+            out += "bool f" + std::to_string(index) + "(asc::func_t *self, asc::elf_t *elf, asc::func_t *caller)\n{\n";
+            line("asc::aot_regs_t r;");
+            line("int entered = asc::aot_enter(self, elf, caller, r);");
+            line("if (entered >= 0)");
+            line("    return entered != 0;");
+            line("uint32_t esp = 0, o = 0, o2 = 0, o3 = 0;");
+            line("int32_t a = 0, b = 0, v = 0;");
+            line("uint8_t *p = nullptr, *q = nullptr;");
+            line("(void)esp, (void)o, (void)o2, (void)o3, (void)a, (void)b, (void)v, (void)p, (void)q;");
+            for (size_t i = 0; i < f->decoded.size(); i++)
+            {
+                const insn_t &in = f->decoded[i];
+                if (targets[i])
+                    out += "L" + std::to_string(i) + ":\n";
+                insn(in);
+            }
+            out += "}\n";
+        }
+    };
+
+    // C++ source of every translatable function of elf (verified first), false if none was
+    inline bool aot_translate(elf_t &elf, std::string &out)
+    {
+        elf.verify();
+        aot_writer_t w;
+        w.elf = &elf;
+        w.translated.resize(elf.text.size());
+        size_t n = 0;
+        for (size_t i = 0; i < elf.text.size(); i++)
+            n += w.translated[i] = aot_writer_t::translatable(elf.text[i], &elf);
+        char name[namelen + 1] = {};
+        for (size_t i = 0; i < namelen && elf.name[i] != 0; i++)
+            name[i] = std::isprint(static_cast<unsigned char>(elf.name[i])) && elf.name[i] != '"' && elf.name[i] != '\\' ? elf.name[i] : '?';
+        char print[32];
+        std::snprintf(print, sizeof(print), "0x%016llXull", static_cast<unsigned long long>(aot_print(elf)));
+        w.out = "// translated by asc::aot_translate from module \"" + std::string(name) + "\", do not edit\n";
+        w.out += "#include \"AS32_aot.h\"\n\nnamespace {\n";
+        for (size_t i = 0; i < elf.text.size(); i++)
+            if (w.translated[i])
+                w.out += "bool f" + std::to_string(i) + "(asc::func_t *self, asc::elf_t *elf, asc::func_t *caller);\n";
+        for (size_t i = 0; i < elf.text.size(); i++)
+            if (w.translated[i])
+                w.out += "\n", w.function(i);
+        w.out += "\nconst asc::native_t funcs[] = {";
+        for (size_t i = 0; i < elf.text.size(); i++)
+            w.out += std::string(i == 0 ? " " : ", ") + (w.translated[i] ? "&f" + std::to_string(i) : "nullptr");
+        if (elf.text.size() == 0)
+            w.out += " nullptr";
+        w.out += " };\nconst asc::aot_module_t module = { \"" + std::string(name) + "\", " + print + ", " + std::to_string(elf.text.size()) + ", funcs };\n";
+        w.out += "const bool registered = asc::aot_register(&module);\n}\n";
+        out = std::move(w.out);
+        return n != 0;
+    }
+}
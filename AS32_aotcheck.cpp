@@ -0,0 +1,374 @@
+// ahead-of-time differential check, see aot_translate() in AS32_aot.h
+//	AS32_aotcheck --images dir [count]	writes count random module pairs a<i>.as32 and b<i>.as32, a imports from b,
+//					in every other pair a function calls itself
+//	AS32_aotcheck dir [count]		loads every pair twice, runs index 0 of a verified in the interpreter and after
+//	aot_install() of the translations compiled into this program, then compares ok, registers, faults, assembly and data.
+//	a third load has every function reloaded from its compact stream (AS32_compact.h), which must expand to the same
+//	bytes, and runs the threaded code compact_load() decoded from it
+//	exits 1 on a difference or if nothing was installed. the build translates the images with AS32_aot, compiles
+//	the translations into AS32_aotcheck and registers AS32_aotcheck <dir> as its test
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "AS32_aot.h"
+#include "AS32_compact.h"
+#include "AS32_image.h"
+
+struct asc_aotcheck_random_t
+{
+	uint32_t seed;
+	int operator()(int n)
+	{
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % static_cast<uint32_t>(n));
+	}
+};
+
+inline int asc_aotcheck_length(asc::opcode_t opcode)
+{
+	using namespace asc;
+	switch (opcode)
+	{
+	case opcode_t::MOV: case opcode_t::XCHG: case opcode_t::ADD: case opcode_t::SUB: case opcode_t::MUL:
+	case opcode_t::DIV: case opcode_t::AND: case opcode_t::OR: case opcode_t::XOR: case opcode_t::SHL:
+	case opcode_t::CMP: case opcode_t::CMPG: case opcode_t::CMPGE:
+		return 12;
+	case opcode_t::POP: case opcode_t::RET: case opcode_t::NOP: case opcode_t::INT:
+		return 4;
+	default:
+		return 8;
+	}
+}
+
+inline int32_t asc_aotcheck_operand(asc_aotcheck_random_t& r, int mode, int size)
+{
+	switch (mode)
+	{
+	case 0: // IMM, small, 0 for DIV
+		return r(4) == 0 ? r(200) - 100 : r(8) - 2;
+	case 1: // IA, anywhere in the assembly: code included, one past the end
+		return 4 * r(size / 4 + 1);
+	case 2: // ESP
+		return r(16);
+	case 3: // ESP_IA, below ESP too
+		return 4 * r(6) - 8;
+	case 5: // EBP_IA
+		return 4 * r(10) - 4;
+	case 6: // DATA_IA, past the data section too
+		return 4 * r(18);
+	default:
+		return r(50);
+	}
+}
+
+inline void asc_aotcheck_put(asc::func_t& f, int at, asc::opcode_t opcode, asc::oprand_t t1, asc::oprand_t t2, int32_t op1, int32_t op2)
+{
+	std::memcpy(&f.assembly[at], &opcode, 2);
+	f.assembly[at + 2] = static_cast<uint8_t>(t1);
+	f.assembly[at + 3] = static_cast<uint8_t>(t2);
+	std::memcpy(&f.assembly[at + 4], &op1, 4);
+	if (asc_aotcheck_length(opcode) == 12)
+		std::memcpy(&f.assembly[at + 8], &op2, 4);
+}
+
+// a random function: scratch bytes, then instructions from EIP_Begin. jumps go forward (backward if back),
+// CALL goes to the function itself, a later local function or an import, index 0 of b exists only through an import.
+// a recursive one starts by calling itself until data {0} counted its entries past 1 to 3, the innermost activation
+// then writes through EBP_IA into its own stack, which it moved first:
+//	INC {0}; MOVE m; CMPG {0}, k; JNZ write; CALL self; write: MOV [EBP + o], v
+inline void asc_aotcheck_func(asc::func_t& f, asc_aotcheck_random_t& r, int index, int funcs, int imports, bool back, bool recursive)
+{
+	using namespace asc;
+	static const opcode_t opcodes[] = {
+		opcode_t::MOV, opcode_t::MOVE, opcode_t::XCHG, opcode_t::ADD, opcode_t::SUB, opcode_t::MUL, opcode_t::DIV,
+		opcode_t::INC, opcode_t::DEC, opcode_t::NEG, opcode_t::AND, opcode_t::OR, opcode_t::XOR, opcode_t::NOT,
+		opcode_t::SHL, opcode_t::PUSH, opcode_t::POP, opcode_t::JMP, opcode_t::JZ, opcode_t::JNZ, opcode_t::CALL,
+		opcode_t::RET, opcode_t::NOP, opcode_t::INT, opcode_t::CMP, opcode_t::CMPG, opcode_t::CMPGE };
+	const int prefix = recursive ? 56 : 0;
+	int size = 4 * (24 + r(40)) + prefix;
+	f.assembly.assign(size, 0);
+	for (auto& b : f.assembly)
+		if (r(4) == 0)
+			b = static_cast<uint8_t>(r(256));
+	int begin = r(4) == 0 ? 0 : r(48); // unaligned too
+	f.EIP_Begin = begin;
+	f.ESP = 0;
+	f.EIP = 0;
+	std::vector<int> starts;
+	std::vector<uint16_t> codes;
+	for (int at = begin + prefix; at + 12 <= size - r(2) * 8;)
+	{
+		uint16_t code = static_cast<uint16_t>(opcodes[r(sizeof(opcodes) / sizeof(opcodes[0]))]);
+		if (r(40) == 0)
+			code = static_cast<uint16_t>(r(65536));
+		starts.push_back(at);
+		codes.push_back(code);
+		at += asc_aotcheck_length(static_cast<opcode_t>(code));
+		if (r(30) == 0)
+			break;
+	}
+	for (size_t i = 0; i < starts.size(); i++)
+	{
+		int at = starts[i];
+		uint16_t code = codes[i];
+		opcode_t opcode = static_cast<opcode_t>(code);
+		int t1 = r(7);
+		if (t1 == 4)
+			t1 = 3;
+		int t2 = r(7);
+		if (t2 == 4)
+			t2 = 5;
+		if (r(60) == 0)
+			t1 = r(256); // invalid
+		int32_t op1 = asc_aotcheck_operand(r, t1, size);
+		int32_t op2 = asc_aotcheck_operand(r, t2, size);
+		if (opcode == opcode_t::MOVE)
+		{
+			t2 = r(3) == 0 ? 3 : 0;
+			op1 = t2 == 0 ? 4 * r(size / 4) : 4 * r(2);
+			if (r(8) != 0)
+				t2 = 0;
+		}
+		if ((opcode == opcode_t::JMP || opcode == opcode_t::JZ || opcode == opcode_t::JNZ) && r(8) != 0)
+		{
+			t1 = 0;
+			size_t to = i + 1 + r(static_cast<int>(starts.size() - i));
+			op1 = to < starts.size() ? starts[to] : (r(2) != 0 ? size + 4 : r(size));
+			if (back && r(2) != 0)
+				op1 = starts[r(static_cast<int>(i + 1))];
+			if (r(10) == 0)
+				op1 = at + 4; // into the instruction
+		}
+		if (opcode == opcode_t::CALL)
+		{
+			t1 = 0;
+			if (imports != 0 && (r(2) != 0 || index + 1 >= funcs))
+				op1 = -1 - r(imports + 1); // one past the imports too
+			else
+				op1 = index + r(funcs - index);
+		}
+		std::memcpy(&f.assembly[at], &code, 2);
+		f.assembly[at + 2] = static_cast<uint8_t>(t1);
+		f.assembly[at + 3] = static_cast<uint8_t>(t2);
+		if (at + 8 <= size)
+			std::memcpy(&f.assembly[at + 4], &op1, 4);
+		if (at + 12 <= size)
+			std::memcpy(&f.assembly[at + 8], &op2, 4);
+	}
+	if (recursive)
+	{
+		asc_aotcheck_put(f, begin, opcode_t::INC, oprand_t::DATA_IA, oprand_t::IMM, 0, 0);
+		asc_aotcheck_put(f, begin + 8, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 4 * (1 + r(6)), 0);
+		asc_aotcheck_put(f, begin + 16, opcode_t::CMPG, oprand_t::DATA_IA, oprand_t::IMM, 0, 1 + r(3));
+		asc_aotcheck_put(f, begin + 28, opcode_t::JNZ, oprand_t::IMM, oprand_t::IMM, begin + 44, 0);
+		asc_aotcheck_put(f, begin + 36, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, index, 0);
+		asc_aotcheck_put(f, begin + 44, opcode_t::MOV, oprand_t::EBP_IA, oprand_t::IMM, 4 * r(4), 1 + r(100));
+	}
+}
+
+// pair i of a seed, a linked to b. index 0 of a is recursive in every other pair
+inline void asc_aotcheck_pair(asc::elf_t& a, asc::elf_t& b, int i, uint32_t seed)
+{
+	asc_aotcheck_random_t r = { seed };
+	std::memset(a.name, 0, asc::namelen);
+	std::memset(b.name, 0, asc::namelen);
+	std::snprintf(a.name, asc::namelen, "a%d", i);
+	std::snprintf(b.name, asc::namelen, "b%d", i);
+	a.referenced = 0;
+	b.referenced = 0;
+	int funcs_a = 1 + r(3);
+	int funcs_b = 1 + r(2);
+	int imports = r(3) == 0 ? 0 : funcs_b;
+	a.text.resize(funcs_a);
+	b.text.resize(funcs_b);
+	for (int k = 0; k < funcs_a; k++)
+		asc_aotcheck_func(a.text[k], r, k, funcs_a, imports, true, k == 0 && i % 2 != 0);
+	for (int k = 0; k < funcs_b; k++)
+		asc_aotcheck_func(b.text[k], r, k, funcs_b, 0, false, false);
+	a.data.resize(4 * (16 + r(16)));
+	for (auto& x : a.data)
+		x = static_cast<uint8_t>(r(256));
+	if (i % 2 != 0)
+		std::memset(a.data.data(), 0, sizeof(int32_t));
+	b.data.resize(r(2) != 0 ? 0 : 64);
+	for (auto& x : b.data)
+		x = static_cast<uint8_t>(r(256));
+	if (imports != 0)
+	{
+		a.dependency.push_back({});
+		std::memcpy(a.dependency[0].name, b.name, asc::namelen);
+		a.dependency[0].ptr = nullptr;
+		for (int k = 0; k < imports; k++)
+			a.imports.emplace_back(0, k);
+		a.load_elf(&b);
+	}
+}
+
+// index 0 of a returns or faults within the budget and calls at most 64 deep, so the recursive interpreter
+// and the native functions run it without a C++ stack overflow. a function that calls itself runs in place
+// (exec_t::share), exactly as in the recursive engine. with recursive, one of them must have done so and,
+// verified and so translated, then addressed its own stack through EBP_IA with an ESP moved from 0
+inline bool asc_aotcheck_finite(int i, uint32_t seed, bool recursive)
+{
+	asc::elf_t a, b;
+	asc_aotcheck_pair(a, b, i, seed);
+	if (recursive)
+		a.verify(), b.verify();
+	asc::exec_t exec;
+	exec.share = true;
+	if (exec.start(&a) == false)
+		return false;
+	for (int step = 0; step < 100000; step++)
+	{
+		size_t depth = exec.frames.size();
+		if (depth >= 2 && exec.frames[depth - 1].code == exec.frames[depth - 2].code)
+		{
+			asc::func_t* f = exec.frames[depth - 1].f;
+			const uint8_t ebp_ia = static_cast<uint8_t>(asc::oprand_t::EBP_IA);
+			if (f->verified != nullptr && f->ESP != 0 && f->EIP + 4 <= f->assembly.size() &&
+				(f->assembly[f->EIP + 2] == ebp_ia || f->assembly[f->EIP + 3] == ebp_ia))
+				recursive = false;
+		}
+		asc::state_t state = exec.run(1);
+		if (exec.frames.size() > 64)
+			return false;
+		if (state == asc::state_t::RET || state == asc::state_t::FAULT)
+			return recursive == false;
+	}
+	return false;
+}
+
+inline std::string asc_aotcheck_path(const std::string& dir, char module, int i)
+{
+	return dir + "/" + module + std::to_string(i) + ".as32";
+}
+
+inline bool asc_aotcheck_images(const std::string& dir, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		uint32_t seed = 1000 * i;
+		while (asc_aotcheck_finite(i, seed, i % 2 != 0) == false) // every other pair recurses
+			seed++;
+		asc::elf_t a, b;
+		asc_aotcheck_pair(a, b, i, seed);
+		a.unload_elf();
+		if (asc::image_t::save(a, asc_aotcheck_path(dir, 'a', i).c_str()) == false
+			|| asc::image_t::save(b, asc_aotcheck_path(dir, 'b', i).c_str()) == false)
+		{
+			std::printf("%s: cannot write\n", asc_aotcheck_path(dir, 'a', i).c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+// the images close on return: a and b own their bytes
+inline bool asc_aotcheck_load(const std::string& dir, int i, asc::elf_t& a, asc::elf_t& b)
+{
+	asc::image_t image_a, image_b;
+	if (image_a.open(asc_aotcheck_path(dir, 'a', i).c_str()) == false || image_a.load(a) == false
+		|| image_b.open(asc_aotcheck_path(dir, 'b', i).c_str()) == false || image_b.load(b) == false)
+		return false;
+	for (asc::elf_t* elf : { &a, &b })
+	{
+		for (auto& f : elf->text)
+			f.assembly.own();
+		elf->data.own();
+	}
+	return a.dependency.size() == 0 || a.load_elf(&b);
+}
+
+// everything a run can change
+inline void asc_aotcheck_state(asc::elf_t& a, asc::elf_t& b, bool ok, std::vector<uint8_t>& out)
+{
+	out.push_back(ok);
+	for (asc::elf_t* elf : { &a, &b })
+	{
+		for (auto& f : elf->text)
+		{
+			out.insert(out.end(), reinterpret_cast<uint8_t*>(&f.ESP), reinterpret_cast<uint8_t*>(&f.ESP) + sizeof(f.ESP));
+			out.insert(out.end(), reinterpret_cast<uint8_t*>(&f.EIP), reinterpret_cast<uint8_t*>(&f.EIP) + sizeof(f.EIP));
+			out.push_back(static_cast<uint8_t>(f.fault));
+			std::vector<uint8_t> assembly;
+			asc::compact_assembly(f, assembly);
+			out.insert(out.end(), assembly.begin(), assembly.end());
+		}
+		out.insert(out.end(), elf->data.begin(), elf->data.end());
+	}
+}
+
+// every function of elf reloaded from its compact stream, false unless the stream expands to the same bytes
+inline bool asc_aotcheck_compact(asc::elf_t& elf)
+{
+	bool ok = true;
+	std::vector<uint8_t> stream, loaded;
+	for (auto& f : elf.text)
+	{
+		asc::bytes_t assembly = f.assembly;
+		asc::compact(f, stream);
+		ok = asc::compact_load(f, stream.data(), stream.size()) && (asc::compact_assembly(f, loaded), assembly == loaded) && ok;
+	}
+	return ok;
+}
+
+inline bool asc_aotcheck(const std::string& dir, int count)
+{
+	int installed = 0;
+	int faults = 0;
+	int diffs = 0;
+	for (int i = 0; i < count; i++)
+	{
+		asc::elf_t a, b, native_a, native_b, compact_a, compact_b;
+		if (asc_aotcheck_load(dir, i, a, b) == false || asc_aotcheck_load(dir, i, native_a, native_b) == false
+			|| asc_aotcheck_load(dir, i, compact_a, compact_b) == false)
+		{
+			std::printf("%s: not a valid image pair\n", asc_aotcheck_path(dir, 'a', i).c_str());
+			return false;
+		}
+		a.verify();
+		b.verify();
+		installed += static_cast<int>(asc::aot_install(native_a) + asc::aot_install(native_b));
+		std::vector<uint8_t> interpreted, native;
+		bool ok = a();
+		asc_aotcheck_state(a, b, ok, interpreted);
+		asc_aotcheck_state(native_a, native_b, native_a(), native);
+		faults += ok == false;
+		if (interpreted != native)
+		{
+			std::printf("%s: native run differs from the interpreter\n", asc_aotcheck_path(dir, 'a', i).c_str());
+			diffs++;
+		}
+		if (asc_aotcheck_compact(compact_a) == false || asc_aotcheck_compact(compact_b) == false)
+		{
+			std::printf("%s: compact code does not expand to the assembly\n", asc_aotcheck_path(dir, 'a', i).c_str());
+			diffs++;
+			continue;
+		}
+		std::vector<uint8_t> compacted;
+		asc_aotcheck_state(compact_a, compact_b, compact_a(), compacted);
+		if (interpreted != compacted)
+		{
+			std::printf("%s: run from compact code differs from the interpreter\n", asc_aotcheck_path(dir, 'a', i).c_str());
+			diffs++;
+		}
+	}
+	std::printf("aot check: %d pairs, %d native functions, %d faulted, %d differ\n", count, installed, faults, diffs);
+	return diffs == 0 && installed != 0;
+}
+
+int main(int argc, char** argv)
+{
+	bool images = argc > 1 && std::strcmp(argv[1], "--images") == 0;
+	int at = images ? 2 : 1;
+	if (argc <= at || argc > at + 2)
+	{
+		std::printf("usage: %s [--images] dir [count]\n", argv[0]);
+		return 2;
+	}
+	int count = argc == at + 2 ? std::atoi(argv[at + 1]) : 16;
+	bool ok = images ? asc_aotcheck_images(argv[at], count) : asc_aotcheck(argv[at], count);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,637 @@
+#pragma once
+#include <cstring>
+#include "AssemblyScript32.h"
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define AS32_BATCH_AVX2 __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#define AS32_BATCH_AVX2
+#endif
+#endif
+
+namespace asc {
+    // batch execution
+    // batch_t runs one function of many instances (context_t instances of one module, or elfs of the same shape)
+    // at once. the words of the function's assembly and of the data section are transposed into rows, one lane
+    // per instance (structure of arrays), and every instruction is decoded once and executed over all lanes at
+    // the same EIP: MOV, XCHG, INC..NEG, the binary operations, NOT, PUSH/POP, MOVE and the jumps as lane
+    // operations (AVX2 where the CPU has it, plain loops elsewhere). lanes that branch apart run separately,
+    // lowest EIP first, until they meet again. whatever a lane cannot do exactly that way (CALL, CALLEXT, the
+    // heap, an unaligned or out of range access, a write into the code, a division by zero, a dynamic target)
+    // hands the lane over to the switch interpreter at that instruction. every instance ends exactly as its own
+    // func_t::operator()(elf, nullptr) would leave it. instances must not share mutable state, tracked or
+    // profiled or traced ones and those whose code differs from the first instance run one by one.
+    enum batch_lane_t : uint8_t
+    {
+        BATCH_RUN,      // at the current EIP of the batch (or its own EIP after a divergent branch)
+        BATCH_DONE,     // returned
+        BATCH_SCALAR,   // handed to the switch interpreter at its EIP
+        BATCH_ALONE,    // not batched, runs func_t::operator() from the start
+    };
+
+    // one lane of a lane operation, the same results as the interpreter's
+    template <int kind>
+    inline int32_t batch_scalar(int32_t d, int32_t a, int32_t b)
+    {
+        if constexpr (kind == insn_t::MOV)
+            return a;
+        else if constexpr (kind == insn_t::INC)
+            return d + 1;
+        else if constexpr (kind == insn_t::DEC)
+            return d - 1;
+        else if constexpr (kind == insn_t::NEG)
+            return d * -1;
+        else if constexpr (kind == insn_t::NOT)
+            return ~a;
+        else
+        {
+            binary_op<binary_opcodes[kind - insn_t::ADD]>(a, b, &d);
+            return d;
+        }
+    }
+    template <int kind>
+    inline void batch_loop(int32_t *dst, const int32_t *a, const int32_t *b, const int32_t *mask, size_t n)
+    {
+        for (size_t l = 0; l < n; l++)
+            if (mask[l] != 0)
+                dst[l] = batch_scalar<kind>(dst[l], a[l], b[l]);
+    }
+#ifdef AS32_BATCH_AVX2
+    // 8 lanes. shift counts are taken mod 32 like the x86 shifts of the interpreter, DIV has no lane form
+    template <int kind>
+    AS32_BATCH_AVX2 inline __m256i batch_vector(__m256i d, __m256i a, __m256i b)
+    {
+        const __m256i one = _mm256_set1_epi32(1);
+        if constexpr (kind == insn_t::MOV)
+            return a;
+        else if constexpr (kind == insn_t::INC)
+            return _mm256_add_epi32(d, one);
+        else if constexpr (kind == insn_t::DEC)
+            return _mm256_sub_epi32(d, one);
+        else if constexpr (kind == insn_t::NEG)
+            return _mm256_sub_epi32(_mm256_setzero_si256(), d);
+        else if constexpr (kind == insn_t::NOT)
+            return _mm256_xor_si256(a, _mm256_set1_epi32(-1));
+        else if constexpr (kind == insn_t::ADD)
+            return _mm256_add_epi32(a, b);
+        else if constexpr (kind == insn_t::SUB)
+            return _mm256_sub_epi32(a, b);
+        else if constexpr (kind == insn_t::MUL)
+            return _mm256_mullo_epi32(a, b);
+        else if constexpr (kind == insn_t::AND)
+            return _mm256_and_si256(a, b);
+        else if constexpr (kind == insn_t::OR)
+            return _mm256_or_si256(a, b);
+        else if constexpr (kind == insn_t::XOR)
+            return _mm256_xor_si256(a, b);
+        else if constexpr (kind == insn_t::SHL)
+        {
+            const __m256i bits = _mm256_set1_epi32(31);
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i left = _mm256_sllv_epi32(a, _mm256_and_si256(b, bits));
+            __m256i right = _mm256_srav_epi32(a, _mm256_and_si256(_mm256_sub_epi32(zero, b), bits));
+            __m256i r = _mm256_blendv_epi8(d, right, _mm256_cmpgt_epi32(zero, b));
+            return _mm256_blendv_epi8(r, left, _mm256_cmpgt_epi32(b, zero));
+        }
+        else if constexpr (kind == insn_t::CMP)
+            return _mm256_and_si256(_mm256_cmpeq_epi32(a, b), one);
+        else if constexpr (kind == insn_t::CMPG)
+            return _mm256_and_si256(_mm256_cmpgt_epi32(a, b), one);
+        else if constexpr (kind == insn_t::CMPGE)
+            return _mm256_andnot_si256(_mm256_cmpgt_epi32(b, a), one);
+        else
+            return d;
+    }
+    template <int kind>
+    AS32_BATCH_AVX2 inline void batch_loop_avx2(int32_t *dst, const int32_t *a, const int32_t *b, const int32_t *mask, size_t n)
+    {
+        for (size_t l = 0; l < n; l += 8)
+        {
+            __m256i m = _mm256_loadu_si256((const __m256i *)(mask + l));
+            if (_mm256_testz_si256(m, m))
+                continue;
+            __m256i d = _mm256_loadu_si256((const __m256i *)(dst + l));
+            __m256i va = _mm256_loadu_si256((const __m256i *)(a + l));
+            __m256i vb = _mm256_loadu_si256((const __m256i *)(b + l));
+            __m256i r = batch_vector<kind>(d, va, vb);
+            _mm256_storeu_si256((__m256i *)(dst + l), _mm256_blendv_epi8(d, r, m));
+        }
+    }
+    inline bool batch_has_avx2()
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        static const bool has = __builtin_cpu_supports("avx2");
+        return has;
+#else
+        return true;
+#endif
+    }
+#endif
+    // dst[l] = kind(dst[l], a[l], b[l]) for the lanes in mask, n a multiple of 8
+    template <int kind>
+    inline void batch_lanes(bool vector, int32_t *dst, const int32_t *a, const int32_t *b, const int32_t *mask, size_t n)
+    {
+#ifdef AS32_BATCH_AVX2
+        if (kind != insn_t::DIV && vector && batch_has_avx2())
+            return batch_loop_avx2<kind>(dst, a, b, mask, n);
+#endif
+        batch_loop<kind>(dst, a, b, mask, n);
+    }
+    inline void batch_kernel(bool vector, insn_t::kind_t kind, int32_t *dst, const int32_t *a, const int32_t *b, const int32_t *mask, size_t n)
+    {
+        switch (kind)
+        {
+        case insn_t::MOV: case insn_t::PUSH: return batch_lanes<insn_t::MOV>(vector, dst, a, b, mask, n);
+        case insn_t::INC: return batch_lanes<insn_t::INC>(vector, dst, a, b, mask, n);
+        case insn_t::DEC: return batch_lanes<insn_t::DEC>(vector, dst, a, b, mask, n);
+        case insn_t::NEG: return batch_lanes<insn_t::NEG>(vector, dst, a, b, mask, n);
+        case insn_t::NOT: return batch_lanes<insn_t::NOT>(vector, dst, a, b, mask, n);
+        case insn_t::ADD: return batch_lanes<insn_t::ADD>(vector, dst, a, b, mask, n);
+        case insn_t::SUB: return batch_lanes<insn_t::SUB>(vector, dst, a, b, mask, n);
+        case insn_t::MUL: return batch_lanes<insn_t::MUL>(vector, dst, a, b, mask, n);
+        case insn_t::DIV: return batch_lanes<insn_t::DIV>(vector, dst, a, b, mask, n);
+        case insn_t::AND: return batch_lanes<insn_t::AND>(vector, dst, a, b, mask, n);
+        case insn_t::OR: return batch_lanes<insn_t::OR>(vector, dst, a, b, mask, n);
+        case insn_t::XOR: return batch_lanes<insn_t::XOR>(vector, dst, a, b, mask, n);
+        case insn_t::SHL: return batch_lanes<insn_t::SHL>(vector, dst, a, b, mask, n);
+        case insn_t::CMP: return batch_lanes<insn_t::CMP>(vector, dst, a, b, mask, n);
+        case insn_t::CMPG: return batch_lanes<insn_t::CMPG>(vector, dst, a, b, mask, n);
+        case insn_t::CMPGE: return batch_lanes<insn_t::CMPGE>(vector, dst, a, b, mask, n);
+        default: return;
+        }
+    }
+
+    struct batch_t
+    {
+        // an operand over the lanes in mask: the values (a row of mem or tmp) and, for memory, where they live
+        struct ref_t
+        {
+            const int32_t *src = nullptr;
+            int32_t *row = nullptr;     // the same row for every lane
+            int32_t *at = nullptr;      // otherwise the index into mem per lane, nullptr: not memory
+        };
+        func_t code;                    // copy of the threaded code of the function the lanes run
+        const func_t *source = nullptr; // code is a copy of its predecode number generation
+        uint32_t generation = 0;
+        size_t count = 0;
+        size_t stride = 0;              // lanes rounded up to 8
+        uint32_t arows = 0;             // whole words of assembly, then of data
+        uint32_t drows = 0;
+        std::vector<int32_t> mem;       // word r of lane l at r * stride + l
+        std::vector<uint8_t> written;   // rows stored to, the only ones copied back
+        std::vector<int32_t> mask;      // -1: the lane runs the current instruction
+        std::vector<uint8_t> lanes;     // batch_lane_t
+        std::vector<uint32_t> eip;      // per lane while diverged
+        std::vector<int32_t> esp;       // per lane unless esp_same
+        std::vector<int32_t> tmp[6];
+        std::vector<elf_t *> elfs;
+        size_t func = 0;
+        size_t running = 0;
+        bool converged = true;          // every running lane is at pc
+        uint32_t pc = 0;
+        bool esp_same = true;           // every running lane has ESP esp_value, implies converged
+        int32_t esp_value = 0;
+        bool vector = true;             // false: plain lane loops even where AVX2 is available
+        std::vector<uint8_t> results;   // func_t::operator() result of each instance
+        uint64_t steps = 0;             // instructions executed as lane operations
+        uint64_t handed = 0;            // lanes that went to the interpreter
+
+        inline bool run(const std::vector<elf_t *> &instances, size_t index = 0)
+        {
+            return run(instances.data(), instances.size(), index);
+        }
+        bool run(elf_t *const *instances, size_t n, size_t index = 0); // text[index] of every instance, true if all returned
+
+        inline func_t &fn(size_t l) { return elfs[l]->text[func]; }
+        bool fits(elf_t *elf);
+        void load(size_t l);
+        void store(size_t l);
+        inline void hand(size_t l) // to the interpreter at the current instruction
+        {
+            lanes[l] = BATCH_SCALAR;
+            mask[l] = 0;
+            eip[l] = pc;
+            if (esp_same)
+                esp[l] = esp_value;
+            running--;
+            handed++;
+        }
+        inline void hand_all()
+        {
+            for (size_t l = 0; l < count; l++)
+                if (mask[l] != 0)
+                    hand(l);
+        }
+        inline int32_t esp_of(size_t l) const { return esp_same ? esp_value : esp[l]; }
+        // row of the 4-byte word at off of assembly (data: of the data section), -1 if the interpreter must do it
+        inline int64_t row_of(uint32_t off, bool data, bool write) const
+        {
+            uint32_t rows = data ? drows : arows;
+            if ((off & 3) != 0 || (off >> 2) >= rows)
+                return -1;
+            if (!data && write && off - code.code_lo < code.code_len)
+                return -1;
+            return (data ? arows : 0) + (off >> 2);
+        }
+        bool resolve(oprand_t opt, int32_t op, bool write, ref_t &r, int32_t *vals, int32_t *at);
+        inline bool resolve_esp(ref_t &r, int32_t *vals, int32_t *at) // [ESP], read or written, never in the code
+        {
+            return resolve(oprand_t::ESP_IA, 0, true, r, vals, at);
+        }
+        void commit(insn_t::kind_t kind, ref_t &dst, const int32_t *a, const int32_t *b);
+        void advance(uint32_t next);
+        void branch(const int32_t *target, const int32_t *taken, uint32_t next);
+        void set_esp(const int32_t *value, int32_t add);
+        void converge();
+        void step();
+    };
+
+    inline bool batch_t::fits(elf_t *elf)
+    {
+        if (elf == nullptr || func >= elf->text.size() || elf->dirty.tracked() || AS32_INSTRUMENTED())
+            return false;
+        const func_t &f = elf->text[func];
+        if (f.assembly.size() != code.assembly.size() || f.EIP_Begin != code.EIP_Begin || f.dirty.tracked() ||
+            elf->data.size() != elfs[0]->data.size())
+            return false;
+        const bytes_t &compact = f.code().compact;
+        if (compact.size() != code.compact.size() || // compact code: assembly holds the stack only
+            (compact.size() != 0 && std::memcmp(compact.bytes(), code.compact.bytes(), compact.size()) != 0))
+            return false;
+        return code.code_len == 0 || std::memcmp(&f.assembly[code.code_lo], &code.assembly[code.code_lo], code.code_len) == 0;
+    }
+    inline void batch_t::load(size_t l)
+    {
+        const func_t &f = fn(l);
+        for (uint32_t r = 0; r < arows; r++)
+            std::memcpy(&mem[r * stride + l], &f.assembly[r * 4], sizeof(int32_t));
+        for (uint32_t r = 0; r < drows; r++)
+            std::memcpy(&mem[(arows + r) * stride + l], elfs[l]->data.bytes() + r * 4, sizeof(int32_t));
+    }
+    inline void batch_t::store(size_t l)
+    {
+        func_t &f = fn(l);
+        for (uint32_t r = 0; r < arows + drows; r++)
+            if (written[r] != 0)
+                std::memcpy(r < arows ? &f.assembly[r * 4] : &elfs[l]->data[(r - arows) * 4], &mem[r * stride + l], sizeof(int32_t));
+        f.ESP = static_cast<uint32_t>(esp[l]);
+        f.EIP = eip[l];
+    }
+
+    // the checks of func_t::addressing: a lane that would fault, or reach a word the rows do not hold, is handed
+    inline bool batch_t::resolve(oprand_t opt, int32_t op, bool write, ref_t &r, int32_t *vals, int32_t *at)
+    {
+        r = {};
+        switch (opt)
+        {
+        case oprand_t::IMM:
+        case oprand_t::ESP:
+            if (write)
+                break;
+            for (size_t l = 0; l < stride; l++)
+                vals[l] = opt == oprand_t::IMM ? op : esp_of(l) + op;
+            r.src = vals;
+            return true;
+        case oprand_t::IA:
+        case oprand_t::DATA_IA:
+        case oprand_t::ESP_IA:
+        {
+            bool data = opt == oprand_t::DATA_IA;
+            if (opt != oprand_t::ESP_IA || esp_same)
+            {
+                int64_t row = row_of(static_cast<uint32_t>(op) + (opt == oprand_t::ESP_IA ? esp_value : 0), data, write);
+                if (row < 0)
+                    break;
+                r.row = &mem[row * stride];
+                r.src = r.row;
+                return true;
+            }
+            for (size_t l = 0; l < count; l++)
+            {
+                if (mask[l] == 0)
+                    continue;
+                int64_t row = row_of(static_cast<uint32_t>(esp[l] + op), false, write);
+                if (row < 0)
+                {
+                    hand(l);
+                    continue;
+                }
+                at[l] = static_cast<int32_t>(row * stride + l);
+                vals[l] = mem[at[l]];
+            }
+            r.at = at;
+            r.src = vals;
+            return running != 0;
+        }
+        default: // EBP_IA (no caller), HEAP_IA
+            break;
+        }
+        hand_all();
+        return false;
+    }
+    // dst = kind(dst, a, b) in the lanes of mask
+    inline void batch_t::commit(insn_t::kind_t kind, ref_t &dst, const int32_t *a, const int32_t *b)
+    {
+        if (dst.row != nullptr)
+        {
+            written[(dst.row - mem.data()) / stride] = 1;
+            batch_kernel(vector, kind, dst.row, a, b, mask.data(), stride);
+            return;
+        }
+        int32_t *vals = const_cast<int32_t *>(dst.src);
+        batch_kernel(vector, kind, vals, a, b, mask.data(), stride);
+        for (size_t l = 0; l < count; l++)
+            if (mask[l] != 0)
+            {
+                mem[dst.at[l]] = vals[l];
+                written[dst.at[l] / stride] = 1;
+            }
+    }
+    inline void batch_t::advance(uint32_t next)
+    {
+        if (converged)
+        {
+            pc = next;
+            return;
+        }
+        for (size_t l = 0; l < count; l++)
+            if (mask[l] != 0)
+                eip[l] = next;
+    }
+    // per lane: target if taken (taken nullptr: always), next otherwise
+    inline void batch_t::branch(const int32_t *target, const int32_t *taken, uint32_t next)
+    {
+        bool same = true;
+        uint32_t first = 0;
+        bool any = false;
+        for (size_t l = 0; l < count; l++)
+        {
+            if (mask[l] == 0)
+                continue;
+            uint32_t to = taken == nullptr || taken[l] != 0 ? static_cast<uint32_t>(target[l]) : next;
+            if (any && to != first)
+                same = false;
+            if (!any)
+                first = to, any = true;
+            eip[l] = to;
+        }
+        if (converged && same)
+        {
+            pc = first;
+            return;
+        }
+        if (converged) // branched apart: registers per lane from here on
+        {
+            if (esp_same)
+                for (size_t l = 0; l < count; l++)
+                    if (lanes[l] == BATCH_RUN)
+                        esp[l] = esp_value;
+            esp_same = false;
+            converged = false;
+        }
+    }
+    // ESP = value + add in the lanes of mask, value nullptr: ESP + add
+    inline void batch_t::set_esp(const int32_t *value, int32_t add)
+    {
+        if (esp_same && value == nullptr)
+        {
+            esp_value += add;
+            return;
+        }
+        for (size_t l = 0; l < count; l++)
+            if (mask[l] != 0)
+                esp[l] = (value != nullptr ? value[l] : esp_of(l)) + add;
+        if (converged)
+        {
+            esp_same = true;
+            esp_value = 0;
+            bool any = false;
+            for (size_t l = 0; l < count && esp_same; l++)
+                if (lanes[l] == BATCH_RUN)
+                {
+                    if (any && esp[l] != esp_value)
+                        esp_same = false;
+                    esp_value = esp[l], any = true;
+                }
+        }
+    }
+    // diverged: the lanes at the lowest EIP run next, the others wait there for them
+    inline void batch_t::converge()
+    {
+        uint32_t lo = UINT32_MAX;
+        for (size_t l = 0; l < count; l++)
+            if (lanes[l] == BATCH_RUN && eip[l] < lo)
+                lo = eip[l];
+        bool all = true;
+        for (size_t l = 0; l < count; l++)
+        {
+            mask[l] = lanes[l] == BATCH_RUN && eip[l] == lo ? -1 : 0;
+            all = all && (lanes[l] != BATCH_RUN || eip[l] == lo);
+        }
+        pc = lo;
+        if (all)
+        {
+            converged = true;
+            set_esp(esp.data(), 0);
+        }
+    }
+    inline void batch_t::step()
+    {
+        const func_t &c = code;
+        if (pc >= c.decoded_at.size() || c.decoded_at[pc] == 0 ||
+            (c.in_stream() == false && pc + 3 * sizeof(uint32_t) > c.assembly.size()))
+            return hand_all(); // not decoded: dynamic target, fault
+        const insn_t &in = c.decoded[c.decoded_at[pc] - 1];
+        int32_t *t0 = tmp[0].data(), *t1 = tmp[1].data(), *t2 = tmp[2].data();
+        int32_t *a0 = tmp[3].data(), *a1 = tmp[4].data(), *a2 = tmp[5].data();
+        ref_t r1, r2, re;
+        steps++;
+        switch (in.kind)
+        {
+        case insn_t::MOV:
+            if (resolve(in.oprandT1, in.op1, true, r1, t0, a0) && resolve(in.oprandT2, in.op2, false, r2, t1, a1))
+            {
+                commit(insn_t::MOV, r1, r2.src, r2.src);
+                advance(pc + 3 * sizeof(uint32_t));
+            }
+            return;
+        case insn_t::MOVE:
+            if (resolve(in.oprandT2, in.op1, false, r1, t0, a0))
+            {
+                if (in.oprandT2 == oprand_t::IMM && esp_same)
+                    esp_value = in.op1;
+                else
+                    set_esp(r1.src, 0);
+                advance(pc + 2 * sizeof(uint32_t));
+            }
+            return;
+        case insn_t::XCHG:
+            if (resolve(in.oprandT1, in.op1, true, r1, t0, a0) && resolve(in.oprandT2, in.op2, true, r2, t1, a1))
+            {
+                std::memcpy(t2, r1.src, stride * sizeof(int32_t));
+                commit(insn_t::MOV, r1, r2.src, r2.src); // whole words: the same word or another one
+                commit(insn_t::MOV, r2, t2, t2);
+                advance(pc + 3 * sizeof(uint32_t));
+            }
+            return;
+        case insn_t::INC:
+        case insn_t::DEC:
+        case insn_t::NEG:
+            if (resolve(in.oprandT1, in.op1, true, r1, t0, a0))
+            {
+                commit(in.kind, r1, r1.src, r1.src);
+                advance(pc + 2 * sizeof(uint32_t));
+            }
+            return;
+        case insn_t::ADD: case insn_t::SUB: case insn_t::MUL: case insn_t::DIV:
+        case insn_t::AND: case insn_t::OR: case insn_t::XOR: case insn_t::SHL:
+        case insn_t::CMP: case insn_t::CMPG: case insn_t::CMPGE:
+            if (resolve(in.oprandT1, in.op1, false, r1, t0, a0) && resolve(in.oprandT2, in.op2, false, r2, t1, a1) &&
+                resolve_esp(re, t2, a2))
+            {
+                if (in.kind == insn_t::DIV) // a zero divisor faults, INT_MIN / -1 traps: the interpreter's job
+                    for (size_t l = 0; l < count; l++)
+                        if (mask[l] != 0 && (r2.src[l] == 0 || (r2.src[l] == -1 && r1.src[l] == INT32_MIN)))
+                            hand(l);
+                if (running == 0)
+                    return;
+                commit(in.kind, re, r1.src, r2.src);
+                advance(pc + 3 * sizeof(uint32_t));
+            }
+            return;
+        case insn_t::NOT:
+        case insn_t::PUSH:
+            if (resolve(in.oprandT1, in.op1, false, r1, t0, a0) && resolve_esp(re, t2, a2))
+            {
+                commit(in.kind, re, r1.src, r1.src);
+                if (in.kind == insn_t::PUSH)
+                    set_esp(nullptr, 4);
+                advance(pc + 2 * sizeof(uint32_t));
+            }
+            return;
+        case insn_t::POP:
+            for (size_t l = 0; l < count; l++)
+                if (mask[l] != 0 && static_cast<uint32_t>(esp_of(l)) < 4)
+                    hand(l);
+            if (running == 0)
+                return;
+            set_esp(nullptr, -4);
+            advance(pc + sizeof(uint32_t));
+            return;
+        case insn_t::JMP:
+            if (resolve(in.oprandT1, in.op1, false, r1, t0, a0))
+                branch(r1.src, nullptr, 0);
+            return;
+        case insn_t::JZ:
+        case insn_t::JNZ:
+            if (resolve(in.oprandT1, in.op1, false, r1, t0, a0) && resolve_esp(re, t2, a2))
+            {
+                for (size_t l = 0; l < count; l++)
+                    t1[l] = (re.src[l] == 0) == (in.kind == insn_t::JZ);
+                branch(r1.src, t1, pc + 2 * sizeof(uint32_t));
+            }
+            return;
+        case insn_t::RET:
+            for (size_t l = 0; l < count; l++)
+                if (mask[l] != 0)
+                {
+                    lanes[l] = BATCH_DONE;
+                    mask[l] = 0;
+                    eip[l] = pc;
+                    if (esp_same)
+                        esp[l] = esp_value;
+                    running--;
+                }
+            return;
+        case insn_t::NOP:
+        case insn_t::YIELD: // no exec_t, a NOP as in operator()
+            advance(pc + sizeof(uint32_t));
+            return;
+        default: // CALL, CALLEXT, ALLOC, FREE, INT, #Undefined Opcode
+            steps--;
+            return hand_all();
+        }
+    }
+
+    inline bool batch_t::run(elf_t *const *instances, size_t n, size_t index)
+    {
+        results.assign(n, 0);
+        elfs.assign(instances, instances + n);
+        func = index;
+        count = n;
+        stride = (n + 7) & ~size_t(7);
+        lanes.assign(stride, BATCH_ALONE);
+        mask.assign(stride, 0);
+        running = 0;
+        if (n != 0 && elfs[0] != nullptr && func < elfs[0]->text.size())
+        {
+            const func_t &src = elfs[0]->text[func].code();
+            if (src.decoded.size() == 0 || src.stale) // not predecoded or written into since, decode assembly as it is
+            {
+                source = nullptr;
+                code.assembly = src.assembly;
+                code.compact = src.compact;
+                code.EIP_Begin = src.EIP_Begin;
+                code.predecode();
+            }
+            else if (source != &src || generation != src.generation)
+            {
+                source = &src;
+                generation = src.generation;
+                code.assembly = src.assembly;
+                code.compact = src.compact;
+                code.EIP_Begin = src.EIP_Begin;
+                code.decoded = src.decoded;
+                code.decoded_at = src.decoded_at;
+                code.code_lo = src.code_lo;
+                code.code_len = src.code_len;
+            }
+            arows = static_cast<uint32_t>(code.assembly.size() / 4);
+            drows = static_cast<uint32_t>(elfs[0]->data.size() / 4);
+            mem.assign((arows + drows) * stride, 0);
+            written.assign(arows + drows, 0);
+            for (size_t l = 0; l < n; l++)
+                if (fits(elfs[l]))
+                {
+                    lanes[l] = BATCH_RUN;
+                    mask[l] = -1;
+                    load(l);
+                    running++;
+                }
+        }
+        eip.assign(stride, code.EIP_Begin);
+        esp.assign(stride, 0);
+        for (auto &it : tmp)
+            it.assign(stride, 0);
+        converged = true;
+        pc = code.EIP_Begin;
+        esp_same = true;
+        esp_value = 0;
+        while (running != 0)
+        {
+            if (!converged)
+                converge();
+            step();
+        }
+        bool all = true;
+        for (size_t l = 0; l < n; l++)
+        {
+            elf_t *elf = elfs[l];
+            if (lanes[l] == BATCH_ALONE)
+            {
+                results[l] = elf != nullptr && func < elf->text.size() && elf->text[func](elf, nullptr);
+                all = all && results[l] != 0;
+                continue;
+            }
+            func_t &f = fn(l);
+            store(l);
+            f.elf_local = elf;
+            f.caller = nullptr;
+            f.fault = fault_t::NONE;
+            results[l] = lanes[l] == BATCH_DONE || f.resume(nullptr) == state_t::RET || f.fail();
+            all = all && results[l] != 0;
+        }
+        return all;
+    }
+}
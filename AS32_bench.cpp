@@ -0,0 +1,80 @@
+// benchmark executable, see asc_benchsuite() in AS32_bench.h
+//	AS32_bench [--filter text] [--reps n] [--save file] [--check file] [--tolerance 0.1] [--all] [--profile]
+//	--save writes the results as a baseline, --check exits 1 on a case slower than baseline x (1 + tolerance),
+//	--all runs asc_benchmain() afterwards, --profile prints the AS32_profile.h report of the suite
+//	exits 1 if a case or a check of --all failed, the build registers --reps 1 --all as its test
+#include <cstdlib>
+#include "AS32_bench.h"
+#include "AS32_profile.h"
+
+int main(int argc, char** argv)
+{
+	std::string filter;
+	const char* save = nullptr;
+	const char* check = nullptr;
+	double tolerance = 0.1;
+	int reps = 3;
+	bool all = false;
+	bool profile = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool value = i + 1 < argc;
+		if (arg == "--filter" && value)
+			filter = argv[++i];
+		else if (arg == "--reps" && value)
+			reps = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--save" && value)
+			save = argv[++i];
+		else if (arg == "--check" && value)
+			check = argv[++i];
+		else if (arg == "--tolerance" && value)
+			tolerance = std::atof(argv[++i]);
+		else if (arg == "--all")
+			all = true;
+		else if (arg == "--profile")
+			profile = true;
+		else
+		{
+			std::printf("usage: %s [--filter text] [--reps n] [--save file] [--check file] [--tolerance 0.1] [--all] [--profile]\n", argv[0]);
+			return 2;
+		}
+	}
+	asc::profile_t profiler;
+	if (profile)
+	{
+		if (asc::profile_t::enabled == false)
+			std::printf("--profile: built without AS32_PROFILE, nothing is recorded\n");
+		profiler.start();
+	}
+	std::vector<asc_bench_case_t> cases = asc_benchsuite(filter, reps);
+	profiler.stop();
+	asc_bench_print(cases);
+	if (profile)
+	{
+		std::string report;
+		profiler.report(report);
+		std::printf("%s", report.c_str());
+	}
+	bool passed = true;
+	for (auto& c : cases)
+		passed = c.ok && passed;
+	if (all)
+		passed = asc_benchmain() && passed;
+	if (save != nullptr && asc_bench_save(cases, save) == false)
+	{
+		std::printf("cannot write %s\n", save);
+		return 1;
+	}
+	if (check != nullptr && asc_bench_check(cases, check, tolerance) == false)
+	{
+		std::printf("check against %s failed\n", check);
+		return 1;
+	}
+	if (passed == false)
+	{
+		std::printf("failed\n");
+		return 1;
+	}
+	return 0;
+}
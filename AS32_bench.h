@@ -0,0 +1,1783 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "AS32_batch.h"
+#include "AS32_compact.h"
+#include "AS32_hash.h"
+#include "AS32_image.h"
+#include "AS32_jit.h"
+#include "AS32_link.h"
+#include "AS32_pool.h"
+#include "AS32_reload.h"
+#include "AS32_sync.h"
+#include "AS32_trace.h"
+#include "AS32_trigger.h"
+
+// append one instruction to an assembly byte area, operands are written only when the opcode has them.
+inline void asc_emit(asc::bytes_t& a, asc::opcode_t opcode, asc::oprand_t t1 = asc::oprand_t::IMM, asc::oprand_t t2 = asc::oprand_t::IMM, int opn = 0, int32_t op1 = 0, int32_t op2 = 0)
+{
+	uint16_t code = static_cast<uint16_t>(opcode);
+	a.push_back(code & 0xff);
+	a.push_back(code >> 8);
+	a.push_back(static_cast<uint8_t>(t1));
+	a.push_back(static_cast<uint8_t>(t2));
+	for (int i = 0; i < opn; i++)
+	{
+		uint32_t v = static_cast<uint32_t>(i == 0 ? op1 : op2);
+		for (int j = 0; j < 4; j++)
+			a.push_back((v >> (8 * j)) & 0xff);
+	}
+}
+
+// counter loop, 4 instructions per round:
+//	{0}  int i;  {4} scratch [ESP]
+//	MOVE 4;  loop: ADD [0], 1; MOV [0], [ESP]; CMPG rounds, [0]; JNZ loop; RET
+inline void asc_bench_loop(asc::func_t& f, int32_t rounds)
+{
+	using namespace asc;
+	f.assembly.assign(16, 0);
+	f.EIP_Begin = 16;
+	asc_emit(f.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+	int32_t loop = static_cast<int32_t>(f.assembly.size());
+	asc_emit(f.assembly, opcode_t::ADD, oprand_t::IA, oprand_t::IMM, 2, 0, 1);
+	asc_emit(f.assembly, opcode_t::MOV, oprand_t::IA, oprand_t::ESP_IA, 2, 0, 0);
+	asc_emit(f.assembly, opcode_t::CMPG, oprand_t::IMM, oprand_t::IA, 2, rounds, 0);
+	asc_emit(f.assembly, opcode_t::JNZ, oprand_t::IMM, oprand_t::IMM, 1, loop);
+	asc_emit(f.assembly, opcode_t::RET);
+	f.assembly.resize(f.assembly.size() + 8, 0); // padding
+}
+
+// the callee writes the IMM operand of the instruction after the CALL through EBP_IA, rounds times:
+//	{0} i  {8} written	do { CALL 1; MOV [8], 0; } while (++i < rounds)	function 1: MOV [EBP + at], 7; RET
+inline void asc_bench_patch_caller(asc::elf_t& elf, int32_t rounds)
+{
+	using namespace asc;
+	elf.text.resize(2);
+	bytes_t& a = elf.text[0].assembly;
+	a.assign(12, 0);
+	elf.text[0].EIP_Begin = 12;
+	asc_emit(a, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+	int32_t loop = static_cast<int32_t>(a.size());
+	asc_emit(a, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1);
+	int32_t at = static_cast<int32_t>(a.size()) + 8 - 4; // from ESP 4
+	asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::IMM, 2, 8, 0);
+	asc_emit(a, opcode_t::ADD, oprand_t::IA, oprand_t::IMM, 2, 0, 1);
+	asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::ESP_IA, 2, 0, 0);
+	asc_emit(a, opcode_t::CMPG, oprand_t::IMM, oprand_t::IA, 2, rounds, 0);
+	asc_emit(a, opcode_t::JNZ, oprand_t::IMM, oprand_t::IMM, 1, loop);
+	asc_emit(a, opcode_t::RET);
+	a.resize(a.size() + 8, 0);
+	bytes_t& b = elf.text[1].assembly;
+	asc_emit(b, opcode_t::MOV, oprand_t::EBP_IA, oprand_t::IMM, 2, at, 7);
+	asc_emit(b, opcode_t::RET);
+	b.resize(b.size() + 8, 0);
+}
+
+inline double asc_bench_run(asc::elf_t& elf, int times, bool& ok)
+{
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < times; i++)
+	{
+		*(int32_t*)&elf.text[0].assembly[0] = 0;
+		if (elf() == false)
+		{
+			std::cout << "failed!" << std::endl;
+			ok = false;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+// the binary operation path before binary_table: generic addressing twice, then a switch on the opcode.
+inline bool asc_bench_generic(asc::func_t* f, asc::opcode_t opcode, asc::oprand_t t1, asc::oprand_t t2, int32_t op1, int32_t op2)
+{
+	using namespace asc;
+	int32_t* espad;
+	int32_t lv;
+	int32_t lv2;
+	if (!(f->addressing_r(t1, op1, lv) && f->addressing_r(t2, op2, lv2) && f->addressing_esp_w(espad)))
+		return false;
+	switch (opcode)
+	{
+	case opcode_t::ADD: *espad = lv + lv2; break;
+	case opcode_t::SUB: *espad = lv - lv2; break;
+	case opcode_t::MUL: *espad = lv * lv2; break;
+	case opcode_t::DIV: if (lv2 == 0) return false; *espad = lv / lv2; break;
+	case opcode_t::AND: *espad = lv & lv2; break;
+	case opcode_t::OR: *espad = lv | lv2; break;
+	case opcode_t::XOR: *espad = lv ^ lv2; break;
+	case opcode_t::SHL: if (lv2 > 0) *espad = lv << lv2; else if (lv2 < 0) *espad = lv >> -lv2; break;
+	case opcode_t::CMP: *espad = lv == lv2; break;
+	case opcode_t::CMPG: *espad = lv > lv2; break;
+	case opcode_t::CMPGE: *espad = lv >= lv2; break;
+	default: return false;
+	}
+	return true;
+}
+
+// one binary operation executed in place the way asc_testmain's function sees it, [ESP] at 22.
+// modes are decoded from the instruction bytes on every round, as the interpreter does.
+inline bool asc_bench_binary(asc::opcode_t opcode, asc::oprand_t t1, asc::oprand_t t2)
+{
+	using namespace asc;
+	static const char* opcodes[] = { "ADD", "SUB", "MUL", "DIV", "AND", "OR", "XOR", "SHL", "CMP", "CMPG", "CMPGE" };
+	static const char* oprands[] = { "IMM", "IA", "ESP", "ESP_IA", "EBP", "EBP_IA", "DATA_IA" };
+	static const int32_t operands[] = { 3, 18, 0, -4, 0, 0, 4 };
+	const int rounds = 2000000;
+
+	elf_t elf;
+	elf.data.assign(16, 1);
+	func_t caller = {};
+	caller.assembly.assign(16, 2);
+	func_t f = {};
+	f.elf_local = &elf;
+	f.caller = &caller;
+	f.ESP = 22;
+	f.assembly.assign(32, 0);
+	f.assembly[18] = 5;
+	f.assembly.resize(40, 0);
+	asc_emit(f.assembly, opcode, t1, t2, 2, operands[static_cast<int>(t1)], operands[static_cast<int>(t2)]);
+	const size_t at = 40;
+
+	bool ok = true;
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++)
+	{
+		opcode_t op = *(opcode_t*)&f.assembly[at];
+		oprand_t o1 = *(oprand_t*)&f.assembly[at + 2];
+		oprand_t o2 = *(oprand_t*)&f.assembly[at + 3];
+		ok = asc_bench_generic(&f, op, o1, o2, *(int32_t*)&f.assembly[at + 4], *(int32_t*)&f.assembly[at + 8]) && ok;
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++)
+	{
+		opcode_t op = *(opcode_t*)&f.assembly[at];
+		oprand_t o1 = *(oprand_t*)&f.assembly[at + 2];
+		oprand_t o2 = *(oprand_t*)&f.assembly[at + 3];
+		binary_t binary = binary_find<false>(op, o1, o2);
+		ok = binary != nullptr && binary(&f, *(int32_t*)&f.assembly[at + 4], *(int32_t*)&f.assembly[at + 8]) != asc::binary_fault && ok;
+	}
+	auto end = std::chrono::steady_clock::now();
+	std::cout << opcodes[binary_index[static_cast<uint8_t>(opcode)]] << "<" << oprands[static_cast<int>(t1)] << ", " << oprands[static_cast<int>(t2)] << ">: "
+		<< std::chrono::duration<double, std::nano>(middle - begin).count() / rounds << " ns generic, "
+		<< std::chrono::duration<double, std::nano>(end - middle).count() / rounds << " ns specialized"
+		<< (ok ? "" : " (failed)") << std::endl;
+	return ok;
+}
+
+// function 0 calls function 1 twice, which writes into the caller's [ESP] through EBP_IA
+inline void asc_bench_calls(asc::elf_t& elf)
+{
+	using namespace asc;
+	elf.text.resize(2);
+	func_t& f0 = elf.text[0];
+	f0.assembly.assign(8, 0);
+	f0.EIP_Begin = 8;
+	asc_emit(f0.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+	asc_emit(f0.assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1);
+	asc_emit(f0.assembly, opcode_t::ADD, oprand_t::IA, oprand_t::IA, 2, 0, 4);
+	asc_emit(f0.assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1);
+	asc_emit(f0.assembly, opcode_t::RET);
+	f0.assembly.resize(f0.assembly.size() + 8, 0);
+	func_t& f1 = elf.text[1];
+	f1.assembly.assign(8, 0);
+	f1.EIP_Begin = 8;
+	asc_emit(f1.assembly, opcode_t::MOV, oprand_t::EBP_IA, oprand_t::IMM, 2, -4, 3);
+	asc_emit(f1.assembly, opcode_t::PUSH, oprand_t::IMM, oprand_t::IMM, 1, 7);
+	asc_emit(f1.assembly, opcode_t::RET);
+	f1.assembly.resize(f1.assembly.size() + 8, 0);
+}
+
+// function 1 adds n down to 1 into data {0} and recurses with n - 1. after returning it adds its own n into
+// data {4} again, which only holds up when every activation keeps its own stack.
+//	main: MOVE 0; PUSH n; CALL 1; RET
+//	rec:  MOVE 0; PUSH [EBP-4]; ADD {0}, [0]; MOV {0}, [ESP]; SUB [0], 1; JZ end; MOVE 8; CALL 1;
+//	      end: MOVE 4; ADD {4}, [0]; MOV {4}, [ESP]; RET
+inline void asc_bench_recursion(asc::elf_t& elf, int32_t n)
+{
+	using namespace asc;
+	elf.data.assign(8, 0);
+	elf.text.resize(2);
+	func_t& main = elf.text[0];
+	main.assembly.assign(8, 0);
+	main.EIP_Begin = 8;
+	asc_emit(main.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 0);
+	asc_emit(main.assembly, opcode_t::PUSH, oprand_t::IMM, oprand_t::IMM, 1, n);
+	asc_emit(main.assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1);
+	asc_emit(main.assembly, opcode_t::RET);
+	main.assembly.resize(main.assembly.size() + 8, 0);
+	func_t& rec = elf.text[1];
+	rec.assembly.assign(16, 0);
+	rec.EIP_Begin = 16;
+	asc_emit(rec.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 0);
+	asc_emit(rec.assembly, opcode_t::PUSH, oprand_t::EBP_IA, oprand_t::IMM, 1, -4);
+	asc_emit(rec.assembly, opcode_t::ADD, oprand_t::DATA_IA, oprand_t::IA, 2, 0, 0);
+	asc_emit(rec.assembly, opcode_t::MOV, oprand_t::DATA_IA, oprand_t::ESP_IA, 2, 0, 0);
+	asc_emit(rec.assembly, opcode_t::SUB, oprand_t::IA, oprand_t::IMM, 2, 0, 1);
+	size_t jz = rec.assembly.size();
+	asc_emit(rec.assembly, opcode_t::JZ, oprand_t::IMM, oprand_t::IMM, 1, 0);
+	asc_emit(rec.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 8);
+	asc_emit(rec.assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1);
+	*(int32_t*)&rec.assembly[jz + 4] = static_cast<int32_t>(rec.assembly.size());
+	asc_emit(rec.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+	asc_emit(rec.assembly, opcode_t::ADD, oprand_t::DATA_IA, oprand_t::IA, 2, 4, 0);
+	asc_emit(rec.assembly, opcode_t::MOV, oprand_t::DATA_IA, oprand_t::ESP_IA, 2, 4, 0);
+	asc_emit(rec.assembly, opcode_t::RET);
+	rec.assembly.resize(rec.assembly.size() + 8, 0);
+}
+
+// a random program for jit_diff(): 1 to 3 functions, each with 1024 scratch bytes below its code, which is
+// all that IA, ESP_IA and EBP_IA operands can reach in the run, and forward jumps only. every CALL, to itself
+// and back into an active function too, is guarded by a countdown in data {0}, which nothing else addresses,
+// so the calls run out and the run ends:
+//	DEC {0}; CMPGE {0}, 0; JZ next; CALL k; next:
+inline void asc_bench_random(asc::elf_t& elf, uint32_t seed)
+{
+	using namespace asc;
+	static const opcode_t opcodes[] = {
+		opcode_t::MOV, opcode_t::MOVE, opcode_t::XCHG, opcode_t::ADD, opcode_t::SUB, opcode_t::MUL, opcode_t::DIV,
+		opcode_t::INC, opcode_t::DEC, opcode_t::NEG, opcode_t::AND, opcode_t::OR, opcode_t::XOR, opcode_t::NOT,
+		opcode_t::SHL, opcode_t::PUSH, opcode_t::POP, opcode_t::JMP, opcode_t::JZ, opcode_t::JNZ, opcode_t::CALL,
+		opcode_t::RET, opcode_t::NOP, opcode_t::CMP, opcode_t::CMPG, opcode_t::CMPGE };
+	static const oprand_t modes[] = { oprand_t::IMM, oprand_t::IA, oprand_t::ESP, oprand_t::ESP_IA, oprand_t::EBP_IA, oprand_t::DATA_IA };
+	const int32_t scratch = 1024;
+	auto r = [&seed](int n) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % static_cast<uint32_t>(n));
+	};
+	auto operand = [&r](oprand_t mode) -> int32_t {
+		switch (mode)
+		{
+		case oprand_t::IMM: return r(4) == 0 ? r(200) - 100 : r(8) - 2;
+		case oprand_t::IA: return 4 * r(scratch / 4);
+		case oprand_t::ESP: return r(16);
+		case oprand_t::ESP_IA: return 4 * r(6) - 8;
+		case oprand_t::EBP_IA: return 4 * r(10) - 4;
+		default: return 4 + 4 * r(16); // DATA_IA, one past the end too
+		}
+	};
+	elf.data.assign(64, 0);
+	for (size_t i = 4; i < elf.data.size(); i++)
+		elf.data[i] = static_cast<uint8_t>(r(256));
+	*(int32_t*)&elf.data[0] = 2 + r(5);
+	int funcs = 1 + r(3);
+	elf.text.resize(funcs);
+	for (int k = 0; k < funcs; k++)
+	{
+		func_t& f = elf.text[k];
+		f.assembly.assign(scratch, 0);
+		for (auto& b : f.assembly)
+			if (r(4) == 0)
+				b = static_cast<uint8_t>(r(256));
+		f.EIP_Begin = scratch;
+		int n = 4 + r(12);
+		std::vector<int32_t> starts;
+		std::vector<std::pair<size_t, int>> jumps; // operand at, target instruction
+		for (int i = 0; i < n; i++)
+		{
+			starts.push_back(static_cast<int32_t>(f.assembly.size()));
+			opcode_t opcode = opcodes[r(sizeof(opcodes) / sizeof(opcodes[0]))];
+			oprand_t t1 = modes[r(6)];
+			oprand_t t2 = modes[r(6)];
+			switch (opcode)
+			{
+			case opcode_t::MOVE:
+				asc_emit(f.assembly, opcode, oprand_t::IMM, oprand_t::IMM, 1, 4 * r(17));
+				break;
+			case opcode_t::JMP: case opcode_t::JZ: case opcode_t::JNZ:
+				jumps.push_back({ f.assembly.size() + 4, i + 1 + r(n - i) });
+				asc_emit(f.assembly, opcode, oprand_t::IMM, oprand_t::IMM, 1, 0);
+				break;
+			case opcode_t::CALL:
+			{
+				asc_emit(f.assembly, opcode_t::DEC, oprand_t::DATA_IA, oprand_t::IMM, 1, 0);
+				asc_emit(f.assembly, opcode_t::CMPGE, oprand_t::DATA_IA, oprand_t::IMM, 2, 0, 0);
+				size_t jz = f.assembly.size();
+				asc_emit(f.assembly, opcode_t::JZ, oprand_t::IMM, oprand_t::IMM, 1, 0);
+				asc_emit(f.assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, r(funcs));
+				*(int32_t*)&f.assembly[jz + 4] = static_cast<int32_t>(f.assembly.size());
+			}
+			break;
+			case opcode_t::POP: case opcode_t::RET: case opcode_t::NOP:
+				asc_emit(f.assembly, opcode);
+				break;
+			case opcode_t::INC: case opcode_t::DEC: case opcode_t::NEG: case opcode_t::NOT: case opcode_t::PUSH:
+				asc_emit(f.assembly, opcode, t1, oprand_t::IMM, 1, operand(t1));
+				break;
+			default:
+				asc_emit(f.assembly, opcode, t1, t2, 2, operand(t1), operand(t2));
+				break;
+			}
+		}
+		starts.push_back(static_cast<int32_t>(f.assembly.size()));
+		asc_emit(f.assembly, opcode_t::RET);
+		f.assembly.resize(f.assembly.size() + 8, 0);
+		for (auto& it : jumps)
+			*(int32_t*)&f.assembly[it.first] = starts[it.second];
+	}
+}
+
+// a trigger: when data {0} was raised, count it down into data {4}, then wait (CALLEXT wait) for the next write
+// to data {0}. outside a trigger_t the wait does nothing and the script polls.
+//	MOVE 0; CMPG {0}, 0; JZ idle; DEC {0}; INC {4}; idle: MOV [0], 0; CALLEXT wait; RET
+inline void asc_bench_trigger(asc::func_t& f, int32_t wait)
+{
+	using namespace asc;
+	f.assembly.assign(8, 0);
+	f.EIP_Begin = 8;
+	asc_emit(f.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 0);
+	asc_emit(f.assembly, opcode_t::CMPG, oprand_t::DATA_IA, oprand_t::IMM, 2, 0, 0);
+	size_t jz = f.assembly.size();
+	asc_emit(f.assembly, opcode_t::JZ, oprand_t::IMM, oprand_t::IMM, 1, 0);
+	asc_emit(f.assembly, opcode_t::DEC, oprand_t::DATA_IA, oprand_t::IMM, 1, 0);
+	asc_emit(f.assembly, opcode_t::INC, oprand_t::DATA_IA, oprand_t::IMM, 1, 4);
+	*(int32_t*)&f.assembly[jz + 4] = static_cast<int32_t>(f.assembly.size());
+	asc_emit(f.assembly, opcode_t::MOV, oprand_t::IA, oprand_t::IMM, 2, 0, 0);
+	asc_emit(f.assembly, opcode_t::CALLEXT, oprand_t::IMM, oprand_t::IMM, 1, wait);
+	asc_emit(f.assembly, opcode_t::RET);
+	f.assembly.resize(f.assembly.size() + 8, 0);
+}
+
+// asc_bench_loop with a CALL of function 1, which only returns, in every round
+inline void asc_bench_call_loop(asc::elf_t& elf, int32_t rounds)
+{
+	using namespace asc;
+	elf.text.resize(2);
+	func_t& f = elf.text[0];
+	f.assembly.assign(16, 0);
+	f.EIP_Begin = 16;
+	asc_emit(f.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+	int32_t loop = static_cast<int32_t>(f.assembly.size());
+	asc_emit(f.assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1);
+	asc_emit(f.assembly, opcode_t::ADD, oprand_t::IA, oprand_t::IMM, 2, 0, 1);
+	asc_emit(f.assembly, opcode_t::MOV, oprand_t::IA, oprand_t::ESP_IA, 2, 0, 0);
+	asc_emit(f.assembly, opcode_t::CMPG, oprand_t::IMM, oprand_t::IA, 2, rounds, 0);
+	asc_emit(f.assembly, opcode_t::JNZ, oprand_t::IMM, oprand_t::IMM, 1, loop);
+	asc_emit(f.assembly, opcode_t::RET);
+	f.assembly.resize(f.assembly.size() + 8, 0);
+	func_t& leaf = elf.text[1];
+	leaf.assembly.clear();
+	asc_emit(leaf.assembly, opcode_t::RET);
+	leaf.assembly.resize(leaf.assembly.size() + 8, 0);
+}
+
+// the call loop above with the leaf moved into lib and called as import 0
+inline void asc_bench_import_loop(asc::elf_t& elf, asc::elf_t& lib, int32_t rounds)
+{
+	asc_bench_call_loop(elf, rounds);
+	int32_t import = -1;
+	std::memcpy(&elf.text[0].assembly[elf.text[0].EIP_Begin + 12], &import, sizeof(import));
+	lib.text.resize(1);
+	lib.text[0].assembly = elf.text[1].assembly;
+	std::strcpy(lib.name, "lib");
+	std::strcpy(elf.name, "main");
+	elf.dependency.push_back({ "lib", nullptr });
+	elf.imports.push_back({ 0, 0, nullptr });
+}
+
+// host function a + b, unmarshalled by hand and typed
+inline bool asc_bench_add_by_hand(asc::func_t* caller)
+{
+	int32_t* a;
+	int32_t* b;
+	if (caller->addressing_esp_w(a) == false || caller->addressing_w(asc::oprand_t::ESP_IA, 4, b) == false)
+		return false;
+	*a = *a + *b;
+	return true;
+}
+inline int32_t asc_bench_add(int32_t a, int32_t b)
+{
+	return a + b;
+}
+
+// the older comparisons, one function per feature: each prints its timings and returns false if a result was
+// wrong, asc_benchmain() runs all of them.
+
+// the counter loop on every engine, tracked and traced
+inline bool asc_benchmain_engines()
+{
+	const int32_t rounds = 1000000;
+	const int times = 20;
+	const double insns = (4.0 * rounds + 2) * times;
+	bool passed = true;
+
+	asc::elf_t elf;
+	elf.text.push_back({});
+	asc_bench_loop(elf.text[0], rounds);
+
+	double ns = asc_bench_run(elf, times, passed);
+	std::cout << "switch:   " << ns / insns << " ns/instruction" << std::endl;
+
+	elf.predecode();
+	ns = asc_bench_run(elf, times, passed);
+	std::cout << "threaded: " << ns / insns << " ns/instruction" << std::endl;
+
+	if (elf.verify() == false)
+	{
+		std::cout << "verify failed!" << std::endl;
+		passed = false;
+	}
+	ns = asc_bench_run(elf, times, passed);
+	std::cout << "verified: " << ns / insns << " ns/instruction, " << elf.text[0].fused << " superinstructions" << std::endl;
+
+	const void* const* plain = nullptr;
+	elf.text[0].run_decoded<true>(nullptr, 0, &plain);
+	if (plain != nullptr)
+	{
+		for (auto& it : elf.text[0].decoded)
+			it.handler = plain[it.kind];
+		ns = asc_bench_run(elf, times, passed);
+		std::cout << "unfused:  " << ns / insns << " ns/instruction" << std::endl;
+		elf.text[0].fuse();
+	}
+
+	asc::jit_t jit;
+	if (jit.compile(elf))
+	{
+		ns = asc_bench_run(elf, times, passed);
+		std::cout << "jit:      " << ns / insns << " ns/instruction" << std::endl;
+	}
+	else
+		std::cout << "jit:      unavailable" << std::endl;
+	bool compiled = false;
+	bool same = asc::jit_diff([](asc::elf_t& e) { e.text.push_back({}); asc_bench_loop(e.text[0], 1000); }, &compiled) && asc::jit_diff(asc_bench_calls)
+		&& asc::jit_diff([](asc::elf_t& e) { asc_bench_recursion(e, 20); });
+	for (uint32_t seed = 0; seed < 1000 && same; seed++)
+	{
+		same = asc::jit_diff([seed](asc::elf_t& e) { asc_bench_random(e, seed); });
+		if (same == false)
+			std::cout << "jit diff: random program " << seed << " differs" << std::endl;
+	}
+	std::cout << "jit diff: " << (same ? "identical" : "MISMATCH") << (compiled ? "" : " (interpreted)") << std::endl;
+	passed = same && passed;
+	// a native callee writing through EBP_IA into the code of a caller run from its compact stream expands the
+	// caller, which goes on interpreted, on the recursive engine and on exec_t frames alike
+	for (int frames = 0; frames < 2; frames++)
+	{
+		asc::elf_t plain, packed;
+		asc_bench_patch_caller(plain, 100);
+		asc_bench_patch_caller(packed, 100);
+		std::vector<uint8_t> stream;
+		asc::compact(packed.text[0], stream);
+		same = asc::compact_load(packed.text[0], stream.data(), stream.size()) && packed.text[0].in_stream();
+		same = plain.verify() && packed.verify() && same;
+		asc::jit_t patching;
+		patching.compile(packed);
+		asc::exec_t exec;
+		same = (frames == 0 ? plain() && packed() : plain(exec) && packed(exec)) && same;
+		same = same && packed.text[0].in_stream() == false && packed.text[0].assembly == plain.text[0].assembly;
+		std::cout << "compact caller patched" << (frames == 0 ? ": " : " on frames: ") << (same ? "expanded" : "MISMATCH") << std::endl;
+		passed = same && passed;
+	}
+
+	elf.track();
+	ns = asc_bench_run(elf, times, passed);
+	std::cout << "tracked:  " << ns / insns << " ns/instruction" << std::endl;
+	elf.track(false);
+
+	// execution trace (AS32_TRACE builds): every instruction into the ring, then calls and faults only
+	if (asc::trace_t::enabled)
+	{
+		asc::trace_t trace(1 << 16);
+		trace.start();
+		ns = asc_bench_run(elf, times, passed);
+		std::cout << "traced:   " << ns / insns << " ns/instruction, " << trace.written.load() << " records" << std::endl;
+		trace.insns = false;
+		ns = asc_bench_run(elf, times, passed);
+		std::cout << "edges:    " << ns / insns << " ns/instruction" << std::endl;
+		// code run from its compact stream is traced with the same opcodes
+		asc::elf_t packed;
+		packed.text.push_back({});
+		asc_bench_loop(packed.text[0], 10);
+		std::vector<uint8_t> stream;
+		asc::compact(packed.text[0], stream);
+		std::vector<asc::trace_record_t> records;
+		trace.drain(records);
+		records.clear();
+		trace.insns = true;
+		bool same = asc::compact_load(packed.text[0], stream.data(), stream.size()) && packed.text[0].compact.size() != 0 && packed();
+		trace.drain(records);
+		for (auto& it : records)
+			same = same && (it.kind != asc::trace_record_t::INSN || it.opcode != 0);
+		same = same && records.size() > 40;
+		std::cout << "traced compact code: " << records.size() << " records" << (same ? "" : " (wrong opcodes)") << std::endl;
+		passed = same && passed;
+		trace.stop();
+	}
+	return passed;
+}
+
+// CALL/RET, imports, host calls, linking and deep recursion
+inline bool asc_benchmain_calls()
+{
+	const int32_t rounds = 1000000;
+	const int times = 20;
+	bool passed = true;
+	double ns;
+
+	// CALL/RET: one C++ frame per call against the exec_t frame stack, 6 instructions per round
+	asc::elf_t calls;
+	asc_bench_call_loop(calls, rounds);
+	calls.predecode();
+	asc::exec_t exec;
+	for (int i = 0; i < 2; i++)
+	{
+		auto begin = std::chrono::steady_clock::now();
+		for (int j = 0; j < times; j++)
+		{
+			*(int32_t*)&calls.text[0].assembly[0] = 0;
+			if ((i == 0 ? calls() : calls(exec)) == false)
+			{
+				std::cout << "failed!" << std::endl;
+				passed = false;
+			}
+		}
+		ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << (i == 0 ? "recursive calls: " : "exec_t calls:    ") << ns / (rounds * times) << " ns/round" << std::endl;
+	}
+	// AS32_TRACE builds: every CALL of the predecoded exec_t run returns in the trace as well
+	if (asc::trace_t::enabled)
+	{
+		const int32_t traced = 100;
+		asc::trace_t trace(1 << 12);
+		trace.insns = false;
+		trace.start();
+		*(int32_t*)&calls.text[0].assembly[0] = rounds - traced;
+		bool ok = calls(exec);
+		trace.stop();
+		std::vector<asc::trace_record_t> records;
+		trace.drain(records);
+		size_t entered = 0, returned = 0;
+		for (auto& it : records)
+		{
+			entered += it.kind == asc::trace_record_t::CALL;
+			returned += it.kind == asc::trace_record_t::RET;
+		}
+		ok = ok && entered == traced + 1 && returned == entered;
+		std::cout << "traced calls: " << entered << " CALL, " << returned << " RET records" << (ok ? "" : " (wrong)") << std::endl;
+		passed = ok && passed;
+	}
+
+	// import CALL checked on every call, then bound by the registry
+	asc::elf_t icalls, lib;
+	asc_bench_import_loop(icalls, lib, rounds);
+	asc::registry_t registry;
+	bool linked = registry.link({ &lib, &icalls }) && icalls.verify() && lib.verify();
+	for (int i = 0; i < 2; i++)
+	{
+		if (i == 0)
+			icalls.imports[0].rebind(nullptr);
+		else
+			asc::elf_t::bind(icalls.imports[0]);
+		auto begin = std::chrono::steady_clock::now();
+		for (int j = 0; j < times; j++)
+		{
+			*(int32_t*)&icalls.text[0].assembly[0] = 0;
+			linked = icalls() && linked;
+		}
+		ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << (i == 0 ? "import calls:    " : "bound imports:   ") << ns / (rounds * times) << " ns/round" << (linked ? "" : " (failed)") << std::endl;
+	}
+	passed = linked && passed;
+	// CALLEXT: the call loop calling a host function instead
+	asc::exttable_t host;
+	int32_t by_hand = host.add(asc_bench_add_by_hand);
+	int32_t typed = host.add<asc_bench_add>();
+	for (int i = 0; i < 2; i++)
+	{
+		asc::elf_t ext;
+		asc_bench_call_loop(ext, rounds);
+		ext.ext = &host;
+		uint16_t callext = static_cast<uint16_t>(asc::opcode_t::CALLEXT);
+		std::memcpy(&ext.text[0].assembly[ext.text[0].EIP_Begin + 8], &callext, sizeof(callext));
+		std::memcpy(&ext.text[0].assembly[ext.text[0].EIP_Begin + 12], i == 0 ? &by_hand : &typed, sizeof(int32_t));
+		linked = ext.verify();
+		auto begin = std::chrono::steady_clock::now();
+		for (int j = 0; j < times; j++)
+		{
+			*(int32_t*)&ext.text[0].assembly[0] = 0;
+			linked = ext() && linked;
+		}
+		ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << (i == 0 ? "host call by hand: " : "host call typed:   ") << ns / (rounds * times) << " ns/round" << (linked ? "" : " (failed)") << std::endl;
+		passed = linked && passed;
+	}
+	// startup: a batch of modules, each importing from the next one
+	std::deque<asc::elf_t> batch(1000);
+	std::vector<asc::elf_t*> graph;
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		std::snprintf(batch[i].name, asc::namelen, "m%06u", unsigned(i));
+		batch[i].text.resize(1);
+		if (i + 1 < batch.size())
+		{
+			batch[i].dependency.push_back({});
+			std::snprintf(batch[i].dependency[0].name, asc::namelen, "m%06u", unsigned(i + 1));
+			batch[i].imports.push_back({ 0, 0, nullptr });
+		}
+		graph.push_back(&batch[i]);
+	}
+	asc::registry_t modules;
+	auto link_begin = std::chrono::steady_clock::now();
+	linked = modules.link(graph);
+	ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - link_begin).count();
+	std::cout << "link " << batch.size() << " modules: " << ns / 1e3 << " us" << (linked ? "" : " (failed)") << std::endl;
+	passed = linked && passed;
+
+	// real recursion, the recursive engine overwrites the activations below
+	const int32_t depth = 1000;
+	asc::elf_t rec;
+	asc_bench_recursion(rec, depth);
+	bool ok = rec(exec) && *(int32_t*)&rec.data[4] == depth * (depth + 1) / 2;
+	std::cout << "recursion " << depth << ": " << (ok ? "ok" : "wrong result") << std::endl;
+	return ok && passed;
+}
+
+// instances of one verified module: one after another, on the thread pool, time sliced and in lockstep
+// divergent lanes for batch_t, data {0} x, {4} y, {8} {12} {16} {20} {24} results:
+//	{8} = x > 50 ? x + 1000 : -x;  for ({20} = x & 3; {20} > 0; {20}--) {12}++;  {24} = 1000 / y;  if (x > 90) call 1
+//	function 1: {16}++
+inline void asc_bench_divergent(asc::elf_t& elf, int32_t x, int32_t y)
+{
+	using namespace asc;
+	elf.data.assign(28, 0);
+	std::memcpy(&elf.data[0], &x, sizeof(x));
+	std::memcpy(&elf.data[4], &y, sizeof(y));
+	elf.text.resize(2);
+	asc::bytes_t& a = elf.text[0].assembly;
+	a.assign(16, 0);
+	elf.text[0].EIP_Begin = 16;
+	asc_emit(a, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+	asc_emit(a, opcode_t::CMPG, oprand_t::DATA_IA, oprand_t::IMM, 2, 0, 50);
+	asc_emit(a, opcode_t::JZ, oprand_t::IMM, oprand_t::IMM, 1, 16 + 8 + 12 + 8 + 12 + 12 + 8);
+	asc_emit(a, opcode_t::ADD, oprand_t::DATA_IA, oprand_t::IMM, 2, 0, 1000);
+	asc_emit(a, opcode_t::MOV, oprand_t::DATA_IA, oprand_t::ESP_IA, 2, 8, 0);
+	asc_emit(a, opcode_t::JMP, oprand_t::IMM, oprand_t::IMM, 1, 16 + 8 + 12 + 8 + 12 + 12 + 8 + 12 + 12);
+	asc_emit(a, opcode_t::SUB, oprand_t::IMM, oprand_t::DATA_IA, 2, 0, 0);
+	asc_emit(a, opcode_t::MOV, oprand_t::DATA_IA, oprand_t::ESP_IA, 2, 8, 0);
+	asc_emit(a, opcode_t::AND, oprand_t::DATA_IA, oprand_t::IMM, 2, 0, 3);
+	asc_emit(a, opcode_t::MOV, oprand_t::DATA_IA, oprand_t::ESP_IA, 2, 20, 0);
+	int32_t loop = static_cast<int32_t>(a.size());
+	asc_emit(a, opcode_t::CMPG, oprand_t::DATA_IA, oprand_t::IMM, 2, 20, 0);
+	asc_emit(a, opcode_t::JZ, oprand_t::IMM, oprand_t::IMM, 1, loop + 12 + 8 + 8 + 8 + 8);
+	asc_emit(a, opcode_t::DEC, oprand_t::DATA_IA, oprand_t::IMM, 1, 20);
+	asc_emit(a, opcode_t::INC, oprand_t::DATA_IA, oprand_t::IMM, 1, 12);
+	asc_emit(a, opcode_t::JMP, oprand_t::IMM, oprand_t::IMM, 1, loop);
+	asc_emit(a, opcode_t::DIV, oprand_t::IMM, oprand_t::DATA_IA, 2, 1000, 4);
+	asc_emit(a, opcode_t::MOV, oprand_t::DATA_IA, oprand_t::ESP_IA, 2, 24, 0);
+	asc_emit(a, opcode_t::CMPG, oprand_t::DATA_IA, oprand_t::IMM, 2, 0, 90);
+	int32_t end = static_cast<int32_t>(a.size()) + 8 + 8;
+	asc_emit(a, opcode_t::JZ, oprand_t::IMM, oprand_t::IMM, 1, end);
+	asc_emit(a, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1);
+	asc_emit(a, opcode_t::RET);
+	a.resize(a.size() + 8, 0);
+	asc::bytes_t& b = elf.text[1].assembly;
+	asc_emit(b, opcode_t::INC, oprand_t::DATA_IA, oprand_t::IMM, 1, 16);
+	asc_emit(b, opcode_t::RET);
+	b.resize(b.size() + 8, 0);
+}
+
+inline bool asc_benchmain_instances()
+{
+	bool passed = true, ok;
+	double ns;
+
+	const int32_t instance_rounds = 10000;
+	const int instances = 1000;
+	asc::elf_t module;
+	module.text.push_back({});
+	asc_bench_loop(module.text[0], instance_rounds);
+	module.verify();
+	std::deque<asc::context_t> contexts;
+	std::vector<asc::context_t*> run;
+	for (int i = 0; i < instances; i++)
+		run.push_back(&contexts.emplace_back(module));
+	asc::pool_t pool;
+	for (int i = 0; i < 2; i++)
+	{
+		for (auto it : run)
+			*(int32_t*)&it->elfs[0].text[0].assembly[0] = 0;
+		auto begin = std::chrono::steady_clock::now();
+		if (i == 0)
+			for (auto it : run)
+				(*it)();
+		else
+			pool.run(run);
+		ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+		ok = true;
+		for (auto it : run)
+			ok = ok && it->result && *(int32_t*)&it->elfs[0].text[0].assembly[0] == instance_rounds;
+		std::cout << "instances " << instances << (i == 0 ? " sequential:  " : " on ") << (i == 0 ? "" : std::to_string(pool.workers.size()) + " threads: ")
+			<< ns / 1e6 << " ms" << (ok ? "" : " (wrong result)") << std::endl;
+		passed = ok && passed;
+	}
+	// tasks pushing tasks from every worker at once, each one runs exactly once
+	std::atomic<int> spread{ 0 };
+	for (int i = 0; i < instances; i++)
+		pool.push([&pool, &spread] {
+			for (int j = 0; j < 10; j++)
+				pool.push([&spread] { spread++; });
+		});
+	pool.wait();
+	ok = spread == instances * 10;
+	std::cout << "pool pushes from " << pool.workers.size() << " threads: " << (ok ? "ok" : "lost tasks") << std::endl;
+	passed = ok && passed;
+	// the same instances time sliced: every tick gives each unfinished one a budget
+	const int64_t budget = 997;
+	for (auto it : run)
+		*(int32_t*)&it->elfs[0].text[0].assembly[0] = 0;
+	auto begin = std::chrono::steady_clock::now();
+	int ticks = 0;
+	for (size_t left = run.size(); left != 0; ticks++)
+	{
+		left = 0;
+		for (auto it : run)
+			if (it->exec.suspended() || ticks == 0)
+				left += it->run(budget) == asc::state_t::BUDGET;
+	}
+	ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+	ok = true;
+	for (auto it : run)
+		ok = ok && it->result && *(int32_t*)&it->elfs[0].text[0].assembly[0] == instance_rounds;
+	std::cout << "instances " << instances << " sliced by " << budget << ": " << ticks << " ticks, " << ns / 1e6 << " ms" << (ok ? "" : " (wrong result)") << std::endl;
+	passed = ok && passed;
+	// the same instances in lockstep, one lane each: AVX2 where the CPU has it, then plain lane loops
+	std::vector<asc::elf_t*> lanes;
+	for (auto it : run)
+		lanes.push_back(&it->elfs[0]);
+	asc::batch_t lockstep;
+	for (int i = 0; i < 2; i++)
+	{
+		for (auto it : run)
+			*(int32_t*)&it->elfs[0].text[0].assembly[0] = 0;
+		lockstep.vector = i == 0;
+		begin = std::chrono::steady_clock::now();
+		ok = lockstep.run(lanes);
+		ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+		for (auto it : run)
+			ok = ok && *(int32_t*)&it->elfs[0].text[0].assembly[0] == instance_rounds;
+		std::cout << "instances " << instances << " batched" << (i == 0 && asc::batch_has_avx2() ? " (avx2): " : ": ") << ns / 1e6 << " ms, "
+			<< lockstep.handed << " handed" << (ok ? "" : " (wrong result)") << std::endl;
+		passed = ok && passed;
+	}
+
+	// lanes from different data: the branches split them, a loop runs a different count per lane, a DIV by zero
+	// faults some and a CALL hands others to the interpreter. each lane must end as its own operator() run
+	ok = true;
+	uint64_t divergent_handed = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		std::deque<asc::elf_t> batched, alone;
+		lanes.clear();
+		for (int l = 0; l < 203; l++)
+			for (auto e : { &batched.emplace_back(), &alone.emplace_back() })
+			{
+				asc_bench_divergent(*e, (l * 37) % 101, l % 13);
+				if (e == &batched.back())
+					lanes.push_back(e);
+			}
+		lockstep.vector = i == 0;
+		uint64_t steps = lockstep.steps, handed = lockstep.handed;
+		lockstep.run(lanes);
+		divergent_handed = lockstep.handed - handed;
+		ok = ok && lockstep.steps != steps && divergent_handed != 0; // batched, not one by one
+		for (size_t l = 0; l < lanes.size(); l++)
+		{
+			bool result = alone[l].text[0](&alone[l], nullptr);
+			ok = ok && (lockstep.results[l] != 0) == result && batched[l].data == alone[l].data;
+			for (size_t f = 0; f < alone[l].text.size(); f++)
+			{
+				asc::func_t &a = batched[l].text[f], &b = alone[l].text[f];
+				ok = ok && a.assembly == b.assembly && a.ESP == b.ESP && a.EIP == b.EIP && a.fault == b.fault;
+			}
+		}
+	}
+	std::cout << "divergent lanes: " << divergent_handed << " of " << lanes.size() << " handed" << (ok ? "" : " (a lane differs from its own run)") << std::endl;
+	passed = ok && passed;
+	// the lockstep copy of the threaded code follows the function: predecoded again after an edit, then loaded from
+	// compact streams, where assembly holds the stack only and the second lane's stream differs from the first's
+	std::deque<asc::elf_t> edited(2);
+	lanes.clear();
+	for (auto& it : edited)
+	{
+		it.text.resize(1);
+		asc_bench_loop(it.text[0], 10);
+		it.predecode();
+		lanes.push_back(&it);
+	}
+	ok = lockstep.run(lanes);
+	std::vector<uint8_t> stream;
+	for (int32_t rounds : { 20, 30 })
+	{
+		asc_bench_loop(edited[0].text[0], rounds);
+		edited[0].predecode();
+		ok = lockstep.run(lanes) && *(int32_t*)&edited[0].text[0].assembly[0] == rounds && ok;
+	}
+	for (size_t l = 0; l < edited.size(); l++)
+	{
+		asc_bench_loop(edited[l].text[0], 40 + static_cast<int32_t>(l));
+		asc::compact_encode(edited[l].text[0].assembly, edited[l].text[0].EIP_Begin, stream);
+		ok = asc::compact_load(edited[l].text[0], stream.data(), stream.size()) && edited[l].text[0].compact.size() != 0 && ok;
+	}
+	uint64_t steps = lockstep.steps;
+	ok = lockstep.run(lanes) && lockstep.steps != steps && ok;
+	for (size_t l = 0; l < edited.size(); l++)
+		ok = *(int32_t*)&edited[l].text[0].assembly[0] == 40 + static_cast<int32_t>(l) && ok;
+	std::cout << "batched code: " << (ok ? "follows its function" : "stale") << std::endl;
+	passed = ok && passed;
+
+	// a runaway loop only costs its budget, YIELD hands control back early
+	asc::elf_t runaway;
+	runaway.text.push_back({});
+	asc_emit(runaway.text[0].assembly, asc::opcode_t::YIELD);
+	asc_emit(runaway.text[0].assembly, asc::opcode_t::JMP, asc::oprand_t::IMM, asc::oprand_t::IMM, 1, 0);
+	runaway.text[0].assembly.resize(runaway.text[0].assembly.size() + 8, 0);
+	runaway.predecode();
+	asc::exec_t slice;
+	slice.start(&runaway);
+	ok = slice.run(1000) == asc::state_t::YIELD && slice.run(1) == asc::state_t::BUDGET && slice.run(3) == asc::state_t::YIELD;
+	std::cout << "runaway loop: " << (ok ? "suspended" : "wrong state") << std::endl;
+	passed = ok && passed;
+	std::cout << "instance state: " << sizeof(asc::context_t) + sizeof(asc::elf_t) + sizeof(asc::func_t) + module.text[0].assembly.size() + module.data.size()
+		<< " bytes, module code " << module.text[0].decoded.size() * sizeof(asc::insn_t) + module.text[0].decoded_at.size() * sizeof(uint32_t) << " bytes shared" << std::endl;
+	// spawned instances: nothing is copied until the first use, which then instantiates
+	const int spawns = instances * 10;
+	std::deque<asc::context_t> spawned;
+	begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < spawns; i++)
+		spawned.emplace_back().spawn(module);
+	double spawn_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+	begin = std::chrono::steady_clock::now();
+	ok = true;
+	for (auto &it : spawned)
+		ok = it.elf() != nullptr && ok;
+	ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+	std::cout << "spawn " << spawns << ": " << spawn_ns / spawns << " ns/instance, first use " << ns / spawns << " ns/instance" << (ok ? "" : " (failed)") << std::endl;
+	passed = ok && passed;
+	// copy on write: an instance owns the assembly its run wrote, still shares the function it never entered
+	// and the data section until the host writes it, the module's bytes never change. spawn() takes an empty
+	// context_t only
+	asc::elf_t cow;
+	cow.text.resize(2);
+	asc_bench_loop(cow.text[0], 10);
+	asc_bench_loop(cow.text[1], 10);
+	cow.data.assign(64, 7);
+	cow.verify();
+	asc::context_t lazy;
+	ok = lazy.spawn(cow) && lazy.spawn(cow) == false && contexts[0].spawn(cow) == false && lazy();
+	asc::elf_t* e = lazy.elf();
+	ok = ok && e->text[0].assembly.shares() == false && *(int32_t*)e->text[0].assembly.bytes() == 10
+		&& *(int32_t*)cow.text[0].assembly.bytes() == 0 && e->text[1].assembly.bytes() == cow.text[1].assembly.bytes()
+		&& e->data.bytes() == cow.data.bytes();
+	e->data[0] = 1;
+	ok = ok && e->data.shares() == false && e->data[0] == 1 && e->data[1] == 7 && cow.data.bytes()[0] == 7;
+	std::cout << "copy on write: " << (ok ? "written bytes only" : "wrong copies") << std::endl;
+	return ok && passed;
+}
+
+// triggers: every tick the host raises data {0} of a few instances, polling runs all of them
+inline bool asc_benchmain_triggers()
+{
+	const int triggers = 10000, trigger_ticks = 100, raised = 10;
+	asc::exttable_t table;
+	std::deque<asc::context_t> polled, waiting; // outlive the trigger
+	asc::trigger_t trigger;
+	trigger.install(table);
+	asc::elf_t script;
+	script.data.assign(8, 0);
+	script.ext = &table;
+	script.text.push_back({});
+	asc_bench_trigger(script.text[0], trigger.wait_index);
+	script.predecode();
+	for (int i = 0; i < triggers; i++)
+		trigger.add(&waiting.emplace_back(script).elfs[0]), polled.emplace_back(script);
+	uint64_t fired[2] = {};
+	double trigger_ns[2] = {};
+	for (int i = 0; i < 2; i++)
+	{
+		auto &scripts = i == 0 ? polled : waiting;
+		uint32_t seed = 1;
+		auto begin = std::chrono::steady_clock::now();
+		for (int t = 0; t < trigger_ticks; t++)
+		{
+			for (int k = 0; k < raised; k++)
+			{
+				seed = seed * 1103515245 + 12345;
+				asc::elf_t &e = scripts[seed % triggers].elfs[0];
+				(*(int32_t*)&e.data[0])++;
+				e.dirty.mark(0);
+			}
+			if (i == 0)
+				for (auto &it : polled)
+					it();
+			else
+				trigger.tick();
+		}
+		trigger_ns[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+		for (auto &it : scripts)
+			fired[i] += *(int32_t*)&it.elfs[0].data[4];
+	}
+	bool ok = fired[0] == fired[1] && fired[0] == uint64_t(raised) * trigger_ticks;
+	// the instances froze the table: it takes no more host functions, a copy of it does
+	asc::exttable_t unfrozen = table;
+	ok = ok && table.add(asc_bench_add_by_hand) == -1 && unfrozen.add(asc_bench_add_by_hand) == static_cast<int32_t>(table.funcs.size());
+
+	// one trigger_t per elf: a second one is refused and leaves the first alone, which still wakes on a word
+	// of the data section grown and tracked again after it started watching
+	asc::elf_t grown;
+	grown.data.assign(8, 0);
+	asc::trigger_t first;
+	uint32_t id = first.add(&grown);
+	{
+		asc::trigger_t second;
+		ok = second.add(&grown) == UINT32_MAX && ok;
+	}
+	grown.data.assign(4096, 0);
+	grown.track();
+	asc::func_t waiter;
+	waiter.assembly.assign(16, 0);
+	*(int32_t*)&waiter.assembly[0] = 4000;
+	waiter.elf_local = &grown;
+	asc::triggering = &first;
+	first.current = id;
+	ok = asc::trigger_t::wait(&waiter) && ok;
+	asc::triggering = nullptr;
+	grown.dirty.mark(4000);
+	ok = first.woken.size() == 1 && ok;
+	std::cout << "triggers " << triggers << " x " << trigger_ticks << " ticks, polled: " << trigger_ns[0] / 1e6 << " ms, event-indexed: "
+		<< trigger_ns[1] / 1e6 << " ms, " << trigger.runs << " runs" << (ok ? "" : " (wrong result)") << std::endl;
+	return ok;
+}
+
+// binary image: save, map, load the same module many times. a load shares the mapped bytes, a run copies
+// those it writes to
+inline bool asc_benchmain_image()
+{
+	const int32_t depth = 1000;
+	const int instances = 1000;
+	const char *path = "asc_bench.as32";
+	asc::elf_t saved;
+	asc_bench_recursion(saved, depth);
+	asc::image_t image;
+	asc::exec_t exec;
+	bool ok = asc::image_t::save(saved, path) && image.open(path);
+	std::deque<asc::elf_t> loaded;
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; ok && i < instances; i++)
+		ok = image.load(loaded.emplace_back());
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+	asc::elf_t &first = loaded.back();
+	ok = ok && first.data.shares() && first.text[0].assembly.shares();
+	begin = std::chrono::steady_clock::now();
+	ok = ok && first(exec);
+	double run_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+	ok = ok && first.data.shares() == false && first.text[0].assembly.shares() == false && *(int32_t*)(first.data.bytes() + 4) == depth * (depth + 1) / 2;
+	// the run wrote to its copy, the mapping and the other modules still hold the saved bytes
+	ok = ok && loaded.front().data.shares() && loaded.front().data == saved.data && loaded.front().text[0].assembly == saved.text[0].assembly;
+	std::cout << "image " << image.size << " bytes, load (shared): " << ns / instances << " ns/module, first run (copies on write): "
+		<< run_ns / 1e3 << " us" << (ok ? "" : " (wrong result)") << std::endl;
+	loaded.clear();
+	image.close();
+	std::remove(path);
+	return ok;
+}
+
+// hot reload: threads keep calling into "lib" while it is replaced, version v of its function k writes v
+// into [0] of the caller. a thread must never see an older version again, nor one older than the last
+// reload that returned before its run began.
+inline bool asc_benchmain_reload()
+{
+	const int reloads = 100, reloaders = 3;
+	asc::registry_t libs;
+	asc::epoch_t epochs;
+	std::deque<asc::elf_t> versions, apps;
+	auto version = [&](int32_t v, bool yield = false) {
+		asc::elf_t &e = versions.emplace_back();
+		std::strncpy(e.name, "lib", asc::namelen);
+		e.text.resize(reloaders);
+		for (auto &f : e.text)
+		{
+			if (yield)
+				asc_emit(f.assembly, asc::opcode_t::YIELD);
+			asc_emit(f.assembly, asc::opcode_t::MOV, asc::oprand_t::EBP_IA, asc::oprand_t::IMM, 2, -4, v);
+			asc_emit(f.assembly, asc::opcode_t::RET);
+			f.assembly.resize(f.assembly.size() + 8, 0);
+		}
+		e.verify();
+		return &e;
+	};
+	bool ok = libs.add(version(1));
+	for (int k = 0; k < reloaders; k++)
+	{
+		asc::elf_t &app = apps.emplace_back();
+		std::snprintf(app.name, asc::namelen, "app%d", k);
+		app.dependency.push_back({ "lib", nullptr });
+		app.imports.push_back({ 0, k, nullptr });
+		app.text.push_back({});
+		app.text[0].assembly.assign(8, 0);
+		app.text[0].EIP_Begin = 8;
+		asc_emit(app.text[0].assembly, asc::opcode_t::MOVE, asc::oprand_t::IMM, asc::oprand_t::IMM, 1, 4);
+		asc_emit(app.text[0].assembly, asc::opcode_t::CALL, asc::oprand_t::IMM, asc::oprand_t::IMM, 1, -1);
+		asc_emit(app.text[0].assembly, asc::opcode_t::RET);
+		app.text[0].assembly.resize(app.text[0].assembly.size() + 8, 0);
+		app.verify();
+		ok = libs.add(&app) && libs.link(&app) && ok;
+	}
+	std::atomic<int32_t> published{ 1 };
+	std::atomic<bool> stop{ false };
+	std::atomic<uint64_t> lib_runs{ 0 };
+	std::atomic<bool> reload_ok{ ok };
+	std::vector<std::thread> callers;
+	for (int k = 0; k < reloaders; k++)
+		callers.emplace_back([&, k] {
+			asc::elf_t &app = apps[k];
+			int32_t last = 0;
+			while (stop.load() == false)
+			{
+				asc::epoch_t::pin_t pin(epochs);
+				int32_t floor = published.load();
+				bool run = app();
+				int32_t v = *(int32_t*)&app.text[0].assembly[0];
+				if (run == false || v < last || v < floor)
+					reload_ok = false;
+				last = v;
+				lib_runs++;
+			}
+		});
+	double ns = 0;
+	for (int32_t v = 2; v <= reloads + 1; v++)
+	{
+		for (uint64_t seen = lib_runs.load(); lib_runs.load() < seen + 100 * reloaders;) // under load
+			std::this_thread::yield();
+		asc::elf_t *old = libs.find("lib");
+		asc::elf_t *fresh = version(v);
+		auto begin = std::chrono::steady_clock::now();
+		if (asc::reload(libs, epochs, old, fresh, asc::keep_data) == false)
+			reload_ok = false;
+		ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+		published = v;
+		for (auto &f : old->text) // gone: a run still on it would fault
+			f.assembly.assign(f.assembly.size(), 0xFF);
+	}
+	stop = true;
+	for (auto &it : callers)
+		it.join();
+	std::cout << "hot reload: " << reloads << " reloads under " << reloaders << " calling threads, " << ns / reloads / 1e3 << " us/reload, "
+		<< lib_runs.load() << " runs" << (reload_ok ? "" : " (failed)") << std::endl;
+
+	// a run suspended in lib between ticks holds no pin: reload() refuses until it finished or was dropped
+	asc::elf_t *old = libs.find("lib"), *yielding = version(reloads + 2, true);
+	ok = asc::reload(libs, epochs, old, yielding);
+	asc::exec_t tick;
+	ok = ok && tick.start(&apps[0]) && tick.run() == asc::state_t::YIELD && yielding->suspended.load() != 0;
+	ok = ok && asc::reload(libs, epochs, yielding, version(reloads + 3)) == false && libs.find("lib") == yielding;
+	ok = ok && tick.run() == asc::state_t::RET && yielding->suspended.load() == 0 && *(int32_t*)&apps[0].text[0].assembly[0] == reloads + 2;
+	ok = ok && tick.start(&apps[0]) && tick.run() == asc::state_t::YIELD && yielding->suspended.load() != 0;
+	tick.drop();
+	ok = ok && tick.suspended() == false && yielding->suspended.load() == 0 && asc::reload(libs, epochs, yielding, version(reloads + 4));
+	std::cout << "hot reload of a suspended run: " << (ok ? "refused until it ended or was dropped" : "failed") << std::endl;
+	return ok && reload_ok;
+}
+
+// state sync: each tick changes a few words of a 64k data section, delta against a full snapshot. then the
+// digest of the whole state against the incremental one, and a script heap carried over to a peer
+inline bool asc_benchmain_sync()
+{
+	const int sync_ticks = 1000;
+	bool passed = true;
+	asc::elf_t world, peer;
+	for (auto e : { &world, &peer })
+	{
+		e->text.push_back({});
+		asc_bench_loop(e->text[0], 100);
+		e->text[0].assembly.resize(1024, 0);
+		e->data.assign(65536, 0);
+		e->verify();
+	}
+	world.track();
+	std::vector<uint8_t> state;
+	asc::snapshot(world, state);
+	bool ok = asc::restore(peer, state.data(), state.size());
+	size_t delta_bytes = 0;
+	double delta_ns = 0;
+	for (int i = 0; i < sync_ticks; i++)
+	{
+		*(int32_t*)&world.text[0].assembly[0] = 0;
+		world.text[0].dirty.mark(0, 4);
+		*(int32_t*)&world.data[i * 64] = i;
+		world.dirty.mark(i * 64, 4);
+		ok = ok && world();
+		auto begin = std::chrono::steady_clock::now();
+		asc::delta(world, state);
+		delta_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+		delta_bytes += state.size();
+		ok = ok && asc::apply(peer, state.data(), state.size());
+	}
+	ok = ok && world.data == peer.data && world.text[0].assembly == peer.text[0].assembly && world.text[0].EIP == peer.text[0].EIP;
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < sync_ticks; i++)
+		asc::snapshot(world, state);
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+	std::cout << "sync: delta " << delta_bytes / sync_ticks << " bytes " << delta_ns / sync_ticks << " ns, snapshot " << state.size() << " bytes " << ns / sync_ticks << " ns"
+		<< (ok ? "" : " (peer differs)") << std::endl;
+	passed = ok && passed;
+
+	// desync check: digest of the whole state against the incremental one, one word written per tick
+	asc::digest_t digest;
+	uint64_t hash = digest(world);
+	begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < sync_ticks; i++)
+	{
+		*(int32_t*)&world.data[i * 64] = -i;
+		world.dirty.mark(i * 64, 4);
+		hash = digest(world);
+	}
+	double incremental_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+	begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < sync_ticks; i++)
+		ok = asc::digest(world) == hash;
+	ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+	std::cout << "digest: full " << ns / sync_ticks << " ns (" << state.size() * sync_ticks / ns << " GB/s), incremental " << incremental_ns / sync_ticks << " ns"
+		<< (ok ? "" : " (mismatch)") << std::endl;
+	passed = ok && passed;
+	// a second digest_t following the same elf at its own pace still sees every write the first one rehashed
+	asc::digest_t other;
+	other(world);
+	for (int i = 0; i < sync_ticks; i++)
+	{
+		*(int32_t*)&world.data[i * 64] = i * 3;
+		world.dirty.mark(i * 64, 4);
+		hash = digest(world);
+		if (i % 7 == 0)
+			ok = ok && other(world) == hash;
+	}
+	ok = ok && other(world) == hash && hash == asc::digest(world);
+	std::cout << "two digests: " << other.rehashed << " pages rehashed" << (ok ? "" : " (mismatch)") << std::endl;
+	passed = ok && passed;
+	// a tracked peer digested incrementally: restore() marks what it writes, the next digest rehashes it
+	peer.track();
+	asc::digest_t peer_digest;
+	peer_digest(peer);
+	peer_digest(peer);
+	asc::snapshot(world, state);
+	ok = asc::restore(peer, state.data(), state.size());
+	hash = peer_digest(peer);
+	ok = ok && peer_digest.rehashed != 0 && hash == asc::digest(peer) && world.data == peer.data;
+	std::cout << "digest after restore: " << peer_digest.rehashed << " pages rehashed" << (ok ? "" : " (mismatch)") << std::endl;
+	passed = ok && passed;
+
+	// the heap: blocks allocated, one freed and one written by a tracked run, then delta and digest on a peer
+	asc::elf_t owner, copy;
+	for (auto e : { &owner, &copy })
+	{
+		std::strncpy(e->name, "heap", asc::namelen);
+		e->text.push_back({});
+		asc::bytes_t& a = e->text[0].assembly;
+		a.assign(8, 0);
+		e->text[0].EIP_Begin = 8;
+		asc_emit(a, asc::opcode_t::MOVE, asc::oprand_t::IMM, asc::oprand_t::IMM, 1, 4);
+		asc_emit(a, asc::opcode_t::ALLOC, asc::oprand_t::IMM, asc::oprand_t::IMM, 1, 64);
+		asc_emit(a, asc::opcode_t::ALLOC, asc::oprand_t::IMM, asc::oprand_t::IMM, 1, 16);
+		asc_emit(a, asc::opcode_t::FREE, asc::oprand_t::ESP_IA, asc::oprand_t::IMM, 1, -4);
+		asc_emit(a, asc::opcode_t::POP);
+		asc_emit(a, asc::opcode_t::MOV, asc::oprand_t::HEAP_IA, asc::oprand_t::IMM, 2, 8, 7);
+		asc_emit(a, asc::opcode_t::RET);
+		a.resize(a.size() + 16, 0);
+		e->track();
+	}
+	ok = owner.text[0](&owner, nullptr);
+	asc::delta(owner, state);
+	ok = ok && asc::apply(copy, state.data(), state.size()) && copy.heap.live == 1 && asc::digest(owner) == asc::digest(copy);
+	std::cout << "heap sync: delta " << state.size() << " bytes, " << copy.heap.top << " arena bytes" << (ok ? "" : " (peer differs)") << std::endl;
+	passed = ok && passed;
+	// one heap word written per tick: the delta carries that word, the block table only after the ALLOC
+	int32_t block = owner.heap.alloc(4096);
+	asc::delta(owner, state);
+	size_t alloc_bytes = state.size(), word_bytes = 0;
+	ok = asc::apply(copy, state.data(), state.size());
+	for (int i = 0; i < sync_ticks; i++)
+	{
+		int32_t *at = owner.heap.address(block, i * 4 % 4096);
+		*at = i;
+		owner.heap.touch(at);
+		asc::delta(owner, state);
+		word_bytes = std::max(word_bytes, state.size());
+		ok = ok && asc::apply(copy, state.data(), state.size());
+	}
+	ok = ok && alloc_bytes > 4096 && word_bytes < 64 && asc::digest(owner) == asc::digest(copy);
+	std::cout << "heap word sync: delta " << word_bytes << " bytes, after ALLOC " << alloc_bytes << " bytes" << (ok ? "" : " (peer differs)") << std::endl;
+	passed = ok && passed;
+	// the heap digested incrementally: a block allocated and written by the host, then reset() moves top back to 0
+	asc::digest_t heap_digest;
+	heap_digest(owner);
+	int32_t *word = owner.heap.address(owner.heap.alloc(32), 4);
+	*word = 9;
+	owner.heap.touch(word);
+	ok = heap_digest(owner) == asc::digest(owner);
+	size_t heap_rehashed = heap_digest.rehashed;
+	owner.heap.reset();
+	ok = ok && heap_digest(owner) == asc::digest(owner);
+	std::cout << "heap digest: " << heap_rehashed << " pages rehashed" << (ok ? "" : " (mismatch)") << std::endl;
+	passed = ok && passed;
+	// generations per slot: a freed handle stays stale however many blocks went through the other slots, and
+	// across reset()
+	asc::heap_t heap;
+	int32_t stale = heap.alloc(4), neighbour = heap.alloc(4);
+	heap.free(stale);
+	int32_t kept = heap.alloc(4);
+	heap.free(neighbour);
+	for (int i = 0; i < 0x7FFF; i++)
+		heap.free(heap.alloc(4));
+	heap.free(kept);
+	int32_t reused = heap.alloc(4);
+	ok = heap.find(stale) == nullptr && heap.find(kept) == nullptr && heap.find(reused) != nullptr && (reused & 0xFFFF) == (stale & 0xFFFF);
+	heap.reset();
+	ok = ok && heap.find(reused) == nullptr && heap.alloc(4) != reused && heap.find(reused) == nullptr;
+	std::cout << "heap handles: " << (ok ? "stale ones fault" : "a stale handle revalidated") << std::endl;
+	return ok && passed;
+}
+
+// binary operations through generic addressing against the specialized ones of binary_table
+inline bool asc_benchmain_binary()
+{
+	bool passed = true;
+	for (auto opcode : asc::binary_opcodes)
+		passed = asc_bench_binary(opcode, asc::oprand_t::ESP_IA, asc::oprand_t::IMM) && passed;
+	for (int t1 = 0; t1 < static_cast<int>(asc::oprand_t::HEAP_IA); t1++)
+		for (int t2 = 0; t2 < static_cast<int>(asc::oprand_t::HEAP_IA); t2++)
+			if (t1 != 4 && t2 != 4)
+				passed = asc_bench_binary(asc::opcode_t::ADD, static_cast<asc::oprand_t>(t1), static_cast<asc::oprand_t>(t2)) && passed;
+	return passed;
+}
+
+// a function verified against one elf and run against another takes the checked path: DATA_IA 8 is proven
+// for 16 data bytes, run with none it faults, called directly, on an exec_t and as an instance of its module
+inline bool asc_benchmain_proven()
+{
+	bool passed = true;
+	asc::elf_t home, module;
+	home.data.assign(16, 0);
+	for (auto opcode : { asc::opcode_t::MOV, asc::opcode_t::ADD })
+	{
+		module.text.assign(1, {});
+		asc::bytes_t& a = module.text[0].assembly;
+		a.assign(8, 0);
+		module.text[0].EIP_Begin = 8;
+		asc_emit(a, opcode, asc::oprand_t::DATA_IA, asc::oprand_t::IMM, 2, 8, 7);
+		asc_emit(a, asc::opcode_t::RET);
+		a.resize(a.size() + 8, 0); // padding
+		asc::func_t& f = module.text[0];
+		bool ok = f.verify(&home) && f(&home, nullptr);
+		ok = ok && f(&module, nullptr) == false && f.fault == asc::fault_t::ADDRESS;
+		asc::exec_t exec;
+		ok = ok && exec(&f, &module) == false;
+		asc::context_t instance(module);
+		ok = ok && instance() == false;
+		std::cout << "verified " << (opcode == asc::opcode_t::MOV ? "MOV" : "ADD") << " against another elf: " << (ok ? "faulted" : "wrong result") << std::endl;
+		passed = ok && passed;
+	}
+	return passed;
+}
+
+// every comparison above, false if any of them failed
+inline bool asc_benchmain()
+{
+	bool passed = asc_benchmain_engines();
+	passed = asc_benchmain_calls() && passed;
+	passed = asc_benchmain_instances() && passed;
+	passed = asc_benchmain_triggers() && passed;
+	passed = asc_benchmain_image() && passed;
+	passed = asc_benchmain_reload() && passed;
+	passed = asc_benchmain_sync() && passed;
+	passed = asc_benchmain_binary() && passed;
+	passed = asc_benchmain_proven() && passed;
+	return passed;
+}
+
+// benchmark suite
+// every case is an elf whose text[0] runs to completion, timed with each engine: switch interpreter, threaded code
+// decoded from compact code (compact_load), threaded code, verified threaded code and native code.
+// the compact engine must end in the state the switch interpreter leaves. the instructions a case executes are counted once through an
+// exec_t budget, the time is the best of reps runs. asc_bench_save()/asc_bench_check() keep a baseline file
+// (one "case<TAB>engine<TAB>ns/instruction" line each) and compare a later run against it.
+struct asc_bench_case_t
+{
+	static constexpr int engines = 5;
+	std::string name;
+	int64_t insns = 0;					// per run
+	double ns[engines] = { -1, -1, -1, -1, -1 };	// per instruction, < 0: engine unavailable
+	asc::compact_size_t size;			// code size of the case's elfs, see compact_measure()
+	bool ok = true;
+};
+inline const char* asc_bench_engine(int engine)
+{
+	static const char* names[asc_bench_case_t::engines] = { "switch", "compact", "threaded", "verified", "jit" };
+	return names[engine];
+}
+inline bool asc_bench_nop(asc::func_t*)
+{
+	return true;
+}
+inline const asc::exttable_t& asc_bench_host()
+{
+	static const asc::exttable_t host = [] {
+		asc::exttable_t t;
+		t.add(asc_bench_nop);
+		t.add<asc_bench_add>();
+		return t;
+	}();
+	return host;
+}
+constexpr int32_t asc_bench_host_nop = static_cast<int32_t>(asc::extlib_count);
+constexpr int32_t asc_bench_host_add = asc_bench_host_nop + 1;
+
+// every function of elf reloaded from its compact stream, false unless each stream expands back to the bytes
+// it was made from, also when the sweep starts off the instruction grid
+inline bool asc_bench_compact(asc::elf_t& elf)
+{
+	using namespace asc;
+	bool ok = true;
+	std::vector<uint8_t> stream, expanded;
+	for (auto& f : elf.text)
+	{
+		compact_encode(f.assembly, f.EIP_Begin + 1, stream);
+		ok = compact_expand(stream.data(), stream.size(), expanded) && f.assembly == expanded && ok;
+		bytes_t assembly = f.assembly;
+		compact(f, stream);
+		ok = compact_load(f, stream.data(), stream.size()) && (compact_assembly(f, expanded), assembly == expanded) && ok;
+	}
+	return ok;
+}
+// registers, assembly and data of a and b match, the assembly compact code stands for included
+inline bool asc_bench_same(const asc::elf_t& a, const asc::elf_t& b)
+{
+	if (a.text.size() != b.text.size() || a.data != b.data)
+		return false;
+	std::vector<uint8_t> assembly_a, assembly_b;
+	for (size_t i = 0; i < a.text.size(); i++)
+	{
+		asc::compact_assembly(a.text[i], assembly_a);
+		asc::compact_assembly(b.text[i], assembly_b);
+		if (a.text[i].ESP != b.text[i].ESP || a.text[i].EIP != b.text[i].EIP || assembly_a != assembly_b)
+			return false;
+	}
+	return true;
+}
+
+// runs build() once per engine, build(elf, lib) fills elf and may link lib
+template <typename F>
+inline asc_bench_case_t asc_bench_case(const std::string& name, F build, bool exec_calls = false, int reps = 3)
+{
+	using namespace asc;
+	asc_bench_case_t c;
+	c.name = name;
+	for (int engine = 0; engine < asc_bench_case_t::engines; engine++)
+	{
+		elf_t elf, lib;
+		build(elf, lib);
+		if (engine == 1)
+		{
+			c.size = compact_measure(elf);
+			c.size += compact_measure(lib);
+			c.ok = asc_bench_compact(elf) && asc_bench_compact(lib) && c.ok;
+		}
+		if (engine >= 2)
+			elf.predecode(), lib.predecode();
+		if (engine >= 3)
+			c.ok = elf.verify() && (lib.text.size() == 0 || lib.verify()) && c.ok;
+		jit_t jit;
+		if (engine == 4 && (jit.compile(elf), jit.compile(lib), jit.compiled.size() == 0))
+			continue;
+		exec_t exec;
+		if (engine == 0)
+		{
+			state_t state = exec.start(&elf) ? state_t::YIELD : state_t::FAULT;
+			while (state == state_t::YIELD)
+			{
+				state = exec.run();
+				c.insns += INT64_MAX - exec.fuel;
+			}
+			c.ok = state == state_t::RET && c.ok;
+		}
+		double best = 0;
+		for (int i = 0; i < reps; i++)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			c.ok = (exec_calls ? elf(exec) : elf()) && c.ok;
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+			best = i == 0 || ns < best ? ns : best;
+		}
+		c.ns[engine] = best / c.insns;
+		if (engine == 1) // the same runs from the assembly the case built leave the same state
+		{
+			elf_t ref, ref_lib;
+			build(ref, ref_lib);
+			exec_t ref_exec;
+			for (int i = 0; i < reps; i++)
+				exec_calls ? ref(ref_exec) : ref();
+			c.ok = asc_bench_same(elf, ref) && asc_bench_same(lib, ref_lib) && c.ok;
+		}
+	}
+	return c;
+}
+
+// kernel skeleton at the end of a: {0} round counter, {4} [ESP]. body() emits one round
+template <typename F>
+inline void asc_bench_rounds(asc::bytes_t& a, int32_t rounds, F body)
+{
+	using namespace asc;
+	asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::IMM, 2, 0, 0);
+	asc_emit(a, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+	int32_t loop = static_cast<int32_t>(a.size());
+	body();
+	asc_emit(a, opcode_t::ADD, oprand_t::IA, oprand_t::IMM, 2, 0, 1);
+	asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::ESP_IA, 2, 0, 0);
+	asc_emit(a, opcode_t::CMPG, oprand_t::IMM, oprand_t::IA, 2, rounds, 0);
+	asc_emit(a, opcode_t::JNZ, oprand_t::IMM, oprand_t::IMM, 1, loop);
+	asc_emit(a, opcode_t::RET);
+	a.resize(a.size() + 8, 0); // padding
+}
+
+// operand in mode t that reads v in function 1 of asc_bench_opcode: memory modes read it from cell c of that
+// function, of its caller (EBP_IA) or of the data section. ESP is 4 in both functions
+inline int32_t asc_bench_operand(asc::elf_t& elf, asc::oprand_t t, int32_t c, int32_t v)
+{
+	using namespace asc;
+	switch (t)
+	{
+	case oprand_t::IMM: return v;
+	case oprand_t::ESP: return v - 4;
+	case oprand_t::IA: std::memcpy(&elf.text[1].assembly[c], &v, sizeof(v)); return c;
+	case oprand_t::ESP_IA: std::memcpy(&elf.text[1].assembly[c], &v, sizeof(v)); return c - 4;
+	case oprand_t::EBP_IA: std::memcpy(&elf.text[0].assembly[c], &v, sizeof(v)); return c - 4;
+	default: std::memcpy(&elf.data[c], &v, sizeof(v)); return c;
+	}
+}
+inline int asc_bench_operands(asc::opcode_t opcode)
+{
+	using namespace asc;
+	switch (opcode)
+	{
+	case opcode_t::POP: case opcode_t::RET: case opcode_t::NOP: case opcode_t::INT: case opcode_t::YIELD:
+		return 0;
+	case opcode_t::MOVE: case opcode_t::INC: case opcode_t::DEC: case opcode_t::NEG: case opcode_t::NOT:
+	case opcode_t::PUSH: case opcode_t::JMP: case opcode_t::JZ: case opcode_t::JNZ: case opcode_t::CALL: case opcode_t::CALLEXT:
+	case opcode_t::ALLOC: case opcode_t::FREE:
+		return 1;
+	default:
+		return 2;
+	}
+}
+
+// function 0 calls function 1, which runs rounds x copies of one instruction, function 2 only returns.
+// every copy has cells of its own: written operands never change what another one reads. PUSH comes with a POP
+inline void asc_bench_opcode(asc::elf_t& elf, asc::opcode_t opcode, asc::oprand_t t1, asc::oprand_t t2, int32_t rounds, int copies)
+{
+	using namespace asc;
+	const int32_t cells = 8 + 8 * copies;
+	elf.ext = &asc_bench_host();
+	elf.data.assign(cells, 0);
+	elf.text.resize(3);
+	func_t& driver = elf.text[0];
+	driver.assembly.assign(cells, 0);
+	driver.EIP_Begin = cells;
+	asc_emit(driver.assembly, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+	asc_emit(driver.assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1);
+	asc_emit(driver.assembly, opcode_t::RET);
+	driver.assembly.resize(driver.assembly.size() + 8, 0);
+	func_t& f = elf.text[1];
+	f.assembly.assign(cells, 0);
+	f.EIP_Begin = cells;
+	asc_bench_rounds(f.assembly, rounds, [&] {
+		int n = asc_bench_operands(opcode);
+		for (int k = 0; k < copies; k++)
+		{
+			int32_t v = 4;
+			if (opcode == opcode_t::CALL)
+				v = 2;
+			else if (opcode == opcode_t::CALLEXT)
+				v = asc_bench_host_nop;
+			else if (opcode == opcode_t::JMP || opcode == opcode_t::JZ || opcode == opcode_t::JNZ)
+				v = static_cast<int32_t>(elf.text[1].assembly.size()) + 8; // the next instruction
+			int32_t c = 8 + 8 * k;
+			int32_t op1 = n >= 1 ? asc_bench_operand(elf, opcode == opcode_t::MOVE ? t2 : t1, c, v) : 0;
+			int32_t op2 = n >= 2 ? asc_bench_operand(elf, t2, c + 4, v) : 0;
+			asc_emit(elf.text[1].assembly, opcode, t1, t2, n, op1, op2);
+			if (opcode == opcode_t::PUSH)
+				asc_emit(elf.text[1].assembly, opcode_t::POP);
+		}
+	});
+	func_t& leaf = elf.text[2];
+	asc_emit(leaf.assembly, opcode_t::RET);
+	leaf.assembly.resize(leaf.assembly.size() + 8, 0);
+}
+
+// cases: every opcode but INT, RET (the end of every CALL case), POP (after every PUSH) and the heap ones in every
+// addressing mode but HEAP_IA, then calls, host calls, the heap and loop kernels. filter: substring of the case names to run
+inline std::vector<asc_bench_case_t> asc_benchsuite(const std::string& filter = "", int reps = 3)
+{
+	using namespace asc;
+	static const char* oprands[] = { "IMM", "IA", "ESP", "ESP_IA", "EBP", "EBP_IA", "DATA_IA" };
+	static const opcode_t opcodes[] = {
+		opcode_t::MOV, opcode_t::MOVE, opcode_t::XCHG, opcode_t::ADD, opcode_t::SUB, opcode_t::MUL, opcode_t::DIV,
+		opcode_t::INC, opcode_t::DEC, opcode_t::NEG, opcode_t::AND, opcode_t::OR, opcode_t::XOR, opcode_t::NOT,
+		opcode_t::SHL, opcode_t::PUSH, opcode_t::JMP, opcode_t::JZ, opcode_t::JNZ, opcode_t::CALL, opcode_t::CALLEXT,
+		opcode_t::NOP, opcode_t::YIELD, opcode_t::CMP, opcode_t::CMPG, opcode_t::CMPGE };
+	static const char* names[] = {
+		"MOV", "MOVE", "XCHG", "ADD", "SUB", "MUL", "DIV", "INC", "DEC", "NEG", "AND", "OR", "XOR", "NOT",
+		"SHL", "PUSH/POP", "JMP", "JZ", "JNZ", "CALL/RET", "CALLEXT", "NOP", "YIELD", "CMP", "CMPG", "CMPGE" };
+	const int32_t rounds = 8000;
+	const int copies = 8;
+	const int modes = 7; // IMM..DATA_IA, the heap has cases of its own
+	std::vector<asc_bench_case_t> out;
+	auto run = [&](const std::string& name, auto build, bool exec_calls = false) {
+		if (name.find(filter) != std::string::npos)
+			out.push_back(asc_bench_case(name, build, exec_calls, reps));
+	};
+
+	for (size_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); i++)
+	{
+		opcode_t opcode = opcodes[i];
+		int n = asc_bench_operands(opcode);
+		bool writes1 = opcode == opcode_t::MOV || opcode == opcode_t::XCHG || opcode == opcode_t::INC ||
+			opcode == opcode_t::DEC || opcode == opcode_t::NEG;
+		for (int t1 = 0; t1 < (n >= 1 ? modes : 1); t1++)
+			for (int t2 = 0; t2 < (n >= 2 ? modes : 1); t2++)
+			{
+				// EBP never addresses, IMM and ESP are never written
+				if (n >= 1 && (t1 == 4 || (writes1 && (t1 == 0 || t1 == 2))))
+					continue;
+				if (n >= 2 && (t2 == 4 || (opcode == opcode_t::XCHG && (t2 == 0 || t2 == 2))))
+					continue;
+				std::string name = names[i];
+				if (n >= 1)
+					name += std::string(" ") + oprands[t1];
+				if (n >= 2)
+					name += std::string(",") + oprands[t2];
+				oprand_t m1 = static_cast<oprand_t>(t1), m2 = static_cast<oprand_t>(t2);
+				if (opcode == opcode_t::MOVE) // MOVE addresses with mode 2
+					std::swap(m1, m2);
+				run(name, [&](elf_t& elf, elf_t&) { asc_bench_opcode(elf, opcode, m1, m2, rounds, copies); });
+			}
+	}
+
+	// calls: a chain of depth functions, each calling the next one, from a loop
+	const int32_t depth = 256;
+	auto chain = [&](elf_t& elf, elf_t&) {
+		elf.text.resize(depth + 1);
+		elf.text[0].assembly.assign(8, 0);
+		elf.text[0].EIP_Begin = 8;
+		asc_bench_rounds(elf.text[0].assembly, 64, [&] { asc_emit(elf.text[0].assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, 1); });
+		for (int32_t i = 1; i <= depth; i++)
+		{
+			if (i < depth)
+				asc_emit(elf.text[i].assembly, opcode_t::CALL, oprand_t::IMM, oprand_t::IMM, 1, i + 1);
+			asc_emit(elf.text[i].assembly, opcode_t::RET);
+			elf.text[i].assembly.resize(elf.text[i].assembly.size() + 8, 0);
+		}
+	};
+	run("call chain " + std::to_string(depth), chain);
+	run("call chain " + std::to_string(depth) + " exec_t", chain, true);
+	// one call per round: of a function that only returns, local and imported from a linked elf, and of host
+	// functions. the same loop with a NOP instead is the baseline
+	auto call_loop = [&](opcode_t opcode, int32_t op) {
+		return [=](elf_t& elf, elf_t& lib) {
+			elf.ext = &asc_bench_host();
+			elf.text.resize(2);
+			asc::bytes_t& a = elf.text[0].assembly;
+			a.assign(8, 0);
+			elf.text[0].EIP_Begin = 8;
+			asc_bench_rounds(a, rounds * copies, [&] { asc_emit(a, opcode, oprand_t::IMM, oprand_t::IMM, opcode == opcode_t::NOP ? 0 : 1, op); });
+			asc_emit(elf.text[1].assembly, opcode_t::RET);
+			elf.text[1].assembly.resize(elf.text[1].assembly.size() + 8, 0);
+			if (op >= 0 || opcode != opcode_t::CALL)
+				return;
+			lib.text.resize(1);
+			lib.text[0].assembly = elf.text[1].assembly;
+			std::strcpy(lib.name, "lib");
+			std::strcpy(elf.name, "main");
+			elf.dependency.push_back({ "lib", nullptr });
+			elf.imports.push_back({ 0, 0, nullptr });
+			registry_t registry;
+			registry.link({ &lib, &elf });
+		};
+	};
+	run("call loop without call", call_loop(opcode_t::NOP, 0));
+	run("call loop local", call_loop(opcode_t::CALL, 1));
+	run("call loop local exec_t", call_loop(opcode_t::CALL, 1), true);
+	run("call loop import", call_loop(opcode_t::CALL, -1));
+	run("call loop import exec_t", call_loop(opcode_t::CALL, -1), true);
+	run("call loop host nop", call_loop(opcode_t::CALLEXT, asc_bench_host_nop));
+	run("call loop host typed add", call_loop(opcode_t::CALLEXT, asc_bench_host_add));
+	// the caller's threaded code turns stale in the first round, run from its compact stream it is expanded then
+	run("call loop patching the caller", [&](elf_t& elf, elf_t&) { asc_bench_patch_caller(elf, rounds); });
+
+	// heap: a block allocated and freed per round, then words of one block read and written per round
+	//	{0} i  {4} handle  {8} [ESP]
+	run("heap ALLOC/FREE", [&](elf_t& elf, elf_t&) {
+		elf.text.push_back({});
+		asc::bytes_t& a = elf.text[0].assembly;
+		a.assign(8, 0);
+		elf.text[0].EIP_Begin = 8;
+		asc_bench_rounds(a, rounds * copies, [&] {
+			asc_emit(a, opcode_t::ALLOC, oprand_t::IMM, oprand_t::IMM, 1, 64);
+			asc_emit(a, opcode_t::FREE, oprand_t::IA, oprand_t::IMM, 1, 4);
+			asc_emit(a, opcode_t::POP);
+		});
+	});
+	run("heap HEAP_IA", [&](elf_t& elf, elf_t&) {
+		elf.text.push_back({});
+		asc::bytes_t& a = elf.text[0].assembly;
+		a.assign(12, 0);
+		elf.text[0].EIP_Begin = 12;
+		asc_emit(a, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+		asc_emit(a, opcode_t::ALLOC, oprand_t::IMM, oprand_t::IMM, 1, 64);
+		asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::IMM, 2, 0, 0);
+		int32_t loop = static_cast<int32_t>(a.size());
+		asc_emit(a, opcode_t::INC, oprand_t::HEAP_IA, oprand_t::IMM, 1, 0);
+		asc_emit(a, opcode_t::ADD, oprand_t::HEAP_IA, oprand_t::HEAP_IA, 2, 4, 0);
+		asc_emit(a, opcode_t::MOV, oprand_t::HEAP_IA, oprand_t::ESP_IA, 2, 4, 0);
+		asc_emit(a, opcode_t::XCHG, oprand_t::HEAP_IA, oprand_t::HEAP_IA, 2, 8, 12);
+		asc_emit(a, opcode_t::ADD, oprand_t::IA, oprand_t::IMM, 2, 0, 1);
+		asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::ESP_IA, 2, 0, 0);
+		asc_emit(a, opcode_t::CMPG, oprand_t::IMM, oprand_t::IA, 2, rounds * copies, 0);
+		asc_emit(a, opcode_t::JNZ, oprand_t::IMM, oprand_t::IMM, 1, loop);
+		asc_emit(a, opcode_t::FREE, oprand_t::IA, oprand_t::IMM, 1, 4);
+		asc_emit(a, opcode_t::RET);
+		a.resize(a.size() + 8, 0);
+	});
+
+	// loop kernels
+	run("kernel counter", [&](elf_t& elf, elf_t&) {
+		elf.text.push_back({});
+		elf.text[0].assembly.assign(8, 0);
+		elf.text[0].EIP_Begin = 8;
+		asc_bench_rounds(elf.text[0].assembly, rounds * copies, [] {});
+	});
+	// table scan: sums a table of 4096 words, ESP walks the table
+	//	{0} i  {4} [ESP]  {8} cursor  {12} sum  {16} element  {32} table
+	//	MOVE [8]; MOV [16], [ESP]; MOVE 4; ADD [12], [16]; MOV [12], [ESP]; ADD [8], 4; MOV [8], [ESP]
+	const int32_t table = 4096;
+	run("kernel table scan", [&](elf_t& elf, elf_t&) {
+		elf.text.push_back({});
+		asc::bytes_t& a = elf.text[0].assembly;
+		a.assign(32 + 4 * table, 0);
+		for (int32_t i = 0; i < table; i++)
+			std::memcpy(&a[32 + 4 * i], &i, sizeof(i));
+		elf.text[0].EIP_Begin = static_cast<uint32_t>(a.size());
+		asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::IMM, 2, 8, 32);
+		asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::IMM, 2, 12, 0);
+		asc_bench_rounds(a, table, [&] {
+			asc_emit(a, opcode_t::MOVE, oprand_t::IMM, oprand_t::IA, 1, 8);
+			asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::ESP_IA, 2, 16, 0);
+			asc_emit(a, opcode_t::MOVE, oprand_t::IMM, oprand_t::IMM, 1, 4);
+			asc_emit(a, opcode_t::ADD, oprand_t::IA, oprand_t::IA, 2, 12, 16);
+			asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::ESP_IA, 2, 12, 0);
+			asc_emit(a, opcode_t::ADD, oprand_t::IA, oprand_t::IMM, 2, 8, 4);
+			asc_emit(a, opcode_t::MOV, oprand_t::IA, oprand_t::ESP_IA, 2, 8, 0);
+		});
+	});
+	// branches: a linear congruential generator mod 2^16 in the data section picks one of two paths per round
+	//	MUL {0}, 5; ADD [ESP], 1; AND [ESP], 0xFFFF; MOV {0}, [ESP]; AND {0}, 0x100; JZ even; INC {4}; JMP next;
+	//	even: INC {8}; next:
+	run("kernel branches", [&](elf_t& elf, elf_t&) {
+		elf.text.push_back({});
+		elf.data.assign(12, 0);
+		asc::bytes_t& a = elf.text[0].assembly;
+		a.assign(8, 0);
+		elf.text[0].EIP_Begin = 8;
+		asc_bench_rounds(a, rounds * copies, [&] {
+			asc_emit(a, opcode_t::MUL, oprand_t::DATA_IA, oprand_t::IMM, 2, 0, 5);
+			asc_emit(a, opcode_t::ADD, oprand_t::ESP_IA, oprand_t::IMM, 2, 0, 1);
+			asc_emit(a, opcode_t::AND, oprand_t::ESP_IA, oprand_t::IMM, 2, 0, 0xFFFF);
+			asc_emit(a, opcode_t::MOV, oprand_t::DATA_IA, oprand_t::ESP_IA, 2, 0, 0);
+			asc_emit(a, opcode_t::AND, oprand_t::DATA_IA, oprand_t::IMM, 2, 0, 0x100);
+			size_t jz = a.size();
+			asc_emit(a, opcode_t::JZ, oprand_t::IMM, oprand_t::IMM, 1, 0);
+			asc_emit(a, opcode_t::INC, oprand_t::DATA_IA, oprand_t::IMM, 1, 4);
+			size_t jmp = a.size();
+			asc_emit(a, opcode_t::JMP, oprand_t::IMM, oprand_t::IMM, 1, 0);
+			int32_t even = static_cast<int32_t>(a.size());
+			std::memcpy(&a[jz + 4], &even, sizeof(even));
+			asc_emit(a, opcode_t::INC, oprand_t::DATA_IA, oprand_t::IMM, 1, 8);
+			int32_t next = static_cast<int32_t>(a.size());
+			std::memcpy(&a[jmp + 4], &next, sizeof(next));
+		});
+	});
+	return out;
+}
+
+inline void asc_bench_print(const std::vector<asc_bench_case_t>& cases)
+{
+	std::printf("%-28s", "case");
+	for (int e = 0; e < asc_bench_case_t::engines; e++)
+		std::printf(" %19s", asc_bench_engine(e));
+	std::printf("\n%-28s", "");
+	for (int e = 0; e < asc_bench_case_t::engines; e++)
+		std::printf(" %9s %9s", "ns/insn", "Minsn/s");
+	std::printf("\n");
+	for (auto& c : cases)
+	{
+		std::printf("%-28s", c.name.c_str());
+		for (int e = 0; e < asc_bench_case_t::engines; e++)
+			if (c.ns[e] < 0)
+				std::printf(" %9s %9s", "-", "-");
+			else
+				std::printf(" %9.3f %9.1f", c.ns[e], 1e3 / c.ns[e]);
+		std::printf("%s\n", c.ok ? "" : " (failed)");
+	}
+	asc::compact_size_t size;
+	for (auto& c : cases)
+		size += c.size;
+	if (size.assembly != 0)
+		std::printf("compact code: %zu instructions %zu -> %zu bytes (%.1f%%), assembly with data %zu -> %zu bytes (%.1f%%)\n",
+			size.instructions, size.code, size.records, 100.0 * size.records / size.code,
+			size.assembly, size.compact, 100.0 * size.compact / size.assembly);
+	if (size.functions != 0)
+		std::printf("compact load: %zu of %zu functions run from their streams, assembly with data %zu -> %zu bytes resident (%.1f%%)\n",
+			size.kept, size.functions, size.assembly, size.resident, 100.0 * size.resident / size.assembly);
+}
+inline bool asc_bench_save(const std::vector<asc_bench_case_t>& cases, const char* path)
+{
+	std::FILE* file = std::fopen(path, "w");
+	if (file == nullptr)
+		return false;
+	for (auto& c : cases)
+		for (int e = 0; e < asc_bench_case_t::engines; e++)
+			if (c.ns[e] >= 0)
+				std::fprintf(file, "%s\t%s\t%.4f\n", c.name.c_str(), asc_bench_engine(e), c.ns[e]);
+	return std::fclose(file) == 0;
+}
+// false if a case failed, the baseline cannot be read or a case got slower than baseline x (1 + tolerance)
+inline bool asc_bench_check(const std::vector<asc_bench_case_t>& cases, const char* path, double tolerance)
+{
+	std::FILE* file = std::fopen(path, "r");
+	if (file == nullptr)
+		return false;
+	bool ok = true;
+	char line[256];
+	while (std::fgets(line, sizeof(line), file) != nullptr)
+	{
+		char* engine = std::strchr(line, '\t');
+		char* value = engine != nullptr ? std::strchr(engine + 1, '\t') : nullptr;
+		if (value == nullptr)
+			continue;
+		*engine++ = 0;
+		*value++ = 0;
+		double baseline = std::atof(value);
+		for (auto& c : cases)
+			for (int e = 0; e < asc_bench_case_t::engines; e++)
+				if (c.name == line && std::strcmp(asc_bench_engine(e), engine) == 0 && c.ns[e] > baseline * (1 + tolerance))
+				{
+					std::printf("regression: %s %s %.3f ns/insn, baseline %.3f\n", line, engine, c.ns[e], baseline);
+					ok = false;
+				}
+	}
+	std::fclose(file);
+	for (auto& c : cases)
+		ok = ok && c.ok;
+	return ok;
+}
@@ -0,0 +1,587 @@
+#pragma once
+#include <cstring>
+#include "AssemblyScript32.h"
+
+namespace asc {
+    // compact code
+    // a function's assembly as a stream of records: an instruction becomes 2 to 10 bytes instead of 4, 8 or 12,
+    // data and whatever does not fit (undefined opcodes, modes above 7) stays raw bytes or zero runs. the stream
+    // starts with the LEB128 size of the assembly and expands back to it byte for byte. compact_load() decodes the
+    // threaded code (func_t::predecode) straight from the stream, which the function keeps, and leaves only the
+    // bytes below the code in its assembly: the stack and the data the code addresses, copied per activation and
+    // instance. no 12-byte instruction is expanded, EIPs stay byte offsets into the stream's assembly and the run
+    // is that of the threaded code. a function whose code may need its own bytes (dynamic jump targets, IA
+    // operands or a stack reaching the code, see compact_fits()) is expanded and decoded as usual instead, one
+    // whose callee or host function reaches above its stack is expanded then (compact_unfold()).
+    // instructions are swept linearly from EIP_Begin, every instruction reachable from there starts a record of
+    // its own.
+    // record: a 16-bit header code(6) | width1(2) | mode1(3) | mode2(3) | width2(2), then operand 1 and operand 2
+    // in width 0 (value 0), 1, 2 or 4 bytes, sign extended. the fields of an operand an instruction does not take
+    // are 0. codes 0..30 are the opcodes below, COMPACT_RAW is followed by a LEB128 length and that many
+    // bytes of assembly, COMPACT_ZERO by the length of a run of zeros.
+    struct compact_op_t
+    {
+        opcode_t opcode;
+        uint8_t words;          // instruction length in assembly, 0: not an instruction record
+    };
+    constexpr uint8_t COMPACT_RAW = 62;
+    constexpr uint8_t COMPACT_ZERO = 63;
+    constexpr size_t COMPACT_INDEX = 16;    // records per func_t::compact_at entry
+    constexpr compact_op_t compact_ops[64] = {
+        { opcode_t::MOV, 3 }, { opcode_t::MOVE, 2 }, { opcode_t::XCHG, 3 }, { opcode_t::ADD, 3 },
+        { opcode_t::SUB, 3 }, { opcode_t::MUL, 3 }, { opcode_t::DIV, 3 }, { opcode_t::INC, 2 },
+        { opcode_t::DEC, 2 }, { opcode_t::NEG, 2 }, { opcode_t::AND, 3 }, { opcode_t::OR, 3 },
+        { opcode_t::XOR, 3 }, { opcode_t::NOT, 2 }, { opcode_t::SHL, 3 }, { opcode_t::PUSH, 2 },
+        { opcode_t::POP, 1 }, { opcode_t::JMP, 2 }, { opcode_t::JZ, 2 }, { opcode_t::JNZ, 2 },
+        { opcode_t::CALL, 2 }, { opcode_t::CALLEXT, 2 }, { opcode_t::RET, 1 }, { opcode_t::NOP, 1 },
+        { opcode_t::INT, 1 }, { opcode_t::YIELD, 1 }, { opcode_t::CMP, 3 }, { opcode_t::CMPG, 3 },
+        { opcode_t::CMPGE, 3 }, { opcode_t::ALLOC, 2 }, { opcode_t::FREE, 2 },
+    };
+    inline uint32_t compact_bytes(uint32_t width) // 0, 1, 2, 4
+    {
+        return width + (width >> 1 & width);
+    }
+    inline int32_t compact_extend(uint32_t v, uint32_t width) // sign extended low bytes of v
+    {
+        static constexpr uint32_t mask[4] = { 0, 0xFF, 0xFFFF, 0xFFFFFFFF };
+        static constexpr uint32_t sign[4] = { 0, 0x80, 0x8000, 0x80000000 };
+        return static_cast<int32_t>(((v & mask[width]) ^ sign[width]) - sign[width]);
+    }
+    inline void compact_put(std::vector<uint8_t> &out, uint32_t v) // LEB128
+    {
+        for (; v >= 0x80; v >>= 7)
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+        out.push_back(static_cast<uint8_t>(v));
+    }
+    inline bool compact_get(const uint8_t *&p, const uint8_t *end, uint32_t &v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 35 && p < end; shift += 7)
+        {
+            uint8_t b = *p++;
+            v |= uint32_t(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+    inline uint32_t compact_width(int32_t v)
+    {
+        return v == 0 ? 0 : v == static_cast<int8_t>(v) ? 1 : v == static_cast<int16_t>(v) ? 2 : 3;
+    }
+    inline int compact_code(opcode_t opcode) // index into compact_ops, -1: none
+    {
+        for (int i = 0; i < COMPACT_RAW; i++)
+            if (compact_ops[i].words != 0 && compact_ops[i].opcode == opcode)
+                return i;
+        return -1;
+    }
+    // the record of the instruction at e into rec, its length or 0 if it does not fit one
+    inline size_t compact_record(const bytes_t &a, uint32_t e, uint8_t *rec, uint32_t &words)
+    {
+        if (e + sizeof(uint32_t) > a.size())
+            return 0;
+        opcode_t opcode;
+        std::memcpy(&opcode, &a[e], sizeof(opcode));
+        int code = compact_code(opcode);
+        if (code < 0)
+            return 0;
+        words = compact_ops[code].words;
+        uint8_t m1 = a[e + 2], m2 = a[e + 3];
+        if (e + words * sizeof(uint32_t) > a.size() || m1 > 7 || m2 > 7 || (words == 1 && (m1 | m2) != 0))
+            return 0;
+        int32_t op[2] = { 0, 0 };
+        if (words >= 2)
+            std::memcpy(&op[0], &a[e + 4], sizeof(int32_t));
+        if (words == 3)
+            std::memcpy(&op[1], &a[e + 8], sizeof(int32_t));
+        uint32_t w1 = compact_width(op[0]), w2 = compact_width(op[1]);
+        rec[0] = static_cast<uint8_t>(code | w1 << 6);
+        rec[1] = static_cast<uint8_t>(m1 | m2 << 3 | w2 << 6);
+        size_t n = 2;
+        std::memcpy(rec + n, &op[0], compact_bytes(w1));
+        n += compact_bytes(w1);
+        std::memcpy(rec + n, &op[1], compact_bytes(w2));
+        return n + compact_bytes(w2);
+    }
+    inline void compact_encode(const bytes_t &a, uint32_t begin, std::vector<uint8_t> &out)
+    {
+        uint32_t size = static_cast<uint32_t>(a.size());
+        // starts of the instructions reachable from begin, the sweep never swallows one into a longer record
+        std::vector<uint8_t> start(size, 0);
+        std::vector<uint32_t> work = { begin };
+        while (work.size() != 0)
+        {
+            uint32_t e = work.back();
+            work.pop_back();
+            while (e + sizeof(uint32_t) <= size && start[e] == 0)
+            {
+                opcode_t opcode;
+                std::memcpy(&opcode, &a[e], sizeof(opcode));
+                int code = compact_code(opcode);
+                if (code < 0)
+                    break;
+                start[e] = 1;
+                if ((opcode == opcode_t::JMP || opcode == opcode_t::JZ || opcode == opcode_t::JNZ) &&
+                    a[e + 2] == static_cast<uint8_t>(oprand_t::IMM) && e + 8 <= size)
+                {
+                    uint32_t target;
+                    std::memcpy(&target, &a[e + 4], sizeof(target));
+                    if (target < size)
+                        work.push_back(target);
+                }
+                if (opcode == opcode_t::JMP || opcode == opcode_t::RET || opcode == opcode_t::INT)
+                    break;
+                e += compact_ops[code].words * sizeof(uint32_t);
+            }
+        }
+        auto data = [&](uint32_t from, uint32_t to) {
+            while (from < to)
+            {
+                uint32_t r = from;
+                while (r < to && a[r] == 0)
+                    r++;
+                if (r - from >= 4)
+                {
+                    out.push_back(COMPACT_ZERO);
+                    compact_put(out, r - from);
+                    from = r;
+                    continue;
+                }
+                uint32_t zeros = 0;
+                for (r = from; r < to; r++)
+                {
+                    zeros = a[r] == 0 ? zeros + 1 : 0;
+                    if (zeros == 4)
+                    {
+                        r -= 3;
+                        break;
+                    }
+                }
+                out.push_back(COMPACT_RAW);
+                compact_put(out, r - from);
+                out.insert(out.end(), a.begin() + from, a.begin() + r);
+                from = r;
+            }
+        };
+        out.clear();
+        compact_put(out, size);
+        uint32_t d = 0; // data pending since d
+        for (uint32_t e = begin; e < size;)
+        {
+            uint32_t s = e + 1;
+            while (s < size && s < e + 12 && start[s] == 0)
+                s++;
+            uint8_t rec[10];
+            uint32_t words = 0;
+            size_t n = compact_record(a, e, rec, words);
+            if (n != 0 && e + words * sizeof(uint32_t) <= s)
+            {
+                data(d, e);
+                out.insert(out.end(), rec, rec + n);
+                d = e += words * sizeof(uint32_t);
+            }
+            else
+                e = std::min<uint32_t>(e + 4, s);
+        }
+        data(d, size);
+    }
+    // the records of a stream, EIP << 32 | offset of each in order, and the size of the assembly they make up.
+    // false if the stream is malformed, does not make up its size or goes on past it
+    inline bool compact_scan(const uint8_t *in, size_t size, uint32_t &total, std::vector<uint64_t> &records)
+    {
+        const uint8_t *p = in, *end = in + size;
+        records.clear();
+        if (compact_get(p, end, total) == false)
+            return false;
+        for (uint32_t e = 0; e < total;)
+        {
+            if (p == end)
+                return false;
+            uint8_t b0 = *p;
+            uint32_t n;
+            records.push_back(uint64_t(e) << 32 | static_cast<uint32_t>(p - in));
+            if ((b0 & 63) == COMPACT_RAW || (b0 & 63) == COMPACT_ZERO)
+            {
+                p++;
+                if (b0 >> 6 != 0 || compact_get(p, end, n) == false || n > total - e)
+                    return false;
+                if (b0 == COMPACT_RAW)
+                {
+                    if (static_cast<size_t>(end - p) < n)
+                        return false;
+                    p += n;
+                }
+                e += n;
+                continue;
+            }
+            const compact_op_t &k = compact_ops[b0 & 63];
+            if (k.words == 0 || k.words * sizeof(uint32_t) > total - e || end - p < 2)
+                return false;
+            uint8_t b1 = p[1];
+            n = 2 + compact_bytes(b0 >> 6) + compact_bytes(b1 >> 6);
+            if ((k.words == 1 && (b0 >> 6 != 0 || b1 != 0)) || (k.words == 2 && b1 >> 6 != 0) ||
+                static_cast<size_t>(end - p) < n)
+                return false;
+            p += n;
+            e += k.words * sizeof(uint32_t);
+        }
+        return p == end;
+    }
+    // bytes [skip, skip + n) of the assembly the scanned record at p stands for into out, how many it has of them
+    inline uint32_t compact_unpack(const uint8_t *p, uint32_t skip, uint8_t *out, uint32_t n)
+    {
+        uint8_t b0 = *p++;
+        uint32_t len;
+        if ((b0 & 63) == COMPACT_RAW || (b0 & 63) == COMPACT_ZERO)
+        {
+            compact_get(p, p + 5, len);
+            len = len > skip ? std::min(len - skip, n) : 0;
+            if (b0 == COMPACT_RAW)
+                std::memcpy(out, p + skip, len);
+            else
+                std::memset(out, 0, len);
+            return len;
+        }
+        const compact_op_t &k = compact_ops[b0 & 63];
+        uint8_t b1 = *p++;
+        uint32_t raw[2] = { 0, 0 };
+        std::memcpy(&raw[0], p, compact_bytes(b0 >> 6));
+        std::memcpy(&raw[1], p + compact_bytes(b0 >> 6), compact_bytes(b1 >> 6));
+        int32_t op[2] = { compact_extend(raw[0], b0 >> 6), compact_extend(raw[1], b1 >> 6) };
+        uint8_t insn[3 * sizeof(uint32_t)];
+        std::memcpy(insn, &k.opcode, sizeof(opcode_t));
+        insn[2] = b1 & 7;
+        insn[3] = b1 >> 3 & 7;
+        std::memcpy(insn + 4, op, sizeof(op));
+        len = k.words * sizeof(uint32_t);
+        len = len > skip ? std::min(len - skip, n) : 0;
+        std::memcpy(out, insn + skip, len);
+        return len;
+    }
+    // bytes [e, e + n) of the assembly of a scanned stream into out, false if they go past its end
+    inline bool compact_fetch(const uint8_t *in, const std::vector<uint64_t> &records, uint32_t total, uint32_t e, uint8_t *out, uint32_t n)
+    {
+        if (uint64_t(e) + n > total)
+            return false;
+        size_t i = std::upper_bound(records.begin(), records.end(), uint64_t(e) << 32 | UINT32_MAX) - records.begin();
+        for (i--; n != 0; i++)
+        {
+            uint32_t got = compact_unpack(in + static_cast<uint32_t>(records[i]), e - static_cast<uint32_t>(records[i] >> 32), out, n);
+            out += got;
+            e += got;
+            n -= got;
+        }
+        return true;
+    }
+    // bytes in the stream and in the assembly of the scanned record at p
+    inline void compact_step(const uint8_t *p, uint32_t &bytes, uint32_t &len)
+    {
+        uint8_t b0 = *p;
+        if ((b0 & 63) == COMPACT_RAW || (b0 & 63) == COMPACT_ZERO)
+        {
+            const uint8_t *q = p + 1;
+            compact_get(q, q + 5, len);
+            bytes = static_cast<uint32_t>(q - p) + (b0 == COMPACT_RAW ? len : 0);
+            return;
+        }
+        bytes = 2 + compact_bytes(b0 >> 6) + compact_bytes(p[1] >> 6);
+        len = compact_ops[b0 & 63].words * sizeof(uint32_t);
+    }
+    // see func_t::fetch: binary search of compact_at, then at most COMPACT_INDEX records on from there
+    inline bool compact_fetch(const func_t &c, uint32_t eip, uint8_t *at)
+    {
+        const uint8_t *p = c.compact.bytes();
+        uint32_t total;
+        if (compact_get(p, p + c.compact.size(), total) == false || c.compact_at.size() == 0 ||
+            uint64_t(eip) + 3 * sizeof(uint32_t) > total)
+            return false;
+        uint64_t from = *--std::upper_bound(c.compact_at.begin(), c.compact_at.end(), uint64_t(eip) << 32 | UINT32_MAX);
+        uint32_t e = static_cast<uint32_t>(from >> 32);
+        p = c.compact.bytes() + static_cast<uint32_t>(from);
+        for (uint32_t n = 3 * sizeof(uint32_t); n != 0;)
+        {
+            uint32_t bytes, len;
+            compact_step(p, bytes, len);
+            if (e + len > eip)
+            {
+                uint32_t got = compact_unpack(p, eip - e, at, n);
+                at += got;
+                eip += got;
+                n -= got;
+            }
+            e += len;
+            p += bytes;
+        }
+        return true;
+    }
+    // expands a stream into assembly, false if it is malformed, see compact_scan()
+    inline bool compact_expand(const uint8_t *in, size_t size, std::vector<uint8_t> &assembly)
+    {
+        uint32_t total;
+        std::vector<uint64_t> records;
+        if (compact_scan(in, size, total, records) == false)
+            return false;
+        assembly.assign(total, 0);
+        return compact_fetch(in, records, total, 0, assembly.data(), total);
+    }
+    // the stream of f, again after editing assembly by hand
+    inline void compact(const func_t &f, std::vector<uint8_t> &out)
+    {
+        compact_encode(f.assembly, f.EIP_Begin, out);
+    }
+    // the assembly f stands for: its own, or for compact code the stream expanded with the stack of f over it
+    inline void compact_assembly(const func_t &f, std::vector<uint8_t> &out)
+    {
+        const bytes_t &stream = f.code().compact;
+        if (stream.size() == 0 || compact_expand(stream.bytes(), stream.size(), out) == false)
+            out.assign(f.assembly.begin(), f.assembly.end());
+        else
+            std::copy(f.assembly.begin(), f.assembly.begin() + std::min(f.assembly.size(), out.size()), out.begin());
+    }
+    // threaded code of f from the stream it keeps, see func_t::predecode()
+    inline void compact_predecode(func_t &f)
+    {
+        uint32_t total = 0;
+        std::vector<uint64_t> records;
+        const uint8_t *in = f.compact.bytes();
+        if (compact_scan(in, f.compact.size(), total, records) == false) // compact_load() took it, cannot happen
+            total = 0;
+        f.predecode(total, [&](uint32_t eip, uint8_t *at) {
+            return compact_fetch(in, records, total, eip, at, 3 * sizeof(uint32_t));
+        });
+        f.code_lo = 0; // no instruction bytes in assembly a write could change
+        f.code_len = 0;
+    }
+    // true if the threaded code of f runs on the bytes of assembly below lo: no jump has a dynamic target, every
+    // IA operand lies below lo and so does every access through ESP. ESP starts at 0, its highest value is
+    // followed through MOVE, PUSH, POP and ALLOC, a MOVE from memory fails. what a callee or host function
+    // addresses is only known at run time, compact_unfold() takes care of it.
+    inline bool compact_fits(const func_t &f, uint32_t lo)
+    {
+        const std::vector<insn_t> &d = f.decoded;
+        std::vector<int64_t> top(d.size(), -1); // highest ESP on entry, -1: not reached
+        std::vector<uint32_t> work;
+        auto reach = [&](uint32_t i, int64_t esp) {
+            if (i < d.size() && esp > top[i])
+            {
+                top[i] = esp;
+                work.push_back(i);
+            }
+        };
+        auto below = [&](oprand_t opt, int32_t op, int64_t esp) {
+            switch (opt)
+            {
+            case oprand_t::IA:
+                return uint64_t(static_cast<uint32_t>(op)) + sizeof(int32_t) <= lo;
+            case oprand_t::ESP_IA:
+                return esp + op + static_cast<int64_t>(sizeof(int32_t)) <= lo;
+            case oprand_t::HEAP_IA:
+                return esp <= lo;
+            default:
+                return true;
+            }
+        };
+        reach(0, 0);
+        while (work.size() != 0)
+        {
+            uint32_t i = work.back();
+            work.pop_back();
+            const insn_t &in = d[i];
+            int64_t esp = top[i];
+            bool stack = esp + static_cast<int64_t>(sizeof(int32_t)) <= lo; // [ESP] lies below lo
+            bool ok = true;
+            switch (in.kind)
+            {
+            case insn_t::MOV:
+            case insn_t::XCHG:
+                ok = below(in.oprandT1, in.op1, esp) && below(in.oprandT2, in.op2, esp);
+                break;
+            case insn_t::MOVE:
+                if (in.oprandT2 != oprand_t::IMM)
+                    return false;
+                esp = static_cast<uint32_t>(in.op1);
+                break;
+            case insn_t::INC:
+            case insn_t::DEC:
+            case insn_t::NEG:
+            case insn_t::FREE:
+                ok = below(in.oprandT1, in.op1, esp);
+                break;
+            case insn_t::ADD: case insn_t::SUB: case insn_t::MUL: case insn_t::DIV:
+            case insn_t::AND: case insn_t::OR: case insn_t::XOR: case insn_t::SHL:
+            case insn_t::CMP: case insn_t::CMPG: case insn_t::CMPGE:
+                ok = below(in.oprandT1, in.op1, esp) && below(in.oprandT2, in.op2, esp) && stack;
+                break;
+            case insn_t::NOT:
+                ok = below(in.oprandT1, in.op1, esp) && stack;
+                break;
+            case insn_t::PUSH:
+            case insn_t::ALLOC:
+                ok = below(in.oprandT1, in.op1, esp) && stack;
+                esp += sizeof(int32_t);
+                break;
+            case insn_t::POP:
+                esp = esp >= 4 ? std::max<int64_t>(esp - 4, 3) : esp;
+                break;
+            case insn_t::JMP:
+            case insn_t::JZ:
+            case insn_t::JNZ:
+                ok = in.oprandT1 == oprand_t::IMM && (in.kind == insn_t::JMP || stack);
+                break;
+            default:
+                break;
+            }
+            if (ok == false)
+                return false;
+            switch (in.kind)
+            {
+            case insn_t::FAULT:
+            case insn_t::RET:
+                break;
+            case insn_t::GOTO:
+                reach(in.op2 - 1, esp);
+                break;
+            case insn_t::JMP:
+                if (in.op2 != 0)
+                    reach(in.op2 - 1, esp);
+                break;
+            case insn_t::JZ:
+            case insn_t::JNZ:
+                if (in.op2 != 0)
+                    reach(in.op2 - 1, esp);
+                reach(i + 1, esp);
+                break;
+            default:
+                reach(i + 1, esp);
+                break;
+            }
+        }
+        return true;
+    }
+    // f from a stream alone, ESP, EIP and EIP_Begin are left to the caller. the threaded code is decoded from the
+    // stream, which f keeps in compact with every COMPACT_INDEX-th record in compact_at, from which func_t::fetch
+    // finds an EIP. if compact_fits() its assembly keeps the bytes below the first instruction only, the stack, which
+    // activations and instances copy. otherwise the stream is expanded into assembly and decoded from there.
+    // false and f untouched if the stream is malformed
+    inline bool compact_load(func_t &f, const uint8_t *in, size_t size)
+    {
+        uint32_t total;
+        std::vector<uint64_t> records;
+        if (compact_scan(in, size, total, records) == false)
+            return false;
+        f.compact.assign(in, in + size);
+        f.predecode(total, [&](uint32_t eip, uint8_t *at) {
+            return compact_fetch(in, records, total, eip, at, 3 * sizeof(uint32_t));
+        });
+        uint32_t lo = total;
+        for (auto &it : f.decoded)
+            lo = std::min(lo, it.eip);
+        std::vector<uint8_t> assembly;
+        if (compact_fits(f, lo))
+        {
+            assembly.resize(lo);
+            compact_fetch(in, records, total, 0, assembly.data(), lo);
+            f.code_lo = 0;
+            f.code_len = 0;
+        }
+        else
+        {
+            assembly.resize(total);
+            compact_fetch(in, records, total, 0, assembly.data(), total);
+            f.compact = {};
+            records.clear();
+        }
+        f.compact_at.clear();
+        for (size_t i = 0; i < records.size(); i += COMPACT_INDEX)
+            f.compact_at.push_back(records[i]);
+        f.assembly = std::move(assembly);
+        if (f.compact.size() == 0)
+            f.predecode();
+        f.stale = false;
+        if (f.dirty.tracked()) // every word counts as written
+            f.dirty.track(f.assembly.size());
+        return true;
+    }
+    // the instructions of compact code f back in its assembly, the stream expanded with the stack of f over it,
+    // once a callee's EBP_IA or a host function reaches above the stack. f turns stale: the engines check it after
+    // every CALL and CALLEXT and go on in run_switch(), which interprets the assembly. false if f has no
+    // instructions to expand
+    inline bool compact_unfold(func_t &f)
+    {
+        if (f.in_stream() == false)
+            return false;
+        std::vector<uint8_t> assembly;
+        compact_assembly(f, assembly);
+        f.assembly = std::move(assembly);
+        f.stale = true;
+        if (f.dirty.tracked())
+            f.dirty.grow(f.assembly.size());
+        return true;
+    }
+    // f faulted at EIP in native code, which addresses the caller's assembly as it was on entry: true if an
+    // EBP_IA operand there reached above the stack of a compact caller, which is expanded now
+    inline bool compact_reach(func_t &f)
+    {
+        func_t *c = f.caller;
+        const func_t &code = f.code();
+        if (c == nullptr || c == &f || c->in_stream() == false || f.EIP >= code.decoded_at.size() || code.decoded_at[f.EIP] == 0)
+            return false;
+        const insn_t &in = code.decoded[code.decoded_at[f.EIP] - 1];
+        auto above = [&](oprand_t opt, int32_t op) {
+            return opt == oprand_t::EBP_IA && c->ESP + static_cast<uint32_t>(op) >= c->assembly.size();
+        };
+        bool reached = above(in.oprandT1, in.op1) || above(in.oprandT2, in.kind == insn_t::MOVE ? in.op1 : in.op2);
+        return reached && compact_unfold(*c);
+    }
+    // code size of an elf in both forms
+    struct compact_size_t
+    {
+        size_t assembly = 0;        // bytes of assembly
+        size_t compact = 0;         // bytes of the streams
+        size_t instructions = 0;    // instruction records
+        size_t code = 0;            // bytes of assembly they stand for
+        size_t records = 0;         // and their bytes in the streams
+        size_t functions = 0;
+        size_t kept = 0;            // functions compact_load() keeps compact
+        size_t resident = 0;        // bytes of assembly, kept streams and their indices after compact_load()
+        inline compact_size_t &operator+=(const compact_size_t &o)
+        {
+            assembly += o.assembly, compact += o.compact, instructions += o.instructions;
+            code += o.code, records += o.records;
+            functions += o.functions, kept += o.kept, resident += o.resident;
+            return *this;
+        }
+    };
+    inline compact_size_t compact_measure(const elf_t &elf)
+    {
+        compact_size_t s;
+        std::vector<uint8_t> stream;
+        std::vector<uint64_t> records;
+        uint32_t total;
+        for (auto &f : elf.text)
+        {
+            compact_encode(f.assembly, f.EIP_Begin, stream);
+            compact_scan(stream.data(), stream.size(), total, records);
+            s.assembly += f.assembly.size();
+            s.compact += stream.size();
+            func_t loaded;
+            loaded.EIP_Begin = f.EIP_Begin;
+            compact_load(loaded, stream.data(), stream.size());
+            s.functions++;
+            s.kept += loaded.compact.size() != 0;
+            s.resident += loaded.assembly.size() + loaded.compact.size() + loaded.compact_at.size() * sizeof(uint64_t);
+            for (auto it : records)
+            {
+                const uint8_t *p = &stream[static_cast<uint32_t>(it)];
+                const compact_op_t &k = compact_ops[p[0] & 63];
+                if (k.words == 0)
+                    continue;
+                s.instructions++;
+                s.code += k.words * sizeof(uint32_t);
+                s.records += 2 + compact_bytes(p[0] >> 6) + compact_bytes(p[1] >> 6);
+            }
+        }
+        return s;
+    }
+}
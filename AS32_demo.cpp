@@ -0,0 +1,9 @@
+// demo executable, runs asc_testmain() of AS32_demo.h
+#include <iostream>
+#include "AS32_demo.h"
+
+int main()
+{
+	asc_testmain();
+	return 0;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <cstring>
+#include "AssemblyScript32.h"
+
+namespace asc {
+    // fault reasons
+    // a function that returns false stops with ESP and EIP at the instruction that faulted and that instruction
+    // has changed nothing, in every engine. fault_reason(f) evaluates the instruction at f.EIP once more without
+    // writing and tells why it cannot run. every engine calls func_t::fail() where a run faults, before anything
+    // else runs, so func_t::fault holds the reason of that moment even if the heap, the data or a binding changed
+    // since. diagnose(f) follows CALLs that failed in the callee down to the function that faulted first, from
+    // the recorded reasons, and evaluates fault_reason() only for a function without one. after an exec_t run a
+    // callee is reported as CALLEE, its activation is gone. runs that do not fault pay one store for this.
+    inline const char *fault_name(fault_t reason)
+    {
+        static const char *const names[] = { "NONE", "EIP", "OPCODE", "MODE", "ADDRESS", "HEAP", "STACK", "DIVIDE",
+            "CALL", "CALLEE", "EXT", "HOST" };
+        return static_cast<size_t>(reason) < sizeof(names) / sizeof(names[0]) ? names[static_cast<size_t>(reason)] : "?";
+    }
+    struct fault_info_t
+    {
+        fault_t reason = fault_t::NONE;
+        func_t *func = nullptr;     // function that faulted first
+        uint32_t eip = 0;
+        uint32_t esp = 0;
+        uint16_t opcode = 0;
+        oprand_t oprandT1 = oprand_t::IMM;
+        oprand_t oprandT2 = oprand_t::IMM;
+        uint32_t depth = 0;         // CALLs followed from the function asked
+    };
+    // the operand reads addressing_r makes, the writes addressing_w makes
+    inline fault_t fault_operand(func_t &f, oprand_t opt, int32_t op, bool write, int32_t &value)
+    {
+        if (static_cast<uint8_t>(opt) > static_cast<uint8_t>(oprand_t::HEAP_IA) || static_cast<uint8_t>(opt) == 4 ||
+            (write && (opt == oprand_t::IMM || opt == oprand_t::ESP)))
+            return fault_t::MODE;
+        if (f.addressing_r(opt, op, value))
+            return fault_t::NONE;
+        return opt == oprand_t::HEAP_IA ? fault_t::HEAP : fault_t::ADDRESS;
+    }
+    inline fault_t fault_reason(func_t &f)
+    {
+        uint8_t p[3 * sizeof(uint32_t)];
+        if (f.fetch(f.EIP, p) == false)
+            return fault_t::EIP;
+        opcode_t opcode;
+        oprand_t t1, t2;
+        int32_t op1, op2;
+        std::memcpy(&opcode, p, sizeof(opcode));
+        std::memcpy(&t1, p + 2, sizeof(t1));
+        std::memcpy(&t2, p + 3, sizeof(t2));
+        std::memcpy(&op1, p + 4, sizeof(op1));
+        std::memcpy(&op2, p + 8, sizeof(op2));
+        int32_t lv = 0, lv2 = 0;
+        fault_t r = fault_t::NONE;
+        bool esp = f.ESP < f.assembly.size();
+        switch (opcode)
+        {
+        case opcode_t::MOV:
+            if ((r = fault_operand(f, t1, op1, true, lv)) == fault_t::NONE)
+                r = fault_operand(f, t2, op2, false, lv);
+            return r;
+        case opcode_t::MOVE:
+            return fault_operand(f, t2, op1, false, lv);
+        case opcode_t::XCHG:
+            if ((r = fault_operand(f, t1, op1, true, lv)) == fault_t::NONE)
+                r = fault_operand(f, t2, op2, true, lv);
+            return r;
+        case opcode_t::INC:
+        case opcode_t::DEC:
+        case opcode_t::NEG:
+            return fault_operand(f, t1, op1, true, lv);
+        case opcode_t::ADD: case opcode_t::SUB: case opcode_t::MUL: case opcode_t::DIV:
+        case opcode_t::AND: case opcode_t::OR: case opcode_t::XOR: case opcode_t::SHL:
+        case opcode_t::CMP: case opcode_t::CMPG: case opcode_t::CMPGE:
+            if ((r = fault_operand(f, t1, op1, false, lv)) != fault_t::NONE || (r = fault_operand(f, t2, op2, false, lv2)) != fault_t::NONE)
+                return r;
+            if (esp == false)
+                return fault_t::STACK;
+            return opcode == opcode_t::DIV && lv2 == 0 ? fault_t::DIVIDE : fault_t::NONE;
+        case opcode_t::NOT:
+        case opcode_t::PUSH:
+        case opcode_t::JZ:
+        case opcode_t::JNZ:
+            if ((r = fault_operand(f, t1, op1, false, lv)) != fault_t::NONE)
+                return r;
+            return esp ? fault_t::NONE : fault_t::STACK;
+        case opcode_t::POP:
+            return f.ESP >= 4 ? fault_t::NONE : fault_t::STACK;
+        case opcode_t::JMP:
+            return fault_operand(f, t1, op1, false, lv);
+        case opcode_t::CALL:
+        {
+            func_t *callee;
+            elf_t *elf_callee = f.elf_local;
+            if ((r = fault_operand(f, t1, op1, false, lv)) != fault_t::NONE)
+                return r;
+            return f.callable_addressing(t1, op1, callee, elf_callee) ? fault_t::CALLEE : fault_t::CALL;
+        }
+        case opcode_t::CALLEXT:
+            if ((r = fault_operand(f, t1, op1, false, lv)) != fault_t::NONE)
+                return r;
+            return ext_find(f.elf_local, lv) != nullptr ? fault_t::HOST : fault_t::EXT;
+        case opcode_t::ALLOC:
+            if ((r = fault_operand(f, t1, op1, false, lv)) != fault_t::NONE)
+                return r;
+            return f.elf_local == nullptr ? fault_t::HEAP : esp ? fault_t::NONE : fault_t::STACK;
+        case opcode_t::FREE:
+            if ((r = fault_operand(f, t1, op1, false, lv)) != fault_t::NONE)
+                return r;
+            return f.elf_local == nullptr || f.elf_local->heap.find(lv) == nullptr ? fault_t::HEAP : fault_t::NONE;
+        case opcode_t::RET:
+        case opcode_t::NOP:
+        case opcode_t::YIELD:
+            return fault_t::NONE;
+        default:
+            return fault_t::OPCODE;
+        }
+    }
+    inline bool func_t::fail()
+    {
+        fault = fault_reason(*this);
+        return false;
+    }
+    inline fault_t fault_recorded(func_t &f) // fault_reason() only if no run recorded one
+    {
+        return f.fault != fault_t::NONE ? f.fault : fault_reason(f);
+    }
+    inline fault_info_t diagnose(func_t &f)
+    {
+        fault_info_t info;
+        func_t *at = &f;
+        for (;;)
+        {
+            info.func = at;
+            info.reason = fault_recorded(*at);
+            info.eip = at->EIP;
+            info.esp = at->ESP;
+            uint8_t p[3 * sizeof(uint32_t)];
+            bool whole = at->fetch(at->EIP, p);
+            if (whole)
+            {
+                std::memcpy(&info.opcode, p, sizeof(info.opcode));
+                std::memcpy(&info.oprandT1, p + 2, sizeof(info.oprandT1));
+                std::memcpy(&info.oprandT2, p + 3, sizeof(info.oprandT2));
+            }
+            if (info.reason != fault_t::CALLEE || whole == false || info.depth >= 256)
+                return info;
+            func_t *callee;
+            elf_t *elf_callee = at->elf_local;
+            int32_t op1;
+            std::memcpy(&op1, p + 4, sizeof(op1));
+            if (at->callable_addressing(info.oprandT1, op1, callee, elf_callee) == false || callee == at ||
+                fault_recorded(*callee) == fault_t::NONE)
+                return info;
+            at = callee;
+            info.depth++;
+        }
+    }
+}
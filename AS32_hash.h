@@ -0,0 +1,258 @@
+#pragma once
+#include <cstring>
+#include "AssemblyScript32.h"
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define AS32_HASH_SSE2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define AS32_HASH_AVX2 __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#define AS32_HASH_AVX2
+#endif
+#endif
+
+namespace asc {
+    // state hashing
+    // hash64() is an xxh3 style kernel over 32-byte stripes: each of 4 64-bit lanes adds lo32(v ^ key) *
+    // hi32(v ^ key) and the input of its neighbouring lane, the key steps every stripe. the lanes never mix before
+    // the final avalanche, so the scalar, SSE2 and AVX2 loops produce the same bits: every x86-64 build (and any
+    // little endian target) agrees. AVX2 is picked at run time where the compiler allows it.
+    constexpr uint64_t hash_prime[5] = { 0x9E3779B185EBCA87, 0xC2B2AE3D27D4EB4F, 0x165667B19E3779F9,
+                                         0x85EBCA77C2B2AE63, 0x27D4EB2F165667C5 };
+    inline uint64_t hash_avalanche(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCD;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53;
+        return x ^ (x >> 33);
+    }
+    inline uint64_t hash_fold(uint64_t h, uint64_t v)
+    {
+        h = (h ^ hash_avalanche(v)) * hash_prime[0];
+        return (h << 31) | (h >> 33);
+    }
+    inline void hash_stripes_scalar(uint64_t *acc, uint64_t *key, const uint8_t *p, size_t stripes)
+    {
+        for (size_t s = 0; s < stripes; s++, p += 32)
+        {
+            uint64_t v[4];
+            std::memcpy(v, p, sizeof(v));
+            for (int i = 0; i < 4; i++)
+            {
+                uint64_t k = v[i] ^ key[i];
+                acc[i ^ 1] += v[i];
+                acc[i] += (k & 0xFFFFFFFF) * (k >> 32);
+                key[i] += hash_prime[4];
+            }
+        }
+    }
+#ifdef AS32_HASH_SSE2
+    inline void hash_stripes_sse2(uint64_t *acc, uint64_t *key, const uint8_t *p, size_t stripes)
+    {
+        __m128i a[2] = { _mm_loadu_si128((const __m128i *)acc), _mm_loadu_si128((const __m128i *)(acc + 2)) };
+        __m128i k[2] = { _mm_loadu_si128((const __m128i *)key), _mm_loadu_si128((const __m128i *)(key + 2)) };
+        const __m128i step = _mm_set1_epi64x(static_cast<long long>(hash_prime[4]));
+        for (size_t s = 0; s < stripes; s++, p += 32)
+            for (int i = 0; i < 2; i++)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+                __m128i vk = _mm_xor_si128(v, k[i]);
+                a[i] = _mm_add_epi64(a[i], _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+                a[i] = _mm_add_epi64(a[i], _mm_mul_epu32(vk, _mm_shuffle_epi32(vk, _MM_SHUFFLE(0, 3, 0, 1))));
+                k[i] = _mm_add_epi64(k[i], step);
+            }
+        for (int i = 0; i < 2; i++)
+        {
+            _mm_storeu_si128((__m128i *)(acc + 2 * i), a[i]);
+            _mm_storeu_si128((__m128i *)(key + 2 * i), k[i]);
+        }
+    }
+#endif
+#ifdef AS32_HASH_AVX2
+    AS32_HASH_AVX2 inline void hash_stripes_avx2(uint64_t *acc, uint64_t *key, const uint8_t *p, size_t stripes)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)acc);
+        __m256i k = _mm256_loadu_si256((const __m256i *)key);
+        const __m256i step = _mm256_set1_epi64x(static_cast<long long>(hash_prime[4]));
+        for (size_t s = 0; s < stripes; s++, p += 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            __m256i vk = _mm256_xor_si256(v, k);
+            a = _mm256_add_epi64(a, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+            a = _mm256_add_epi64(a, _mm256_mul_epu32(vk, _mm256_shuffle_epi32(vk, _MM_SHUFFLE(0, 3, 0, 1))));
+            k = _mm256_add_epi64(k, step);
+        }
+        _mm256_storeu_si256((__m256i *)acc, a);
+        _mm256_storeu_si256((__m256i *)key, k);
+    }
+    inline bool hash_has_avx2()
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        static const bool has = __builtin_cpu_supports("avx2");
+        return has;
+#else
+        return true;
+#endif
+    }
+#endif
+    inline uint64_t hash64(const void *data, size_t len, uint64_t seed = 0)
+    {
+        const uint8_t *p = (const uint8_t *)data;
+        uint64_t acc[4] = { hash_prime[0] ^ seed, hash_prime[1] + seed, hash_prime[2] ^ seed, hash_prime[3] - seed };
+        uint64_t key[4] = { hash_prime[1], hash_prime[2], hash_prime[3], hash_prime[4] };
+        size_t stripes = len / 32;
+#if defined(AS32_HASH_AVX2)
+        if (hash_has_avx2())
+            hash_stripes_avx2(acc, key, p, stripes);
+        else
+            hash_stripes_sse2(acc, key, p, stripes);
+#elif defined(AS32_HASH_SSE2)
+        hash_stripes_sse2(acc, key, p, stripes);
+#else
+        hash_stripes_scalar(acc, key, p, stripes);
+#endif
+        if (len % 32 != 0)
+        {
+            uint8_t tail[32] = {};
+            std::memcpy(tail, p + stripes * 32, len % 32);
+            hash_stripes_scalar(acc, key, tail, 1);
+        }
+        uint64_t h = seed ^ (len * hash_prime[0]);
+        for (int i = 0; i < 4; i++)
+            h = hash_fold(h, acc[i]);
+        return hash_avalanche(h);
+    }
+
+    // digest of an elf and every elf it depends on: names, data sections, script heaps, ESP/EIP and assembly of
+    // every function.
+    // a memory hashes as the sum of its 4k page hashes. digest_t keeps those and, for memory tracked since its
+    // previous call (elf_t::track), rehashes only the pages written in between: dirty_t::pages holds the serial of
+    // each page's last write, digest_t the last serial it has seen. the marks are only read, so any number of
+    // digest_t may follow the same elf or a dependency shared by several roots. host writes must be marked too
+    // (dirty_t::mark). the arena of a script heap is a memory of its own, hashed up to heap_t::top (the pages
+    // around a moved top are rehashed), its block table again only when heap_t::layout moved on.
+    // digest() hashes everything once.
+    struct digest_t
+    {
+        static constexpr size_t page = 4096;
+        struct memory_t
+        {
+            const uint8_t *base = nullptr;
+            size_t size = 0;
+            bool tracked = false;
+            uint64_t seen = 0;          // dirty_t::writes at the previous call
+            uint64_t sum = 0;
+            std::vector<uint64_t> pages;
+            uint64_t layout = 0;        // heap arenas: heap_t::layout of table
+            uint64_t table = 0;
+        };
+        std::vector<memory_t> memories;
+        std::vector<const elf_t *> order;
+        size_t rehashed = 0;                    // pages hashed by the last call
+
+        inline uint64_t operator()(const elf_t &elf) { return run(elf, true); }
+        uint64_t run(const elf_t &elf, bool incremental);
+
+    private:
+        uint64_t memory(size_t index, const uint8_t *base, size_t size, const dirty_t &dirty, bool incremental);
+        uint64_t heap(size_t index, const heap_t &heap, bool incremental);
+    };
+    inline uint64_t digest_t::memory(size_t index, const uint8_t *base, size_t size, const dirty_t &dirty, bool incremental)
+    {
+        memory_t &m = memories[index];
+        size_t count = (size + page - 1) / page;
+        auto hash_page = [&](size_t i) {
+            size_t at = i * page;
+            rehashed++;
+            return hash64(base + at, std::min(page, size - at), i);
+        };
+        if (incremental && m.tracked && dirty.tracked() && m.base == base)
+        {
+            size_t keep = m.size == size ? count : std::min(m.size, size) / page; // pages that kept their extent
+            for (size_t i = keep; i < m.pages.size(); i++)
+                m.sum -= m.pages[i];
+            m.pages.resize(keep);
+            m.pages.resize(count, 0);
+            for (size_t i = 0; i < count; i++)
+            {
+                if (i < keep && (i >= dirty.pages.size() || dirty.pages[i] <= m.seen))
+                    continue;
+                uint64_t h = hash_page(i);
+                m.sum += h - m.pages[i];
+                m.pages[i] = h;
+            }
+        }
+        else
+        {
+            m.pages.resize(count);
+            m.sum = 0;
+            for (size_t i = 0; i < count; i++)
+                m.sum += m.pages[i] = hash_page(i);
+        }
+        m.base = base;
+        m.size = size;
+        m.tracked = incremental && dirty.tracked();
+        m.seen = dirty.writes;
+        return hash_fold(m.sum, size);
+    }
+    // a script heap: its block table and free lists, then the arena below top
+    inline uint64_t digest_t::heap(size_t index, const heap_t &heap, bool incremental)
+    {
+        memory_t &m = memories[index];
+        if (incremental == false || m.tracked == false || m.layout != heap.layout)
+        {
+            uint64_t h = hash_fold(hash_fold(heap.top, heap.limit), heap.used);
+            for (auto &b : heap.blocks)
+                h = hash_fold(hash_fold(h, (uint64_t(b.off) << 32) | b.size), (uint64_t(b.gen) << 16) | (uint64_t(b.cls) << 8) | b.live);
+            for (auto slot : heap.slots)
+                h = hash_fold(h, slot);
+            for (auto &list : heap.lists)
+            {
+                h = hash_fold(h, list.size());
+                for (auto off : list)
+                    h = hash_fold(h, off);
+            }
+            m.table = h;
+            m.layout = heap.layout;
+        }
+        return hash_fold(m.table, memory(index, heap.arena.data(), heap.top, heap.dirty, incremental));
+    }
+    inline uint64_t digest_t::run(const elf_t &elf, bool incremental) // incremental: rehash only pages written since
+    {
+        std::vector<const elf_t *> now = { &elf };
+        for (size_t i = 0; i < now.size(); i++)
+            for (auto &it : now[i]->dependency)
+                if (it.ptr != nullptr && std::find(now.begin(), now.end(), it.ptr) == now.end())
+                    now.push_back(it.ptr);
+        incremental = incremental && now == order;
+        order = std::move(now);
+        size_t count = 0;
+        for (auto e : order)
+            count += 2 + e->text.size();
+        memories.resize(count);
+        rehashed = 0;
+        uint64_t h = hash_prime[4];
+        size_t index = 0;
+        for (auto e : order)
+        {
+            uint64_t name = 0;
+            std::memcpy(&name, e->name, sizeof(name));
+            h = hash_fold(h, name);
+            h = hash_fold(h, memory(index++, e->data.data(), e->data.size(), e->dirty, incremental));
+            h = hash_fold(h, heap(index++, e->heap, incremental));
+            h = hash_fold(h, e->text.size());
+            for (auto &f : e->text)
+            {
+                h = hash_fold(h, (uint64_t(f.EIP) << 32) | f.ESP);
+                h = hash_fold(h, memory(index++, f.assembly.data(), f.assembly.size(), f.dirty, incremental));
+            }
+        }
+        return hash_avalanche(h);
+    }
+    inline uint64_t digest(const elf_t &elf)
+    {
+        digest_t d;
+        return d.run(elf, false);
+    }
+}
@@ -0,0 +1,272 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include "AssemblyScript32.h"
+#if defined(__unix__) || defined(__APPLE__)
+#define AS32_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define AS32_MMAP 0
+#endif
+
+namespace asc {
+    // binary elf container, version 1, little endian, every table and section 8-byte aligned:
+    //   header_t | dependency_t[dependencies] | import_t[imports] | function_t[functions] | code | data
+    // function_t keeps the registers of a function and the range of its assembly in the code section.
+    // image_t maps a file read-only and load() builds an elf_t straight from the mapping: nothing is parsed,
+    // converted or copied, assembly and data share the mapped bytes (bytes_t::share) until a run first writes to
+    // them. one image loads any number of elfs and must stay open while they do not own their bytes (bytes_t::own).
+    // dependencies and imports come back unlinked, see elf_t::load_elf.
+    struct image_t
+    {
+        static constexpr uint32_t magic = 0x32335341; // "AS32"
+        static constexpr uint16_t version = 1;
+        struct header_t
+        {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t header_size;
+            uint64_t size;          // whole image
+            name_t name;
+            uint32_t dependencies;
+            uint32_t imports;
+            uint32_t functions;
+            uint32_t reserved;
+            uint64_t code_offset;
+            uint64_t code_size;
+            uint64_t data_offset;
+            uint64_t data_size;
+        };
+        struct dependency_t
+        {
+            name_t name;
+        };
+        struct import_t
+        {
+            int32_t dependency_index;
+            int32_t func_index;
+        };
+        struct function_t
+        {
+            uint32_t EIP_Begin;
+            uint32_t ESP;
+            uint32_t EIP;
+            uint32_t reserved;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        const uint8_t *base = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        std::vector<uint8_t> buffer;    // file contents where mmap is not available
+
+        image_t() = default;
+        image_t(const image_t &) = delete;
+        image_t &operator=(const image_t &) = delete;
+        inline ~image_t() { close(); }
+
+        inline const header_t &header() const { return *(const header_t *)base; }
+        inline const dependency_t *dependency() const { return (const dependency_t *)(base + align(sizeof(header_t))); }
+        inline const import_t *imports() const
+        {
+            return (const import_t *)((const uint8_t *)dependency() + align(header().dependencies * sizeof(dependency_t)));
+        }
+        inline const function_t *functions() const
+        {
+            return (const function_t *)((const uint8_t *)imports() + align(header().imports * sizeof(import_t)));
+        }
+        static constexpr size_t align(size_t n) { return (n + 7) & ~size_t(7); }
+
+        bool open(const char *path);
+        bool open(const uint8_t *bytes, size_t len);    // not copied, must outlive the image
+        void close();
+        bool load(elf_t &elf) const;
+        static void save(const elf_t &elf, std::vector<uint8_t> &out);
+        static bool save(const elf_t &elf, const char *path);
+
+    private:
+        bool check() const;
+    };
+
+    inline bool image_t::check() const
+    {
+        if (size < sizeof(header_t) || reinterpret_cast<uintptr_t>(base) % 8 != 0)
+            return false;
+        const header_t &h = header();
+        if (h.magic != magic || h.version != version || h.header_size != sizeof(header_t) || h.size != size)
+            return false;
+        uint64_t tables = align(sizeof(header_t)) + align(uint64_t(h.dependencies) * sizeof(dependency_t)) +
+                          align(uint64_t(h.imports) * sizeof(import_t)) + align(uint64_t(h.functions) * sizeof(function_t));
+        if (tables > h.code_offset || h.code_offset > size || h.code_size > size - h.code_offset ||
+            h.data_offset < h.code_offset + h.code_size || h.data_offset > size || h.data_size > size - h.data_offset)
+            return false;
+        const import_t *imp = imports();
+        for (uint32_t i = 0; i < h.imports; i++)
+            if (imp[i].dependency_index < 0 || static_cast<uint32_t>(imp[i].dependency_index) >= h.dependencies)
+                return false;
+        const function_t *fn = functions();
+        for (uint32_t i = 0; i < h.functions; i++)
+            if (fn[i].offset > h.code_size || fn[i].size > h.code_size - fn[i].offset || fn[i].size > UINT32_MAX)
+                return false;
+        return true;
+    }
+    inline bool image_t::open(const uint8_t *bytes, size_t len)
+    {
+        close();
+        base = bytes;
+        size = len;
+        if (check())
+            return true;
+        close();
+        return false;
+    }
+    inline bool image_t::open(const char *path)
+    {
+        close();
+#if AS32_MMAP
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+            return false;
+        base = (const uint8_t *)p;
+        size = st.st_size;
+        mapped = true;
+#else
+        std::FILE *file = std::fopen(path, "rb");
+        if (file == nullptr)
+            return false;
+        std::fseek(file, 0, SEEK_END);
+        long len = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        if (len > 0)
+        {
+            buffer.resize(len);
+            if (std::fread(buffer.data(), 1, len, file) != static_cast<size_t>(len))
+                buffer.clear();
+        }
+        std::fclose(file);
+        base = buffer.data();
+        size = buffer.size();
+#endif
+        if (check())
+            return true;
+        close();
+        return false;
+    }
+    inline void image_t::close()
+    {
+#if AS32_MMAP
+        if (mapped)
+            munmap(const_cast<uint8_t *>(base), size);
+#endif
+        mapped = false;
+        buffer.clear();
+        base = nullptr;
+        size = 0;
+    }
+    inline bool image_t::load(elf_t &elf) const
+    {
+        if (base == nullptr)
+            return false;
+        const header_t &h = header();
+        std::memcpy(elf.name, h.name, namelen);
+        elf.referenced = 0;
+        elf.dependency.resize(h.dependencies);
+        for (uint32_t i = 0; i < h.dependencies; i++)
+        {
+            std::memcpy(elf.dependency[i].name, dependency()[i].name, namelen);
+            elf.dependency[i].ptr = nullptr;
+        }
+        elf.imports.resize(h.imports);
+        for (uint32_t i = 0; i < h.imports; i++)
+            elf.imports[i] = { imports()[i].dependency_index, imports()[i].func_index, nullptr };
+        const uint8_t *code = base + h.code_offset;
+        elf.text.resize(h.functions);
+        for (uint32_t i = 0; i < h.functions; i++)
+        {
+            const function_t &fn = functions()[i];
+            func_t &f = elf.text[i];
+            f = func_t{};
+            f.assembly.share(code + fn.offset, fn.size);
+            f.EIP_Begin = fn.EIP_Begin;
+            f.ESP = fn.ESP;
+            f.EIP = fn.EIP;
+        }
+        elf.data.share(base + h.data_offset, h.data_size);
+        return true;
+    }
+    inline void image_t::save(const elf_t &elf, std::vector<uint8_t> &out)
+    {
+        header_t h = {};
+        h.magic = magic;
+        h.version = version;
+        h.header_size = sizeof(header_t);
+        std::memcpy(h.name, elf.name, namelen);
+        h.dependencies = static_cast<uint32_t>(elf.dependency.size());
+        h.imports = static_cast<uint32_t>(elf.imports.size());
+        h.functions = static_cast<uint32_t>(elf.text.size());
+        size_t at = align(sizeof(header_t));
+        size_t dep_at = at;
+        at += align(h.dependencies * sizeof(dependency_t));
+        size_t imp_at = at;
+        at += align(h.imports * sizeof(import_t));
+        size_t fn_at = at;
+        at += align(h.functions * sizeof(function_t));
+        h.code_offset = at;
+        std::vector<function_t> fn(h.functions);
+        std::vector<std::vector<uint8_t>> expanded(h.functions); // of compact code, see compact_assembly()
+        for (uint32_t i = 0; i < h.functions; i++)
+        {
+            const func_t &f = elf.text[i];
+            if (f.code().compact.size() != 0)
+                compact_assembly(f, expanded[i]);
+            size_t size = f.code().compact.size() != 0 ? expanded[i].size() : f.assembly.size();
+            fn[i] = { f.EIP_Begin, f.ESP, f.EIP, 0, at - h.code_offset, size };
+            at += align(size);
+        }
+        h.code_size = at - h.code_offset;
+        h.data_offset = at;
+        h.data_size = elf.data.size();
+        h.size = at + align(elf.data.size());
+        out.assign(h.size, 0);
+        std::memcpy(&out[0], &h, sizeof(h));
+        for (uint32_t i = 0; i < h.dependencies; i++)
+            std::memcpy(&out[dep_at + i * sizeof(dependency_t)], elf.dependency[i].name, namelen);
+        for (uint32_t i = 0; i < h.imports; i++)
+        {
+            import_t imp = { elf.imports[i].dependency_index, elf.imports[i].func_index };
+            std::memcpy(&out[imp_at + i * sizeof(import_t)], &imp, sizeof(imp));
+        }
+        if (h.functions != 0)
+            std::memcpy(&out[fn_at], fn.data(), h.functions * sizeof(function_t));
+        for (uint32_t i = 0; i < h.functions; i++)
+            if (fn[i].size != 0)
+                std::memcpy(&out[h.code_offset + fn[i].offset],
+                            expanded[i].size() != 0 ? expanded[i].data() : elf.text[i].assembly.data(), fn[i].size);
+        if (h.data_size != 0)
+            std::memcpy(&out[h.data_offset], elf.data.data(), h.data_size);
+    }
+    inline bool image_t::save(const elf_t &elf, const char *path)
+    {
+        std::vector<uint8_t> out;
+        save(elf, out);
+        std::FILE *file = std::fopen(path, "wb");
+        if (file == nullptr)
+            return false;
+        bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+        return std::fclose(file) == 0 && ok;
+    }
+}
@@ -0,0 +1,765 @@
+#pragma once
+#include <cstring>
+#include "AssemblyScript32.h"
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__unix__) || defined(__APPLE__))
+#define AS32_JIT 1
+#include <sys/mman.h>
+#else
+#define AS32_JIT 0
+#endif
+
+namespace asc {
+    // x86-64 JIT
+    // jit_t::compile verifies an elf and compiles every verified function into native code in an executable
+    // mmap'd buffer, func_t::native then runs instead of the threaded code. host registers while running:
+    //   rbp func_t*, ebx ESP, r12 assembly, r13 caller assembly, r14d caller ESP, r15 elf->data
+    // IMM local CALLs are direct native calls, IMM CALLEXTs call the extlib entry directly. wherever the
+    // interpreter result could differ (dynamic jump target, write into the own instructions, re-entered or
+    // self-modified after a call) the native code stores ESP/EIP and continues in func_t::run_switch(). a function
+    // called by itself runs its threaded code, its EBP_IA operands address the ESP that activation moves.
+    // functions that fail verification keep the interpreter. recompile after predecode() or verify().
+    struct jit_regs_t // filled by jit_enter, lives at [rsp] of the native frame
+    {
+        uint8_t *mem;       // +0
+        uint8_t *cmem;      // +8
+        uint8_t *data;      // +16
+        uint32_t cesp;      // +24
+        uint32_t csize;     // +28
+        func_t *caller;     // +32
+    };
+    inline int jit_enter(func_t *f, elf_t *elf, func_t *caller, jit_regs_t *r)
+    {
+        if (f->native == nullptr || f->verified != elf || f->stale || f->tracking(caller) || AS32_INSTRUMENTED())
+            return f->operator()(elf, caller); // direct call into code that is no longer valid, must mark writes or is profiled or traced
+        r->cesp = caller != nullptr ? caller->ESP : 0; // before the reset, caller may be f
+        f->ESP = 0;
+        f->EIP = f->EIP_Begin;
+        f->elf_local = elf;
+        f->caller = caller;
+        f->fault = fault_t::NONE;
+        if (caller == f) // called itself: EBP_IA follows the ESP the native code keeps in ebx, run threaded
+            return f->run_decoded<true>() == state_t::RET || f->fail();
+        r->mem = f->assembly.data();
+        r->data = elf->data.data();
+        r->caller = caller;
+        r->cmem = caller != nullptr ? caller->assembly.data() : nullptr;
+        r->csize = caller != nullptr ? static_cast<uint32_t>(caller->assembly.size()) : 0;
+        return -1;
+    }
+    inline bool jit_call(func_t *callee, elf_t *elf, func_t *self)
+    {
+        return callee->operator()(elf, self);
+    }
+    inline bool jit_call_dynamic(func_t *self, int32_t ind)
+    {
+        func_t *callable;
+        elf_t *elf_callee = self->elf_local;
+        if (self->callable_addressing(oprand_t::IMM, ind, callable, elf_callee) == false)
+            return false;
+        return callable->operator()(elf_callee, self);
+    }
+    inline bool jit_call_import(const elf_t::import_t *impo, func_t *self, int32_t ind)
+    {
+        func_t *bound = impo->bound();
+        if (bound != nullptr)
+            return bound->operator()(impo->target(), self);
+        return jit_call_dynamic(self, ind);
+    }
+    inline bool jit_callext(func_t *self, int32_t ind)
+    {
+        extfunc_t ext = ext_find(self->elf_local, ind);
+        return ext != nullptr && ext(self);
+    }
+    inline bool jit_fault(func_t *self)
+    {
+        if (compact_reach(*self)) // the caller's instructions are in its assembly now, run the faulted one again
+            return self->run_switch();
+        return self->fail();
+    }
+    inline bool jit_resume(func_t *self)
+    {
+        return self->run_switch();
+    }
+    inline bool jit_resume_call(func_t *self) // after a CALL/CALLEXT that re-entered or modified us
+    {
+        self->EIP += 2 * sizeof(uint32_t);
+        return self->run_switch();
+    }
+
+    struct jit_asm_t
+    {
+        enum reg_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+        enum cc_t { B = 2, AE = 3, E = 4, NE = 5, L = 0xC, GE = 0xD, G = 0xF };
+        std::vector<uint8_t> code;
+
+        inline void byte(uint8_t b) { code.push_back(b); }
+        inline void dword(uint32_t v)
+        {
+            for (int i = 0; i < 4; i++)
+                byte((v >> (8 * i)) & 0xff);
+        }
+        inline void qword(uint64_t v)
+        {
+            dword(static_cast<uint32_t>(v));
+            dword(static_cast<uint32_t>(v >> 32));
+        }
+        inline void rex(bool w, int reg, int index, int base)
+        {
+            uint8_t r = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+            if (r != 0x40)
+                byte(r);
+        }
+        // opcode reg, [base + index + disp], index < 0 for none
+        inline void rm(std::initializer_list<uint8_t> opcode, bool w, int reg, int base, int index, int32_t disp)
+        {
+            rex(w, reg & 15, index < 0 ? 0 : index, base);
+            for (auto it : opcode)
+                byte(it);
+            if (index < 0 && (base & 7) != RSP)
+                byte(0x80 | ((reg & 7) << 3) | (base & 7));
+            else
+            {
+                byte(0x84 | ((reg & 7) << 3));
+                byte((((index < 0 ? RSP : index) & 7) << 3) | (base & 7));
+            }
+            dword(disp);
+        }
+        // opcode reg, rm
+        inline void rr(std::initializer_list<uint8_t> opcode, bool w, int reg, int rm)
+        {
+            rex(w, reg & 15, 0, rm);
+            for (auto it : opcode)
+                byte(it);
+            byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+        }
+        inline void mov_imm(int reg, uint32_t imm)
+        {
+            rex(false, 0, 0, reg);
+            byte(0xB8 | (reg & 7));
+            dword(imm);
+        }
+        inline void mov_imm64(int reg, uint64_t imm)
+        {
+            rex(true, 0, 0, reg);
+            byte(0xB8 | (reg & 7));
+            qword(imm);
+        }
+        inline void cmp_imm(int reg, uint32_t imm) { rr({ 0x81 }, false, 7, reg), dword(imm); }
+        inline void push(int reg) { rex(false, 0, 0, reg), byte(0x50 | (reg & 7)); }
+        inline void pop(int reg) { rex(false, 0, 0, reg), byte(0x58 | (reg & 7)); }
+        inline void call_abs(const void *fn)
+        {
+            mov_imm64(RAX, reinterpret_cast<uint64_t>(fn));
+            byte(0xFF), byte(0xD0); // call rax
+        }
+        // rel32 branches, return the position to patch
+        inline size_t jcc(int cc) { byte(0x0F), byte(0x80 | cc), dword(0); return code.size() - 4; }
+        inline size_t jmp() { byte(0xE9), dword(0); return code.size() - 4; }
+        inline size_t call() { byte(0xE8), dword(0); return code.size() - 4; }
+        inline void patch(size_t at, size_t target)
+        {
+            uint32_t rel = static_cast<uint32_t>(target - (at + 4));
+            for (int i = 0; i < 4; i++)
+                code[at + i] = (rel >> (8 * i)) & 0xff;
+        }
+    };
+
+    struct jit_t
+    {
+        std::vector<std::pair<void *, size_t>> maps;
+        std::vector<func_t *> compiled;
+        ~jit_t() { reset(); }
+        bool compile(elf_t &elf);   // true if every function was compiled
+        inline void reset()
+        {
+            for (auto it : compiled)
+                it->native = nullptr;
+            compiled.clear();
+#if AS32_JIT
+            for (auto &it : maps)
+                munmap(it.first, it.second);
+#endif
+            maps.clear();
+        }
+    };
+
+#if AS32_JIT
+    struct jit_compiler_t : jit_asm_t
+    {
+        elf_t *elf;
+        func_t *f;
+        std::vector<size_t> entry;                          // per text index, SIZE_MAX if interpreted
+        std::vector<std::pair<size_t, size_t>> entry_calls; // call rel32 position, text index
+        std::vector<size_t> at;                             // per decoded index
+        std::vector<std::pair<size_t, size_t>> jumps;       // jmp/jcc rel32 position, decoded index
+        struct stub_t
+        {
+            enum kind_t { FAULT, STALE, CALL } kind;
+            uint32_t eip;
+            std::vector<size_t> patches;
+        };
+        std::vector<stub_t> stubs;
+        std::vector<size_t> epilogue;
+        std::vector<size_t> failed;                         // jumps of failed CALLs/CALLEXTs, fault recorded there
+        int32_t off_ESP, off_EIP, off_stale, off_code_lo, off_code_len;
+
+        inline jit_compiler_t()
+        {
+            static func_t probe = {};
+            auto off = [](const void *member) { return static_cast<int32_t>((const char *)member - (const char *)&probe); };
+            off_ESP = off(&probe.ESP);
+            off_EIP = off(&probe.EIP);
+            off_stale = off(&probe.stale);
+            off_code_lo = off(&probe.code_lo);
+            off_code_len = off(&probe.code_len);
+        }
+        inline stub_t &stub(stub_t::kind_t kind, uint32_t eip)
+        {
+            stubs.push_back({ kind, eip, {} });
+            return stubs.back();
+        }
+        inline uint32_t size() { return static_cast<uint32_t>(f->assembly.size()); }
+        inline void store_regs(uint32_t eip)
+        {
+            rm({ 0x89 }, false, RBX, RBP, -1, off_ESP);     // mov [rbp+ESP], ebx
+            rm({ 0xC7 }, false, 0, RBP, -1, off_EIP);       // mov dword [rbp+EIP], eip
+            dword(eip);
+        }
+        inline void to_epilogue() { epilogue.push_back(jmp()); }
+        // operand value into reg, may use r8
+        inline void read(int reg, oprand_t opt, int32_t op, stub_t &fault)
+        {
+            switch (opt)
+            {
+            case oprand_t::IMM:
+                mov_imm(reg, op);
+                break;
+            case oprand_t::ESP:
+                rm({ 0x8D }, false, reg, RBX, -1, op);          // lea reg, [rbx+op]
+                break;
+            case oprand_t::IA:
+                rm({ 0x8B }, false, reg, R12, -1, op);          // verified in bounds
+                break;
+            case oprand_t::ESP_IA:
+                rm({ 0x8D }, false, R8, RBX, -1, op);
+                cmp_imm(R8, size());
+                fault.patches.push_back(jcc(AE));
+                rm({ 0x8B }, false, reg, R12, R8, 0);
+                break;
+            case oprand_t::EBP_IA:
+                rm({ 0x8D }, false, R8, R14, -1, op);
+                rm({ 0x3B }, false, R8, RSP, -1, 28);           // cmp r8d, csize
+                fault.patches.push_back(jcc(AE));
+                rm({ 0x8B }, false, reg, R13, R8, 0);
+                break;
+            case oprand_t::DATA_IA:
+                rm({ 0x8B }, false, reg, R15, -1, op);          // verified in bounds
+                break;
+            default:
+                fault.patches.push_back(jmp());
+                break;
+            }
+        }
+        struct touch_t
+        {
+            oprand_t opt;
+            int32_t op;
+            int offreg;
+        };
+        // address of a written operand into ptr, the offset of ESP/EBP relative ones stays in offreg
+        inline touch_t write_address(oprand_t opt, int32_t op, int offreg, int ptr, stub_t &fault)
+        {
+            switch (opt)
+            {
+            case oprand_t::IA:
+                rm({ 0x8D }, true, ptr, R12, -1, op);
+                break;
+            case oprand_t::ESP_IA:
+                rm({ 0x8D }, false, offreg, RBX, -1, op);
+                cmp_imm(offreg, size());
+                fault.patches.push_back(jcc(AE));
+                rm({ 0x8D }, true, ptr, R12, offreg, 0);
+                break;
+            case oprand_t::EBP_IA:
+                rm({ 0x8D }, false, offreg, R14, -1, op);
+                rm({ 0x3B }, false, offreg, RSP, -1, 28);
+                fault.patches.push_back(jcc(AE));
+                rm({ 0x8D }, true, ptr, R13, offreg, 0);
+                break;
+            case oprand_t::DATA_IA:
+                rm({ 0x8D }, true, ptr, R15, -1, op);
+                break;
+            default:
+                fault.patches.push_back(jmp());
+                break;
+            }
+            return { opt, op, offreg };
+        }
+        // func_t::touch of a finished write, own instructions hit -> stale and continue in run_switch
+        inline void touch(const touch_t &t, uint32_t next)
+        {
+            switch (t.opt)
+            {
+            case oprand_t::IA:
+                if (static_cast<uint32_t>(t.op) - f->code_lo < f->code_len)
+                    stub(stub_t::STALE, next).patches.push_back(jmp());
+                break;
+            case oprand_t::ESP_IA:
+                rm({ 0x8D }, false, RAX, t.offreg, -1, -static_cast<int32_t>(f->code_lo));
+                cmp_imm(RAX, f->code_len);
+                stub(stub_t::STALE, next).patches.push_back(jcc(B));
+                break;
+            case oprand_t::EBP_IA:
+            {
+                rm({ 0x8B }, true, RCX, RSP, -1, 32);           // mov rcx, caller
+                rr({ 0x8B }, false, RAX, t.offreg);
+                rm({ 0x2B }, false, RAX, RCX, -1, off_code_lo); // sub eax, [rcx+code_lo]
+                rm({ 0x3B }, false, RAX, RCX, -1, off_code_len);
+                size_t skip = jcc(AE);
+                rm({ 0xC6 }, false, 0, RCX, -1, off_stale);     // mov byte [rcx+stale], 1
+                byte(1);
+                patch(skip, code.size());
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        inline void touch_esp(int32_t adjust, uint32_t next)
+        {
+            rm({ 0x8D }, false, RAX, RBX, -1, adjust - static_cast<int32_t>(f->code_lo));
+            cmp_imm(RAX, f->code_len);
+            stub(stub_t::STALE, next).patches.push_back(jcc(B));
+        }
+        inline void esp_check(stub_t &fault)
+        {
+            cmp_imm(RBX, size());
+            fault.patches.push_back(jcc(AE));
+        }
+        inline void jump_to(uint32_t target) { jumps.push_back({ jmp(), target - 1 }); }
+        inline void jump_dynamic() // target in eax, not proven: continue interpreted
+        {
+            rm({ 0x89 }, false, RBX, RBP, -1, off_ESP);
+            rm({ 0x89 }, false, RAX, RBP, -1, off_EIP);
+            rr({ 0x89 }, true, RBP, RDI);
+            call_abs((const void *)&jit_resume);
+            rr({ 0x0F, 0xB6 }, false, RAX, RAX);
+            to_epilogue();
+        }
+        inline void after_call(const insn_t &in, stub_t &bail, bool reload_esp)
+        {
+            rr({ 0x0F, 0xB6 }, false, RAX, RAX);                // movzx eax, al
+            rr({ 0x85 }, false, RAX, RAX);
+            failed.push_back(jcc(E));                           // failed, record and return false
+            rm({ 0x81 }, false, 7, RBP, -1, off_EIP);           // cmp dword [rbp+EIP], eip
+            dword(in.eip);
+            bail.patches.push_back(jcc(NE));
+            rm({ 0x80 }, false, 7, RBP, -1, off_stale);         // cmp byte [rbp+stale], 0
+            byte(0);
+            bail.patches.push_back(jcc(NE));
+            if (reload_esp)
+                rm({ 0x8B }, false, RBX, RBP, -1, off_ESP);
+            rm({ 0x8B }, true, RCX, RSP, -1, 32);               // caller ESP may have moved by a re-entry
+            rr({ 0x85 }, true, RCX, RCX);
+            size_t skip = jcc(E);
+            rm({ 0x8B }, false, R14, RCX, -1, off_ESP);
+            patch(skip, code.size());
+        }
+
+        inline void insn(const insn_t &in)
+        {
+            stub(stub_t::FAULT, in.eip);
+            size_t fault = stubs.size() - 1;
+            auto F = [&]() -> stub_t & { return stubs[fault]; }; // stubs grows while emitting
+            uint32_t next = in.eip + (in.kind == insn_t::MOV || in.kind == insn_t::XCHG || (in.kind >= insn_t::ADD && in.kind <= insn_t::CMPGE) ? 12 : 8);
+            switch (in.kind)
+            {
+            case insn_t::MOV:
+            {
+                touch_t t = write_address(in.oprandT1, in.op1, R10, R9, F());
+                read(RAX, in.oprandT2, in.op2, F());
+                rm({ 0x89 }, false, RAX, R9, -1, 0);
+                touch(t, next);
+            }
+            break;
+            case insn_t::MOVE:
+                read(RAX, in.oprandT2, in.op1, F());
+                rr({ 0x89 }, false, RAX, RBX);
+                break;
+            case insn_t::XCHG:
+            {
+                touch_t t1 = write_address(in.oprandT1, in.op1, R10, R9, F());
+                touch_t t2 = write_address(in.oprandT2, in.op2, R11, RSI, F());
+                rm({ 0x8B }, false, RAX, R9, -1, 0);
+                rm({ 0x8B }, false, RCX, RSI, -1, 0);
+                rm({ 0x89 }, false, RCX, R9, -1, 0);
+                rm({ 0x89 }, false, RAX, RSI, -1, 0);
+                touch(t1, next);
+                touch(t2, next);
+            }
+            break;
+            case insn_t::INC:
+            case insn_t::DEC:
+            case insn_t::NEG:
+            {
+                touch_t t = write_address(in.oprandT1, in.op1, R10, R9, F());
+                if (in.kind == insn_t::NEG)
+                    rm({ 0xF7 }, false, 3, R9, -1, 0);
+                else
+                {
+                    rm({ 0x81 }, false, in.kind == insn_t::INC ? 0 : 5, R9, -1, 0);
+                    dword(1);
+                }
+                touch(t, next);
+            }
+            break;
+            case insn_t::ADD: case insn_t::SUB: case insn_t::MUL: case insn_t::DIV:
+            case insn_t::AND: case insn_t::OR: case insn_t::XOR: case insn_t::SHL:
+            case insn_t::CMP: case insn_t::CMPG: case insn_t::CMPGE:
+            {
+                read(RAX, in.oprandT1, in.op1, F());
+                read(RCX, in.oprandT2, in.op2, F());
+                esp_check(F());
+                size_t skip = SIZE_MAX;
+                switch (in.kind)
+                {
+                case insn_t::ADD: rr({ 0x03 }, false, RAX, RCX); break;
+                case insn_t::SUB: rr({ 0x2B }, false, RAX, RCX); break;
+                case insn_t::MUL: rr({ 0x0F, 0xAF }, false, RAX, RCX); break;
+                case insn_t::AND: rr({ 0x23 }, false, RAX, RCX); break;
+                case insn_t::OR: rr({ 0x0B }, false, RAX, RCX); break;
+                case insn_t::XOR: rr({ 0x33 }, false, RAX, RCX); break;
+                case insn_t::DIV:
+                    rr({ 0x85 }, false, RCX, RCX);
+                    F().patches.push_back(jcc(E));
+                    byte(0x99);                                 // cdq
+                    rr({ 0xF7 }, false, 7, RCX);                // idiv ecx
+                    break;
+                case insn_t::SHL:
+                {
+                    rr({ 0x85 }, false, RCX, RCX);
+                    skip = jcc(E);                              // SHL 0 leaves [ESP] alone
+                    size_t right = jcc(L);
+                    rr({ 0xD3 }, false, 4, RAX);                // shl eax, cl
+                    size_t done = jmp();
+                    patch(right, code.size());
+                    rr({ 0xF7 }, false, 3, RCX);                // neg ecx
+                    rr({ 0xD3 }, false, 7, RAX);                // sar eax, cl
+                    patch(done, code.size());
+                    break;
+                }
+                default:
+                    rr({ 0x3B }, false, RAX, RCX);              // cmp eax, ecx
+                    byte(0x0F), byte(0x90 | (in.kind == insn_t::CMP ? E : in.kind == insn_t::CMPG ? G : GE)), byte(0xC0);
+                    rr({ 0x0F, 0xB6 }, false, RAX, RAX);
+                    break;
+                }
+                rm({ 0x89 }, false, RAX, R12, RBX, 0);          // mov [r12+rbx], eax
+                touch_esp(0, next);
+                if (skip != SIZE_MAX)
+                    patch(skip, code.size());
+            }
+            break;
+            case insn_t::NOT:
+                read(RAX, in.oprandT1, in.op1, F());
+                esp_check(F());
+                rr({ 0xF7 }, false, 2, RAX);
+                rm({ 0x89 }, false, RAX, R12, RBX, 0);
+                touch_esp(0, next);
+                break;
+            case insn_t::PUSH:
+                read(RAX, in.oprandT1, in.op1, F());
+                esp_check(F());
+                rm({ 0x89 }, false, RAX, R12, RBX, 0);
+                rr({ 0x81 }, false, 0, RBX), dword(4);          // add ebx, 4
+                touch_esp(-4, next);
+                break;
+            case insn_t::POP:
+                cmp_imm(RBX, 4);
+                F().patches.push_back(jcc(B));
+                rr({ 0x81 }, false, 5, RBX), dword(4);
+                break;
+            case insn_t::JMP:
+                if (in.oprandT1 == oprand_t::IMM)
+                    jump_to(in.op2);
+                else
+                {
+                    read(RAX, in.oprandT1, in.op1, F());
+                    jump_dynamic();
+                }
+                break;
+            case insn_t::JZ:
+            case insn_t::JNZ:
+            {
+                read(RAX, in.oprandT1, in.op1, F());
+                esp_check(F());
+                rm({ 0x8B }, false, RCX, R12, RBX, 0);
+                rr({ 0x85 }, false, RCX, RCX);
+                int taken = in.kind == insn_t::JZ ? E : NE;
+                if (in.oprandT1 == oprand_t::IMM)
+                    jumps.push_back({ jcc(taken), in.op2 - 1 });
+                else
+                {
+                    size_t skip = jcc(taken ^ 1);
+                    jump_dynamic();
+                    patch(skip, code.size());
+                }
+            }
+            break;
+            case insn_t::CALL:
+            {
+                if (in.oprandT1 == oprand_t::IMM && in.op1 >= 0)
+                {
+                    store_regs(in.eip);
+                    mov_imm64(RDI, reinterpret_cast<uint64_t>(&elf->text[in.op1]));
+                    mov_imm64(RSI, reinterpret_cast<uint64_t>(elf));
+                    rr({ 0x89 }, true, RBP, RDX);
+                    if (entry[in.op1] != SIZE_MAX)
+                        entry_calls.push_back({ call(), static_cast<size_t>(in.op1) });
+                    else
+                        call_abs((const void *)&jit_call);
+                }
+                else if (in.oprandT1 == oprand_t::IMM) // bound import, the imports table stays where it is
+                {
+                    store_regs(in.eip);
+                    mov_imm64(RDI, reinterpret_cast<uint64_t>(&elf->imports[-1 - in.op1]));
+                    rr({ 0x89 }, true, RBP, RSI);
+                    mov_imm(RDX, static_cast<uint32_t>(in.op1));
+                    call_abs((const void *)&jit_call_import);
+                }
+                else
+                {
+                    read(RSI, in.oprandT1, in.op1, F());
+                    store_regs(in.eip);
+                    rr({ 0x89 }, true, RBP, RDI);
+                    call_abs((const void *)&jit_call_dynamic);
+                }
+                after_call(in, stub(stub_t::CALL, in.eip), false);
+            }
+            break;
+            case insn_t::CALLEXT:
+            {
+                if (in.oprandT1 == oprand_t::IMM)
+                {
+                    store_regs(in.eip);
+                    rr({ 0x89 }, true, RBP, RDI);
+                    call_abs((const void *)ext_find(elf, in.op1)); // the module's table, fixed once compiled
+                }
+                else
+                {
+                    read(RSI, in.oprandT1, in.op1, F());
+                    store_regs(in.eip);
+                    rr({ 0x89 }, true, RBP, RDI);
+                    call_abs((const void *)&jit_callext);
+                }
+                after_call(in, stub(stub_t::CALL, in.eip), true);
+            }
+            break;
+            case insn_t::RET:
+                store_regs(in.eip);
+                mov_imm(RAX, 1);
+                to_epilogue();
+                break;
+            case insn_t::NOP:
+            case insn_t::YIELD: // native code runs recursively, nothing to hand control back to
+                break;
+            case insn_t::GOTO:
+                jump_to(in.op2);
+                break;
+            default:
+                F().patches.push_back(jmp());
+                break;
+            }
+        }
+
+        // native code of f appended to code, false if it cannot be compiled
+        inline bool function(func_t &func)
+        {
+            for (auto &it : func.decoded) // the heap stays with the interpreter
+                if (it.kind == insn_t::ALLOC || it.kind == insn_t::FREE || it.oprandT1 == oprand_t::HEAP_IA || it.oprandT2 == oprand_t::HEAP_IA)
+                    return false;
+            f = &func;
+            at.clear();
+            jumps.clear();
+            stubs.clear();
+            epilogue.clear();
+            failed.clear();
+            size_t begin = code.size();
+            size_t calls = entry_calls.size();  // dropped with the code on failure
+            push(RBP), push(RBX), push(R12), push(R13), push(R14), push(R15);
+            rr({ 0x81 }, true, 5, RSP), dword(40);              // sub rsp, 40
+            rr({ 0x89 }, true, RDI, RBP);                       // mov rbp, rdi
+            rr({ 0x89 }, true, RSP, RCX);                       // mov rcx, rsp
+            call_abs((const void *)&jit_enter);
+            cmp_imm(RAX, static_cast<uint32_t>(-1));
+            epilogue.push_back(jcc(NE));
+            rm({ 0x8B }, true, R12, RSP, -1, 0);
+            rm({ 0x8B }, true, R13, RSP, -1, 8);
+            rm({ 0x8B }, true, R15, RSP, -1, 16);
+            rm({ 0x8B }, false, R14, RSP, -1, 24);
+            rr({ 0x33 }, false, RBX, RBX);                      // xor ebx, ebx
+            for (size_t i = 0; i < func.decoded.size(); i++)
+            {
+                at.push_back(code.size());
+                insn(func.decoded[i]);
+            }
+            for (auto &it : stubs)
+            {
+                if (it.patches.size() == 0)
+                    continue;
+                for (auto p : it.patches)
+                    patch(p, code.size());
+                switch (it.kind)
+                {
+                case stub_t::FAULT:
+                    store_regs(it.eip);
+                    rr({ 0x89 }, true, RBP, RDI);
+                    call_abs((const void *)&jit_fault);
+                    rr({ 0x0F, 0xB6 }, false, RAX, RAX);
+                    to_epilogue();
+                    break;
+                case stub_t::STALE:
+                    rm({ 0xC6 }, false, 0, RBP, -1, off_stale);
+                    byte(1);
+                    store_regs(it.eip);
+                    rr({ 0x89 }, true, RBP, RDI);
+                    call_abs((const void *)&jit_resume);
+                    rr({ 0x0F, 0xB6 }, false, RAX, RAX);
+                    to_epilogue();
+                    break;
+                case stub_t::CALL:
+                    rr({ 0x89 }, true, RBP, RDI);
+                    call_abs((const void *)&jit_resume_call);
+                    rr({ 0x0F, 0xB6 }, false, RAX, RAX);
+                    to_epilogue();
+                    break;
+                }
+            }
+            if (failed.size() != 0)
+            {
+                for (auto p : failed)
+                    patch(p, code.size());
+                rr({ 0x89 }, true, RBP, RDI);
+                call_abs((const void *)&jit_fault);
+                rr({ 0x0F, 0xB6 }, false, RAX, RAX);
+                to_epilogue();
+            }
+            for (auto &it : jumps)
+            {
+                if (it.second >= at.size())
+                {
+                    code.resize(begin);
+                    entry_calls.resize(calls);
+                    return false;
+                }
+                patch(it.first, at[it.second]);
+            }
+            for (auto p : epilogue)
+                patch(p, code.size());
+            rr({ 0x81 }, true, 0, RSP), dword(40);              // add rsp, 40
+            pop(R15), pop(R14), pop(R13), pop(R12), pop(RBX), pop(RBP);
+            byte(0xC3);
+            return true;
+        }
+    };
+
+    inline bool jit_t::compile(elf_t &elf)
+    {
+        elf.verify();
+        jit_compiler_t jc;
+        jc.elf = &elf;
+        jc.entry.assign(elf.text.size(), SIZE_MAX);
+        for (size_t i = 0; i < elf.text.size(); i++)
+            if (elf.text[i].verified == &elf && elf.text[i].decoded.size() != 0)
+                jc.entry[i] = 0;
+        bool all = true;
+        for (size_t i = 0; i < elf.text.size(); i++)
+        {
+            if (jc.entry[i] == SIZE_MAX)
+            {
+                all = false;
+                continue;
+            }
+            while (jc.code.size() % 16 != 0)
+                jc.byte(0xCC);
+            size_t begin = jc.code.size();
+            if (jc.function(elf.text[i]))
+                jc.entry[i] = begin;
+            else
+            {
+                jc.entry[i] = SIZE_MAX;
+                all = false;
+            }
+        }
+        // a callee dropped after its caller was emitted is reached through jit_call instead
+        size_t fallback = SIZE_MAX;
+        for (auto &it : jc.entry_calls)
+        {
+            if (jc.entry[it.second] != SIZE_MAX)
+            {
+                jc.patch(it.first, jc.entry[it.second]);
+                continue;
+            }
+            if (fallback == SIZE_MAX)
+            {
+                fallback = jc.code.size();
+                jc.mov_imm64(jit_asm_t::RAX, reinterpret_cast<uint64_t>(&jit_call));
+                jc.byte(0xFF), jc.byte(0xE0);               // jmp rax, arguments are in place
+            }
+            jc.patch(it.first, fallback);
+        }
+        if (jc.code.size() == 0)
+            return false;
+        size_t len = (jc.code.size() + 4095) & ~size_t(4095);
+        void *mem = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+            return false;
+        std::memcpy(mem, jc.code.data(), jc.code.size());
+        if (mprotect(mem, len, PROT_READ | PROT_EXEC) != 0)
+        {
+            munmap(mem, len);
+            return false;
+        }
+        maps.push_back({ mem, len });
+        for (size_t i = 0; i < elf.text.size(); i++)
+        {
+            if (jc.entry[i] == SIZE_MAX)
+                continue;
+            elf.text[i].native = reinterpret_cast<native_t>((uint8_t *)mem + jc.entry[i]);
+            compiled.push_back(&elf.text[i]);
+        }
+        return all;
+    }
+#else
+    inline bool jit_t::compile(elf_t &)
+    {
+        return false; // no backend for this target, everything stays interpreted
+    }
+#endif
+
+    // differential check of the JIT: make builds the same elf twice, one copy runs interpreted and one
+    // compiled. true if the result, every ESP, EIP, assembly and the data section are identical.
+    template <typename make_t>
+    inline bool jit_diff(make_t make, bool *compiled = nullptr)
+    {
+        elf_t interpreted, native;
+        make(interpreted);
+        make(native);
+        jit_t jit;
+        bool all = jit.compile(native);
+        if (compiled != nullptr)
+            *compiled = all;
+        if (interpreted() != native())
+            return false;
+        if (interpreted.data != native.data || interpreted.text.size() != native.text.size())
+            return false;
+        for (size_t i = 0; i < interpreted.text.size(); i++)
+        {
+            func_t &a = interpreted.text[i];
+            func_t &b = native.text[i];
+            if (a.ESP != b.ESP || a.EIP != b.EIP || a.assembly != b.assembly)
+                return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "AssemblyScript32.h"
+
+namespace asc {
+    // module registry
+    // registered elfs live in an open addressing table keyed by their name_t packed into 64 bits (bytes after
+    // the terminator ignored), so a dependency is found with one hash and mostly one probe. link() resolves all
+    // dependencies of an elf first and changes nothing if one is missing, then binds every import straight to
+    // its func_t in one pass: an import CALL then costs what a local CALL does. link(batch) registers a whole
+    // module graph before linking it, in any order. the registry does not own the elfs, unlink() before
+    // destroying one, and neither text vector may be resized while bound.
+    struct registry_t
+    {
+        struct slot_t
+        {
+            uint64_t key = 0;   // 0: empty, names are never empty
+            elf_t *elf = nullptr;
+        };
+        std::vector<slot_t> slots;
+        size_t count = 0;
+
+        static inline uint64_t key(const name_t name)
+        {
+            uint64_t k = 0;
+            for (size_t i = 0; i < namelen && name[i] != 0; i++)
+                k |= uint64_t(static_cast<uint8_t>(name[i])) << (8 * i);
+            return k;
+        }
+        static inline size_t mix(uint64_t k)
+        {
+            k ^= k >> 33;
+            k *= 0xFF51AFD7ED558CCD;
+            return static_cast<size_t>(k ^ (k >> 33));
+        }
+        inline elf_t *find(const name_t name) const
+        {
+            uint64_t k = key(name);
+            if (k == 0 || count == 0)
+                return nullptr;
+            size_t mask = slots.size() - 1;
+            for (size_t i = mix(k) & mask;; i = (i + 1) & mask)
+            {
+                if (slots[i].key == k)
+                    return slots[i].elf;
+                if (slots[i].key == 0)
+                    return nullptr;
+            }
+        }
+        inline bool add(elf_t *elf) // false if the name is empty or taken
+        {
+            uint64_t k = key(elf->name);
+            if (k == 0 || find(elf->name) != nullptr)
+                return false;
+            if ((count + 1) * 2 > slots.size())
+                grow();
+            place(k, elf);
+            count++;
+            return true;
+        }
+        inline bool remove(const name_t name)
+        {
+            uint64_t k = key(name);
+            if (k == 0 || count == 0)
+                return false;
+            size_t mask = slots.size() - 1;
+            size_t i = mix(k) & mask;
+            while (slots[i].key != k)
+            {
+                if (slots[i].key == 0)
+                    return false;
+                i = (i + 1) & mask;
+            }
+            // backward shift: pull every following entry that may sit in the hole
+            for (size_t j = (i + 1) & mask; slots[j].key != 0; j = (j + 1) & mask)
+            {
+                size_t home = mix(slots[j].key) & mask;
+                if (((j - home) & mask) >= ((j - i) & mask))
+                {
+                    slots[i] = slots[j];
+                    i = j;
+                }
+            }
+            slots[i] = {};
+            count--;
+            return true;
+        }
+        inline bool link(elf_t *elf)
+        {
+            std::vector<elf_t *> found(elf->dependency.size());
+            for (size_t i = 0; i < found.size(); i++)
+                if ((found[i] = find(elf->dependency[i].name)) == nullptr)
+                    return false;
+            for (auto &it : elf->imports)
+                if (it.dependency_index < 0 || static_cast<size_t>(it.dependency_index) >= found.size() ||
+                    it.func_index < 0 || static_cast<size_t>(it.func_index) >= found[it.dependency_index]->text.size())
+                    return false;
+            elf->unload_elf();
+            for (size_t i = 0; i < found.size(); i++)
+            {
+                elf->dependency[i].ptr = found[i];
+                found[i]->referenced.fetch_add(1);
+            }
+            for (auto &it : elf->imports)
+            {
+                it.retarget(found[it.dependency_index]);
+                it.rebind(&found[it.dependency_index]->text[it.func_index]);
+            }
+            return true;
+        }
+        inline bool link(const std::vector<elf_t *> &batch) // register and link, false if any of them failed
+        {
+            size_t n = count + batch.size();
+            while (n * 2 > slots.size())
+                grow();
+            bool ok = true;
+            for (auto it : batch)
+                ok = add(it) && ok;
+            for (auto it : batch)
+                ok = link(it) && ok;
+            return ok;
+        }
+        inline void unlink(elf_t *elf)
+        {
+            elf->unload_elf();
+            if (find(elf->name) == elf)
+                remove(elf->name);
+        }
+
+    private:
+        inline void place(uint64_t k, elf_t *elf)
+        {
+            size_t mask = slots.size() - 1;
+            size_t i = mix(k) & mask;
+            while (slots[i].key != 0)
+                i = (i + 1) & mask;
+            slots[i] = { k, elf };
+        }
+        inline void grow()
+        {
+            std::vector<slot_t> old = std::move(slots);
+            slots.assign(old.size() == 0 ? 16 : old.size() * 2, slot_t{});
+            for (auto &it : old)
+                if (it.key != 0)
+                    place(it.key, it.elf);
+        }
+    };
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "AssemblyScript32.h"
+
+namespace asc {
+    // work-stealing thread pool
+    // every worker owns a task deque: it takes its own tasks from the back and, once it runs dry, steals from
+    // the front of the other deques. run() deals the tasks out round robin and blocks until all of them ended.
+    struct pool_t
+    {
+        using task_t = std::function<void()>;
+        struct queue_t
+        {
+            std::mutex lock;
+            std::deque<task_t> tasks;
+        };
+        std::deque<queue_t> queues;
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::atomic<size_t> queued{ 0 };    // tasks waiting in the deques
+        std::atomic<size_t> pending{ 0 };   // tasks not finished yet
+        std::atomic<size_t> next{ 0 };      // round robin deque of the next push, tasks may push too
+        bool stop = false;
+
+        inline explicit pool_t(size_t threads = std::thread::hardware_concurrency())
+        {
+            if (threads == 0)
+                threads = 1;
+            queues.resize(threads);
+            for (size_t i = 0; i < threads; i++)
+                workers.emplace_back([this, i] { work(i); });
+        }
+        pool_t(const pool_t &) = delete;
+        pool_t &operator=(const pool_t &) = delete;
+        inline ~pool_t()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stop = true;
+            }
+            wake.notify_all();
+            for (auto &it : workers)
+                it.join();
+        }
+        inline void push(task_t task)
+        {
+            pending++;
+            queue_t &q = queues[next.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+            {
+                std::lock_guard<std::mutex> guard(q.lock);
+                q.tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                queued++;
+            }
+            wake.notify_one();
+        }
+        inline void wait() // until every pushed task ended
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            done.wait(guard, [this] { return pending == 0; });
+        }
+        inline void run(std::vector<context_t *> &contexts) // run every context once, results in context_t::result
+        {
+            for (auto it : contexts)
+                push([it] { (*it)(); });
+            wait();
+        }
+
+    private:
+        inline bool take(size_t i, task_t &task)
+        {
+            for (size_t n = 0; n < queues.size(); n++)
+            {
+                queue_t &q = queues[(i + n) % queues.size()];
+                std::lock_guard<std::mutex> guard(q.lock);
+                if (q.tasks.size() == 0)
+                    continue;
+                if (n == 0)
+                {
+                    task = std::move(q.tasks.back());
+                    q.tasks.pop_back();
+                }
+                else
+                {
+                    task = std::move(q.tasks.front());
+                    q.tasks.pop_front();
+                }
+                queued--;
+                return true;
+            }
+            return false;
+        }
+        inline void work(size_t i)
+        {
+            task_t task;
+            while (1)
+            {
+                if (take(i, task))
+                {
+                    task();
+                    task = nullptr;
+                    if (pending.fetch_sub(1) == 1)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        done.notify_all();
+                    }
+                    continue;
+                }
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [this] { return stop || queued != 0; });
+                if (stop)
+                    return;
+            }
+        }
+    };
+}
@@ -0,0 +1,361 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include "AssemblyScript32.h"
+
+namespace asc {
+    // execution profiler
+    // build the whole program with AS32_PROFILE 1, then start() a profile_t on the thread running the scripts.
+    // it counts every executed instruction by opcode x addressing mode x addressing mode in all engines, every
+    // call with its inclusive and exclusive wall time (func_t::operator() and exec_t frames), and every taken
+    // jump to an EIP at or before its own (a back-edge, the hot loops) per function. functions are keyed by their
+    // code: context_t instances and activations of one module function add up. while profiling, functions run
+    // threaded code instead of native code. a suspended exec_t keeps its frames open: profile one run at a time.
+    // report() writes a text report, folded() one line per call path with its exclusive ns ("a;b;c 1234"),
+    // the input of flamegraph.pl and similar tools. without AS32_PROFILE a profile_t stays empty.
+    struct profile_t
+    {
+        static constexpr bool enabled = AS32_PROFILE != 0;
+        static constexpr size_t modes = 9;      // oprand_t values, 8: not a mode
+        struct function_t
+        {
+            std::string name;                   // elf name#text index
+            uint64_t calls = 0;
+            uint64_t inclusive = 0;             // ns, outermost activations only
+            uint64_t exclusive = 0;             // ns
+            uint32_t depth = 0;                 // open activations
+            std::map<uint64_t, uint64_t> edges; // taken back-edges, from EIP << 32 | to EIP
+        };
+        struct node_t                           // call tree, one node per path
+        {
+            int32_t parent;
+            int32_t function;
+            uint64_t exclusive = 0;
+        };
+        struct frame_t
+        {
+            int32_t node;
+            int64_t start;
+            int64_t children = 0;
+        };
+        std::vector<uint64_t> insns = std::vector<uint64_t>(256 * modes * modes); // opcode (INT above 0xFF) x mode 1 x mode 2
+        std::vector<function_t> functions;
+        std::unordered_map<const func_t *, int32_t> ids;
+        std::vector<node_t> nodes;
+        std::unordered_map<uint64_t, int32_t> paths;   // parent node + 1 << 32 | function -> node
+        std::vector<frame_t> stack;
+
+        profile_t() = default;
+        profile_t(const profile_t &) = delete;
+        profile_t &operator=(const profile_t &) = delete;
+        inline ~profile_t() { stop(); }
+
+        inline void start() { profiling = this; }   // records this thread, adds to what it has
+        inline void stop()                          // closes the open frames at the current time
+        {
+            while (stack.size() != 0)
+                leave();
+            if (profiling == this)
+                profiling = nullptr;
+        }
+        inline void clear()
+        {
+            std::fill(insns.begin(), insns.end(), 0);
+            functions.clear();
+            ids.clear();
+            nodes.clear();
+            paths.clear();
+            stack.clear();
+        }
+        inline uint64_t total() const
+        {
+            uint64_t n = 0;
+            for (auto it : insns)
+                n += it;
+            return n;
+        }
+
+        inline void insn(uint16_t opcode, oprand_t t1, oprand_t t2)
+        {
+            size_t op = opcode > 0xFF ? static_cast<size_t>(opcode_t::INT) : opcode;
+            size_t m1 = std::min<size_t>(static_cast<size_t>(t1), modes - 1);
+            size_t m2 = std::min<size_t>(static_cast<size_t>(t2), modes - 1);
+            insns[(op * modes + m1) * modes + m2]++;
+        }
+        inline void enter(const func_t *f, const elf_t *elf)
+        {
+            int32_t id = function(f, elf);
+            functions[id].calls++;
+            functions[id].depth++;
+            int32_t parent = stack.size() != 0 ? stack.back().node : -1;
+            uint64_t key = (uint64_t(uint32_t(parent + 1)) << 32) | uint32_t(id);
+            auto it = paths.find(key);
+            int32_t node;
+            if (it != paths.end())
+                node = it->second;
+            else
+            {
+                node = static_cast<int32_t>(nodes.size());
+                nodes.push_back({ parent, id });
+                paths.emplace(key, node);
+            }
+            stack.push_back({ node, now() });
+        }
+        inline void leave()
+        {
+            if (stack.size() == 0) // entered before start()
+                return;
+            frame_t fr = stack.back();
+            stack.pop_back();
+            int64_t spent = now() - fr.start;
+            uint64_t self = static_cast<uint64_t>(std::max<int64_t>(spent - fr.children, 0));
+            node_t &n = nodes[fr.node];
+            function_t &fn = functions[n.function];
+            n.exclusive += self;
+            fn.exclusive += self;
+            if (--fn.depth == 0)
+                fn.inclusive += spent;
+            if (stack.size() != 0)
+                stack.back().children += spent;
+        }
+        inline void jump(const func_t *f, uint32_t from, uint32_t to)
+        {
+            functions[function(f, f->elf_local)].edges[(uint64_t(from) << 32) | to]++;
+        }
+
+        void report(std::string &out, size_t edges = 5) const;   // edges: hottest back-edges per function
+        void folded(std::string &out) const;
+
+        static const char *opcode_name(size_t opcode);
+        static size_t operands(size_t opcode);       // addressing modes an opcode uses
+        static const char *mode_name(size_t mode);
+
+    private:
+        static inline int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        inline int32_t function(const func_t *f, const elf_t *elf)
+        {
+            const func_t *key = &f->code();
+            auto it = ids.find(key);
+            if (it != ids.end())
+                return it->second;
+            int32_t id = static_cast<int32_t>(functions.size());
+            functions.emplace_back();
+            ids.emplace(key, id);
+            char name[32] = "?";
+            if (elf != nullptr)
+                for (size_t i = 0; i < elf->text.size(); i++)
+                    if (&elf->text[i] == f || &elf->text[i].code() == key)
+                    {
+                        std::snprintf(name, sizeof(name), "%.*s#%zu", static_cast<int>(namelen), elf->name, i);
+                        break;
+                    }
+            functions[id].name = name;
+            return id;
+        }
+    };
+
+    inline const char *profile_t::opcode_name(size_t opcode)
+    {
+        switch (static_cast<opcode_t>(opcode))
+        {
+        case opcode_t::MOV: return "MOV";
+        case opcode_t::MOVE: return "MOVE";
+        case opcode_t::XCHG: return "XCHG";
+        case opcode_t::ADD: return "ADD";
+        case opcode_t::SUB: return "SUB";
+        case opcode_t::MUL: return "MUL";
+        case opcode_t::DIV: return "DIV";
+        case opcode_t::INC: return "INC";
+        case opcode_t::DEC: return "DEC";
+        case opcode_t::NEG: return "NEG";
+        case opcode_t::AND: return "AND";
+        case opcode_t::OR: return "OR";
+        case opcode_t::XOR: return "XOR";
+        case opcode_t::NOT: return "NOT";
+        case opcode_t::SHL: return "SHL";
+        case opcode_t::PUSH: return "PUSH";
+        case opcode_t::POP: return "POP";
+        case opcode_t::JMP: return "JMP";
+        case opcode_t::JZ: return "JZ";
+        case opcode_t::JNZ: return "JNZ";
+        case opcode_t::CALL: return "CALL";
+        case opcode_t::CALLEXT: return "CALLEXT";
+        case opcode_t::RET: return "RET";
+        case opcode_t::NOP: return "NOP";
+        case opcode_t::INT: return "INT";
+        case opcode_t::YIELD: return "YIELD";
+        case opcode_t::CMP: return "CMP";
+        case opcode_t::CMPG: return "CMPG";
+        case opcode_t::CMPGE: return "CMPGE";
+        case opcode_t::ALLOC: return "ALLOC";
+        case opcode_t::FREE: return "FREE";
+        default: return nullptr;
+        }
+    }
+    inline size_t profile_t::operands(size_t opcode)
+    {
+        switch (static_cast<opcode_t>(opcode))
+        {
+        case opcode_t::MOV: case opcode_t::XCHG:
+        case opcode_t::ADD: case opcode_t::SUB: case opcode_t::MUL: case opcode_t::DIV:
+        case opcode_t::AND: case opcode_t::OR: case opcode_t::XOR: case opcode_t::SHL:
+        case opcode_t::CMP: case opcode_t::CMPG: case opcode_t::CMPGE:
+            return 2;
+        case opcode_t::MOVE: case opcode_t::INC: case opcode_t::DEC: case opcode_t::NEG: case opcode_t::NOT:
+        case opcode_t::PUSH: case opcode_t::JMP: case opcode_t::JZ: case opcode_t::JNZ:
+        case opcode_t::CALL: case opcode_t::CALLEXT: case opcode_t::ALLOC: case opcode_t::FREE:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+    inline const char *profile_t::mode_name(size_t mode)
+    {
+        static const char *const names[modes] = { "IMM", "IA", "ESP", "ESP_IA", "EBP", "EBP_IA", "DATA_IA", "HEAP_IA", "?" };
+        return names[std::min(mode, modes - 1)];
+    }
+    inline void profile_t::report(std::string &out, size_t edges) const
+    {
+        char line[256];
+        auto put = [&](const char *fmt, auto... args) {
+            std::snprintf(line, sizeof(line), fmt, args...);
+            out += line;
+        };
+        uint64_t all = total();
+        out.clear();
+        put("instructions: %llu%s\n", (unsigned long long)all, enabled ? "" : " (AS32_PROFILE is 0)");
+        // opcodes, hottest first, each with its addressing modes. MOVE addresses with mode 2
+        std::vector<std::pair<uint64_t, size_t>> ops;
+        uint64_t per_mode[modes] = {};
+        for (size_t op = 0; op < 256; op++)
+        {
+            uint64_t n = 0;
+            for (size_t m = 0; m < modes * modes; m++)
+            {
+                uint64_t c = insns[op * modes * modes + m];
+                n += c;
+                size_t arity = operands(op);
+                if (arity == 2 || (arity == 1 && static_cast<opcode_t>(op) != opcode_t::MOVE))
+                    per_mode[m / modes] += c;
+                if (arity == 2 || static_cast<opcode_t>(op) == opcode_t::MOVE)
+                    per_mode[m % modes] += c;
+            }
+            if (n != 0)
+                ops.push_back({ n, op });
+        }
+        std::sort(ops.begin(), ops.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+        out += "opcode          count       %\n";
+        for (auto &it : ops)
+        {
+            size_t op = it.second;
+            const char *name = opcode_name(op);
+            if (name != nullptr)
+                put("  %-10s %12llu %6.2f\n", name, (unsigned long long)it.first, 100.0 * it.first / all);
+            else
+                put("  0x%02zX       %12llu %6.2f\n", op, (unsigned long long)it.first, 100.0 * it.first / all);
+            size_t arity = operands(op);
+            if (arity == 0)
+                continue;
+            std::vector<std::pair<uint64_t, size_t>> rows;
+            for (size_t m1 = 0; m1 < modes; m1++)
+                for (size_t m2 = 0; m2 < modes; m2++)
+                {
+                    uint64_t c = insns[(op * modes + m1) * modes + m2];
+                    if (c == 0)
+                        continue;
+                    size_t key = arity == 2 ? m1 * modes + m2 : static_cast<opcode_t>(op) == opcode_t::MOVE ? m2 : m1;
+                    auto row = std::find_if(rows.begin(), rows.end(), [&](const auto &r) { return r.second == key; });
+                    if (row != rows.end())
+                        row->first += c;
+                    else
+                        rows.push_back({ c, key });
+                }
+            std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+            for (auto &r : rows)
+                if (arity == 2)
+                    put("    %-7s %-7s %10llu\n", mode_name(r.second / modes), mode_name(r.second % modes), (unsigned long long)r.first);
+                else
+                    put("    %-15s %10llu\n", mode_name(r.second), (unsigned long long)r.first);
+        }
+        out += "addressing mode   operands\n";
+        for (size_t m = 0; m < modes; m++)
+            if (per_mode[m] != 0)
+                put("  %-10s %12llu\n", mode_name(m), (unsigned long long)per_mode[m]);
+        // functions by exclusive time
+        std::vector<size_t> order(functions.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return functions[a].exclusive > functions[b].exclusive; });
+        out += "function            calls  inclusive ms  exclusive ms\n";
+        for (auto i : order)
+        {
+            const function_t &fn = functions[i];
+            if (fn.calls != 0)
+                put("  %-14s %10llu %13.3f %13.3f\n", fn.name.c_str(), (unsigned long long)fn.calls, fn.inclusive / 1e6, fn.exclusive / 1e6);
+        }
+        out += "back-edges          from EIP    to EIP         taken\n";
+        for (auto i : order)
+        {
+            const function_t &fn = functions[i];
+            std::vector<std::pair<uint64_t, uint64_t>> hot;
+            for (auto &e : fn.edges)
+                hot.push_back({ e.second, e.first });
+            std::sort(hot.begin(), hot.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+            for (size_t k = 0; k < hot.size() && k < edges; k++)
+                put("  %-14s %10u %9u %13llu\n", fn.name.c_str(), unsigned(hot[k].second >> 32), unsigned(hot[k].second & 0xFFFFFFFF), (unsigned long long)hot[k].first);
+        }
+    }
+    inline void profile_t::folded(std::string &out) const
+    {
+        out.clear();
+        std::vector<int32_t> path;
+        for (auto &n : nodes)
+        {
+            if (n.exclusive == 0)
+                continue;
+            path.clear();
+            for (int32_t at = static_cast<int32_t>(&n - nodes.data()); at >= 0; at = nodes[at].parent)
+                path.push_back(nodes[at].function);
+            for (size_t i = path.size(); i-- > 0;)
+            {
+                out += functions[path[i]].name;
+                out += i != 0 ? ';' : ' ';
+            }
+            out += std::to_string(n.exclusive);
+            out += '\n';
+        }
+    }
+
+    // the hooks of AssemblyScript32.h, only called while profiling is set
+    inline void profile_insn(uint16_t opcode, oprand_t t1, oprand_t t2)
+    {
+        profiling->insn(opcode, t1, t2);
+    }
+    inline void profile_decoded(const func_t *src, const insn_t *ip)
+    {
+        // GOTO is not an instruction, past the end the switch interpreter faults before it counts
+        if (ip->kind == insn_t::GOTO || ip->eip + 3 * sizeof(uint32_t) > src->assembly.size())
+            return;
+        uint16_t opcode;
+        std::memcpy(&opcode, &src->assembly[ip->eip], sizeof(opcode));
+        profiling->insn(opcode, ip->oprandT1, ip->oprandT2);
+    }
+    inline void profile_enter(const func_t *f, const elf_t *elf)
+    {
+        profiling->enter(f, elf);
+    }
+    inline void profile_leave()
+    {
+        profiling->leave();
+    }
+    inline void profile_jump(const func_t *f, uint32_t from, uint32_t to)
+    {
+        profiling->jump(f, from, to);
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include "AS32_link.h"
+
+namespace asc {
+    // epoch based reclamation
+    // a thread pins an epoch_t around each run that may call into a reloadable module (pin_t, once per run or
+    // tick, never per CALL), synchronize() returns once every run pinned before it has ended. a run pinned
+    // after it sees every store made before it. pins nest, a thread holds one slot of max_threads (of one
+    // epoch_t at a time) from its first pin until it exits, the epoch_t must outlive the threads using it.
+    struct epoch_t
+    {
+        static constexpr size_t max_threads = 256;
+        struct alignas(64) slot_t
+        {
+            std::atomic<uint64_t> epoch{ 0 };   // 0: not in a run
+            std::atomic<bool> taken{ false };
+        };
+        struct lease_t // the slot of this thread
+        {
+            epoch_t *owner = nullptr;
+            slot_t *slot = nullptr;
+            inline ~lease_t()
+            {
+                if (slot != nullptr)
+                    slot->taken.store(false);
+            }
+        };
+        struct pin_t
+        {
+            slot_t *slot;
+            uint64_t outer;
+            inline explicit pin_t(epoch_t &epochs) : slot(epochs.lease()), outer(slot->epoch.load(std::memory_order_relaxed))
+            {
+                if (outer != 0)
+                    return;
+                uint64_t e = epochs.global.load();
+                for (;;) // published: the store is seen by synchronize() or the global epoch it raised is seen here
+                {
+                    slot->epoch.store(e);
+                    uint64_t now = epochs.global.load();
+                    if (now == e)
+                        break;
+                    e = now;
+                }
+            }
+            inline ~pin_t()
+            {
+                if (outer == 0)
+                    slot->epoch.store(0, std::memory_order_release);
+            }
+            pin_t(const pin_t &) = delete;
+            pin_t &operator=(const pin_t &) = delete;
+        };
+        slot_t slots[max_threads];
+        std::atomic<size_t> used{ 0 };          // slots ever taken
+        std::atomic<uint64_t> global{ 1 };
+
+        inline slot_t *lease()
+        {
+            static thread_local lease_t mine;
+            if (mine.owner == this)
+                return mine.slot;
+            if (mine.slot != nullptr)
+                mine.slot->taken.store(false);
+            mine = {};
+            for (size_t i = 0;; i = (i + 1) % max_threads) // more threads than slots wait for one
+            {
+                bool free = false;
+                if (slots[i].taken.compare_exchange_strong(free, true))
+                {
+                    size_t n = used.load();
+                    while (n < i + 1 && used.compare_exchange_weak(n, i + 1) == false)
+                        ;
+                    mine.owner = this;
+                    mine.slot = &slots[i];
+                    return mine.slot;
+                }
+                if (i + 1 == max_threads)
+                    std::this_thread::yield();
+            }
+        }
+        inline void synchronize()
+        {
+            uint64_t target = global.fetch_add(1) + 1;
+            size_t n = used.load();
+            for (size_t i = 0; i < n; i++)
+                for (uint64_t e = slots[i].epoch.load(); e != 0 && e < target; e = slots[i].epoch.load())
+                    std::this_thread::yield();
+        }
+    };
+
+    // hot reload
+    // reload() replaces the registered module old with fresh (same name) while other threads keep running
+    // pinned runs. fresh is linked against the registry and migrate(old, fresh) may carry data over, then every
+    // registered importer of old is switched to fresh in three steps a CALL never sees half of: bound imports
+    // drop to their unbound path (import_t::ptr), import_t::ptr moves to fresh, imports are bound again, with a
+    // synchronize() between them. the CALL path takes no lock and touches no counter. once reload() returns no
+    // pinned run uses old any more and it is unlinked. runs still on old while migrate() copies can change old's
+    // data after the copy. a pin covers one run or tick, an exec_t suspended between ticks (budget, YIELD) keeps
+    // frames in old without one: reload() refuses while old->suspended counts such runs, and a run that suspends
+    // in old during reload() is counted there when it returns. destroy old only once old->suspended is 0, that
+    // is after those runs finished or were dropped (exec_t::drop()). context_t instances keep the module they
+    // were made of, which must outlive them.
+    // false, and nothing changed, if old is not registered or has suspended runs, the names differ, fresh cannot
+    // be linked or lacks a function an importer binds.
+    inline void keep_data(const elf_t &old, elf_t &fresh) // migrate: the words both data sections have
+    {
+        std::memcpy(fresh.data.data(), old.data.data(), std::min(old.data.size(), fresh.data.size()));
+    }
+    inline bool reload(registry_t &registry, epoch_t &epochs, elf_t *old, elf_t *fresh,
+        const std::function<void(const elf_t &, elf_t &)> &migrate = {})
+    {
+        if (old == fresh || registry.find(old->name) != old || registry_t::key(old->name) != registry_t::key(fresh->name) ||
+            old->suspended.load() != 0)
+            return false;
+        std::vector<elf_t::import_t *> imports;
+        std::vector<elf_t::dependency_t *> dependencies;
+        for (auto &slot : registry.slots)
+        {
+            if (slot.key == 0 || slot.elf == old)
+                continue;
+            for (auto &it : slot.elf->imports)
+                if (it.target() == old)
+                {
+                    if (it.func_index < 0 || static_cast<size_t>(it.func_index) >= fresh->text.size())
+                        return false;
+                    imports.push_back(&it);
+                }
+            for (auto &it : slot.elf->dependency)
+                if (it.ptr == old)
+                    dependencies.push_back(&it);
+        }
+        registry.remove(old->name);
+        if (registry.link(fresh) == false)
+        {
+            registry.add(old);
+            return false;
+        }
+        registry.add(fresh);
+        if (migrate)
+            migrate(*old, *fresh);
+
+        for (auto it : imports)
+            it->rebind(nullptr);
+        epochs.synchronize();
+        for (auto it : imports)
+            it->retarget(fresh);
+        for (auto it : dependencies)
+        {
+            it->ptr = fresh;
+            old->referenced.fetch_sub(1);
+            fresh->referenced.fetch_add(1);
+        }
+        epochs.synchronize();
+        for (auto it : imports)
+            it->rebind(&fresh->text[it->func_index]);
+        old->unload_elf();
+        return true;
+    }
+}
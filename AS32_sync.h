@@ -0,0 +1,243 @@
+#pragma once
+#include <cstring>
+#include "AssemblyScript32.h"
+
+namespace asc {
+    // state synchronization
+    // a tracked elf (elf_t::track) marks every 4-byte word written through addressing_w, in the assembly of its
+    // functions, in its data section and in the arena of its script heap. delta() encodes the registers of every
+    // function and the runs of marked words, then clears the marks. apply() writes a delta into a peer elf of the
+    // same shape, after checking all of it, and marks the written words if the peer is tracked. snapshot()
+    // encodes the whole state the same way, restore() is apply(). exchange them between runs, not while an exec_t
+    // is suspended. a tracked function never runs native code, which does not mark. the block table and free
+    // lists of the heap go in a delta only when heap_t::layout moved since the last one, as for digest_t.
+    //   state: uint32_t magic | uint32_t functions | functions x (uint32_t ESP, uint32_t EIP, runs) | data runs | heap
+    //   runs:  (uint32_t offset, uint32_t length, uint8_t bytes[length]) ... | (0, 0)
+    //   heap:  (uint32_t 0 | uint32_t 1, table), arena runs below top
+    //   table: top, limit, live, used, blocks x (off, size, gen | cls << 16 | live << 24), slots x slot,
+    //          classes x (uint32_t count, count x off) (blocks and slots lead with their uint32_t count)
+    constexpr uint32_t sync_magic = 0x44335341; // "AS3D"
+    constexpr size_t sync_gap = 2;              // clean words a run spans rather than starting another one
+
+    inline void sync_put(std::vector<uint8_t> &out, uint32_t v)
+    {
+        size_t at = out.size();
+        out.resize(at + sizeof(v));
+        std::memcpy(&out[at], &v, sizeof(v));
+    }
+    // every marked word of the size bytes at mem, or all of them without dirty
+    inline void sync_runs(std::vector<uint8_t> &out, const uint8_t *mem, size_t size, const dirty_t *dirty)
+    {
+        size_t words = (size + 3) / 4;
+        for (size_t w = 0; w < words;)
+        {
+            if (dirty != nullptr && dirty->test(w) == false)
+            {
+                w = (w >> 6) < dirty->bits.size() && dirty->bits[w >> 6] == 0 ? (w | 63) + 1 : w + 1;
+                continue;
+            }
+            size_t end = words;
+            if (dirty != nullptr)
+            {
+                end = w + 1;
+                for (size_t next = end; next < words && next <= end + sync_gap; next++)
+                    if (dirty->test(next))
+                        end = next + 1;
+            }
+            uint32_t off = static_cast<uint32_t>(w * 4);
+            uint32_t len = static_cast<uint32_t>(std::min(end * 4, size)) - off;
+            sync_put(out, off);
+            sync_put(out, len);
+            out.insert(out.end(), mem + off, mem + off + len);
+            w = end;
+        }
+        sync_put(out, 0);
+        sync_put(out, 0);
+    }
+    inline void sync_heap(std::vector<uint8_t> &out, const heap_t &heap, bool whole)
+    {
+        if (whole == false && heap.synced == heap.layout)
+        {
+            sync_put(out, 0);
+            return sync_runs(out, heap.arena.data(), heap.top, &heap.dirty);
+        }
+        sync_put(out, 1);
+        sync_put(out, heap.top);
+        sync_put(out, heap.limit);
+        sync_put(out, heap.live);
+        sync_put(out, heap.used);
+        sync_put(out, static_cast<uint32_t>(heap.blocks.size()));
+        for (auto &b : heap.blocks)
+        {
+            sync_put(out, b.off);
+            sync_put(out, b.size);
+            sync_put(out, uint32_t(b.gen) | uint32_t(b.cls) << 16 | uint32_t(b.live) << 24);
+        }
+        sync_put(out, static_cast<uint32_t>(heap.slots.size()));
+        for (auto slot : heap.slots)
+            sync_put(out, slot);
+        for (auto &list : heap.lists)
+        {
+            sync_put(out, static_cast<uint32_t>(list.size()));
+            for (auto off : list)
+                sync_put(out, off);
+        }
+        sync_runs(out, heap.arena.data(), heap.top, whole ? nullptr : &heap.dirty);
+    }
+    inline void sync_encode(const elf_t &elf, std::vector<uint8_t> &out, bool whole)
+    {
+        out.clear();
+        sync_put(out, sync_magic);
+        sync_put(out, static_cast<uint32_t>(elf.text.size()));
+        for (auto &it : elf.text)
+        {
+            sync_put(out, it.ESP);
+            sync_put(out, it.EIP);
+            sync_runs(out, it.assembly.bytes(), it.assembly.size(), whole ? nullptr : &it.dirty);
+        }
+        sync_runs(out, elf.data.bytes(), elf.data.size(), whole ? nullptr : &elf.dirty);
+        sync_heap(out, elf.heap, whole);
+    }
+    inline void delta(elf_t &elf, std::vector<uint8_t> &out) // changes since the last delta()
+    {
+        sync_encode(elf, out, false);
+        elf.dirty.clear();
+        elf.heap.synced = elf.heap.layout;
+        elf.heap.dirty.clear();
+        for (auto &it : elf.text)
+            it.dirty.clear();
+    }
+    inline void snapshot(const elf_t &elf, std::vector<uint8_t> &out)
+    {
+        sync_encode(elf, out, true);
+    }
+
+    // write: false only checks in, true applies the checked in
+    template <bool write>
+    inline bool sync_read(elf_t &elf, const uint8_t *in, size_t size)
+    {
+        size_t at = 0;
+        auto get = [&](uint32_t &v) {
+            if (size - at < sizeof(v))
+                return false;
+            std::memcpy(&v, in + at, sizeof(v));
+            at += sizeof(v);
+            return true;
+        };
+        // into the first bytes of mem, a bytes_t is owned only if a run is written
+        auto runs = [&](auto &mem, size_t bytes, dirty_t &dirty, func_t *f) {
+            uint32_t off, len;
+            while (get(off) && get(len))
+            {
+                if (len == 0)
+                    return true;
+                if (off > bytes || len > bytes - off || len > size - at)
+                    return false;
+                if (write)
+                {
+                    std::memcpy(&mem[off], in + at, len);
+                    if (dirty.tracked()) // an incremental digest_t rehashes what was applied
+                        dirty.mark(off, len);
+                    if (f != nullptr && off < f->code_lo + f->code_len && off + len > f->code_lo)
+                        f->stale = true;
+                }
+                at += len;
+            }
+            return false;
+        };
+        auto heap = [&](heap_t &h) {
+            uint32_t present, top, limit, live, used, blocks, slots;
+            if (get(present) == false || present > 1)
+                return false;
+            if (present == 0)
+                return runs(h.arena, h.top, h.dirty, nullptr);
+            if (!get(top) || !get(limit) || !get(live) || !get(used) || !get(blocks) || top > limit ||
+                used > blocks || blocks > heap_t::max_blocks)
+                return false;
+            auto fits = [&](uint32_t off, uint32_t cls) { // a whole block of class cls below top
+                return cls >= heap_t::min_class && cls < heap_t::classes && off <= top && (uint32_t(1) << cls) <= top - off;
+            };
+            if (write)
+            {
+                h.top = top, h.limit = limit, h.live = live, h.used = used;
+                h.blocks.resize(blocks);
+            }
+            for (uint32_t i = 0; i < blocks; i++)
+            {
+                uint32_t off, bytes, tag;
+                if (!get(off) || !get(bytes) || !get(tag))
+                    return false;
+                uint32_t gen = tag & 0xFFFF, cls = tag >> 16 & 0xFF, alive = tag >> 24;
+                if (gen == 0 || gen > 0x7FFF || cls >= heap_t::classes || alive > 1)
+                    return false;
+                if (alive != 0 && i < used && (fits(off, cls) == false || bytes < sizeof(int32_t) || bytes % 4 != 0 || bytes > (uint32_t(1) << cls)))
+                    return false;
+                if (write)
+                    h.blocks[i] = { off, bytes, static_cast<uint16_t>(gen), static_cast<uint8_t>(cls), alive != 0 };
+            }
+            if (get(slots) == false || slots > blocks)
+                return false;
+            if (write)
+                h.slots.resize(slots);
+            for (uint32_t i = 0; i < slots; i++)
+            {
+                uint32_t slot;
+                if (get(slot) == false || slot >= used)
+                    return false;
+                if (write)
+                    h.slots[i] = slot;
+            }
+            for (uint32_t cls = 0; cls < heap_t::classes; cls++)
+            {
+                uint32_t count;
+                if (get(count) == false || count > (size - at) / sizeof(uint32_t))
+                    return false;
+                if (write)
+                    h.lists[cls].resize(count);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    uint32_t off;
+                    if (get(off) == false || fits(off, cls) == false)
+                        return false;
+                    if (write)
+                        h.lists[cls][i] = off;
+                }
+            }
+            if (write)
+            {
+                if (h.arena.size() < top)
+                {
+                    h.arena.resize(top);
+                    if (h.dirty.tracked())
+                        h.dirty.grow(h.arena.size());
+                }
+                h.layout++;
+            }
+            return runs(h.arena, top, h.dirty, nullptr);
+        };
+        uint32_t magic, functions;
+        if (get(magic) == false || magic != sync_magic || get(functions) == false || functions != elf.text.size())
+            return false;
+        for (auto &it : elf.text)
+        {
+            uint32_t ESP, EIP;
+            if (get(ESP) == false || get(EIP) == false)
+                return false;
+            if (write)
+                it.ESP = ESP, it.EIP = EIP;
+            if (runs(it.assembly, it.assembly.size(), it.dirty, &it) == false)
+                return false;
+        }
+        return runs(elf.data, elf.data.size(), elf.dirty, nullptr) && heap(elf.heap) && at == size;
+    }
+    inline bool apply(elf_t &elf, const uint8_t *in, size_t size) // false and untouched if in does not fit elf
+    {
+        if (sync_read<false>(elf, in, size) == false)
+            return false;
+        return sync_read<true>(elf, in, size);
+    }
+    inline bool restore(elf_t &elf, const uint8_t *in, size_t size)
+    {
+        return apply(elf, in, size);
+    }
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include "AS32_profile.h"
+#include "AS32_fault.h"
+
+namespace asc {
+    // execution trace
+    // build the whole program with AS32_TRACE 1, then start() a trace_t on the thread running the scripts. every
+    // executed instruction (EIP, opcode, ESP), every call and return, every CALLEXT with its index and every fault
+    // with its fault_t goes into a ring of capacity records, the oldest are overwritten. one other thread at a
+    // time may drain() the ring while the scripts run: neither side locks or waits, a record overwritten before
+    // it was read is counted in lost. insns = false keeps only the calls, CALLEXTs and faults, a few records per
+    // call, for tracing left on in production. while tracing, functions run threaded code instead of native code.
+    // records name functions by address, the reader must not dereference them. without AS32_TRACE nothing is
+    // recorded, fault_reason() and diagnose() work either way.
+    struct trace_record_t
+    {
+        enum kind_t : uint8_t { INSN, CALL, RET, CALLEXT, FAULT };
+        const func_t *func;     // CALL: the callee
+        uint32_t eip;           // CALL: EIP and ESP of the caller, 0 without one
+        uint32_t esp;
+        int32_t arg;            // CALLEXT: the index
+        uint16_t opcode;        // INSN, CALLEXT, FAULT: of the instruction at eip
+        kind_t kind;
+        fault_t reason;         // FAULT
+    };
+    struct trace_t
+    {
+        static constexpr bool enabled = AS32_TRACE != 0;
+        static constexpr size_t words = 3;      // per record
+        std::unique_ptr<std::atomic<uint64_t>[]> ring;
+        size_t capacity;                        // records, a power of two
+        bool insns = true;                      // record every instruction
+        alignas(64) std::atomic<uint64_t> claimed{ 0 };     // records begun, written ahead of a record's words
+        std::atomic<uint64_t> written{ 0 };                 // records complete
+        alignas(64) uint64_t read = 0;          // drain() side
+        uint64_t lost = 0;
+
+        inline explicit trace_t(size_t records = 4096)
+        {
+            capacity = 1;
+            while (capacity < records)
+                capacity *= 2;
+            ring.reset(new std::atomic<uint64_t>[capacity * words]());
+        }
+        trace_t(const trace_t &) = delete;
+        trace_t &operator=(const trace_t &) = delete;
+        inline ~trace_t() { stop(); }
+
+        inline void start() { tracing = this; }     // records this thread
+        inline void stop()
+        {
+            if (tracing == this)
+                tracing = nullptr;
+        }
+        // the recording thread only
+        inline void push(const func_t *f, uint32_t eip, uint32_t esp, int32_t arg, uint16_t opcode,
+            trace_record_t::kind_t kind, fault_t reason = fault_t::NONE)
+        {
+            uint64_t n = written.load(std::memory_order_relaxed);
+            claimed.store(n + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);   // a reader that sees a word of n sees claimed
+            std::atomic<uint64_t> *w = &ring[(n & (capacity - 1)) * words];
+            w[0].store(reinterpret_cast<uintptr_t>(f), std::memory_order_relaxed);
+            w[1].store(eip | uint64_t(esp) << 32, std::memory_order_relaxed);
+            w[2].store(static_cast<uint32_t>(arg) | uint64_t(opcode) << 32 | uint64_t(kind) << 48 | uint64_t(reason) << 56,
+                std::memory_order_relaxed);
+            written.store(n + 1, std::memory_order_release);
+        }
+        // appends the records written since the last drain(), returns how many
+        inline size_t drain(std::vector<trace_record_t> &out)
+        {
+            uint64_t end = written.load(std::memory_order_acquire);
+            uint64_t begin = std::max(read, end > capacity ? end - capacity : 0);
+            size_t at = out.size();
+            out.resize(at + (end - begin));
+            for (uint64_t i = begin; i < end; i++)
+            {
+                const std::atomic<uint64_t> *w = &ring[(i & (capacity - 1)) * words];
+                uint64_t w0 = w[0].load(std::memory_order_relaxed);
+                uint64_t w1 = w[1].load(std::memory_order_relaxed);
+                uint64_t w2 = w[2].load(std::memory_order_relaxed);
+                trace_record_t &r = out[at + (i - begin)];
+                r.func = reinterpret_cast<const func_t *>(static_cast<uintptr_t>(w0));
+                r.eip = static_cast<uint32_t>(w1);
+                r.esp = static_cast<uint32_t>(w1 >> 32);
+                r.arg = static_cast<int32_t>(static_cast<uint32_t>(w2));
+                r.opcode = static_cast<uint16_t>(w2 >> 32);
+                r.kind = static_cast<trace_record_t::kind_t>(w2 >> 48 & 0xFF);
+                r.reason = static_cast<fault_t>(w2 >> 56);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t claim = claimed.load(std::memory_order_relaxed);
+            uint64_t valid = std::min(end, claim > capacity ? claim - capacity : 0); // older ones were overwritten meanwhile
+            if (valid > begin)
+            {
+                out.erase(out.begin() + at, out.begin() + at + (valid - begin));
+                begin = valid;
+            }
+            lost += begin - read;
+            read = end;
+            return out.size() - at;
+        }
+    };
+    // one line per record, functions as elf name#text index where the elf is still known
+    inline void trace_format(const trace_record_t &r, std::string &out)
+    {
+        static const char *const kinds[] = { "INSN", "CALL", "RET", "CALLEXT", "FAULT" };
+        char line[160];
+        int n = std::snprintf(line, sizeof(line), "%-7s %p eip %u esp %u", kinds[r.kind < 5 ? r.kind : 0], (const void *)r.func, r.eip, r.esp);
+        const char *name = profile_t::opcode_name(r.opcode);
+        if (r.kind == trace_record_t::INSN || r.kind == trace_record_t::CALLEXT || r.kind == trace_record_t::FAULT)
+            n += name != nullptr ? std::snprintf(line + n, sizeof(line) - n, " %s", name) :
+                                   std::snprintf(line + n, sizeof(line) - n, " 0x%04X", r.opcode);
+        if (r.kind == trace_record_t::CALLEXT)
+            n += std::snprintf(line + n, sizeof(line) - n, " %d", r.arg);
+        if (r.kind == trace_record_t::FAULT)
+            std::snprintf(line + n, sizeof(line) - n, " %s", fault_name(r.reason));
+        out += line;
+        out += '\n';
+    }
+
+    inline uint16_t trace_opcode(const func_t *f, uint32_t eip) // compact code has no instructions in assembly
+    {
+        uint16_t opcode = 0;
+        uint8_t at[3 * sizeof(uint32_t)];
+        if (f->in_stream())
+        {
+            if (f->fetch(eip, at))
+                std::memcpy(&opcode, at, sizeof(opcode));
+        }
+        else if (uint64_t(eip) + sizeof(opcode) <= f->assembly.size())
+            std::memcpy(&opcode, &f->assembly[eip], sizeof(opcode));
+        return opcode;
+    }
+    inline trace_t *trace_insns()
+    {
+        return tracing->insns ? tracing : nullptr;
+    }
+    inline void trace_insn(trace_t *t, const func_t *f, uint32_t eip, uint16_t opcode)
+    {
+        t->push(f, eip, f->ESP, 0, opcode, trace_record_t::INSN);
+    }
+    inline void trace_decoded(trace_t *t, const func_t *f, const insn_t *ip)
+    {
+        if (ip->kind != insn_t::GOTO)
+            t->push(f, ip->eip, f->ESP, 0, trace_opcode(f, ip->eip), trace_record_t::INSN);
+    }
+    inline void trace_enter(const func_t *f, const func_t *caller)
+    {
+        tracing->push(f, caller != nullptr ? caller->EIP : 0, caller != nullptr ? caller->ESP : 0, 0, 0, trace_record_t::CALL);
+    }
+    inline void trace_leave(func_t *f, bool ok)
+    {
+        if (ok)
+            tracing->push(f, f->EIP, f->ESP, 0, static_cast<uint16_t>(opcode_t::RET), trace_record_t::RET);
+        else
+            tracing->push(f, f->EIP, f->ESP, 0, trace_opcode(f, f->EIP), trace_record_t::FAULT, f->fault);
+    }
+    inline void trace_ext(const func_t *f, uint32_t eip, int32_t ind)
+    {
+        tracing->push(f, eip, f->ESP, ind, static_cast<uint16_t>(opcode_t::CALLEXT), trace_record_t::CALLEXT);
+    }
+}
@@ -0,0 +1,214 @@
+#pragma once
+#include <algorithm>
+#include <unordered_map>
+#include "AssemblyScript32.h"
+
+namespace asc {
+    // event-indexed trigger scheduler
+    // a script is one function of an elf (a module or a context_t instance). instead of running every script
+    // every tick, a script that finds its condition false registers what it waits for and returns: a data word
+    // of its elf (CALLEXT wait, offset at [ESP]) or a host event (CALLEXT on, event id at [ESP]). install() adds
+    // both host functions to an exttable_t. a write to a waited word through addressing_w or a host
+    // dirty.mark(), and signal(event), put exactly the scripts waiting on it into the next tick, through an index
+    // from word or event to the waiting scripts. waits are one-shot: every run drops the waits of the previous
+    // one. a script that waits on nothing runs every tick as before, a faulting one stops until wake().
+    // the elf of a script is tracked (elf_t::track), so it runs threaded code, and must outlive the trigger_t.
+    // an elf is watched by one trigger_t at a time: add() refuses an elf another one watches and a wait on it
+    // faults, as does a wait on a word past the data section tracked (track() again after growing it).
+    // ticks run on one thread, the ready scripts of a tick run together in the order they were added.
+    struct trigger_t;
+    inline thread_local trigger_t *triggering = nullptr;    // trigger_t running a script on this thread
+    struct trigger_t
+    {
+        struct script_t
+        {
+            elf_t *elf = nullptr;   // nullptr: removed
+            size_t func = 0;
+            uint32_t serial = 0;    // run count, a wait of an older run is stale
+            uint32_t waits = 0;     // registered by the last run
+            bool queued = false;    // in ready
+            bool failed = false;    // the last run faulted
+        };
+        struct waiter_t
+        {
+            uint32_t script;
+            uint32_t serial;
+        };
+        std::vector<script_t> scripts;
+        std::vector<elf_t *> elfs;                                  // watched elfs by dirty_t::watch_id
+        std::unordered_map<uint64_t, std::vector<waiter_t>> words;  // watch_id << 32 | word
+        std::unordered_map<int32_t, std::vector<waiter_t>> events;
+        std::vector<uint64_t> woken;                                // filled by dirty_t::mark
+        std::vector<uint32_t> ready;                                // scripts of the next tick
+        std::vector<uint32_t> batch;
+        uint32_t current = 0;                                       // script running, valid while triggering
+        int32_t wait_index = -1;                                    // CALLEXT indices, see install()
+        int32_t on_index = -1;
+        uint64_t runs = 0;
+        uint64_t faults = 0;
+
+        trigger_t() = default;
+        trigger_t(const trigger_t &) = delete;
+        trigger_t &operator=(const trigger_t &) = delete;
+        inline ~trigger_t()
+        {
+            for (auto it : elfs)
+                if (it->dirty.woken == &woken)
+                {
+                    it->dirty.woken = nullptr;
+                    it->dirty.watch = {};
+                }
+        }
+        inline void install(exttable_t &table)
+        {
+            wait_index = table.add(&trigger_t::wait);
+            on_index = table.add(&trigger_t::on);
+        }
+        inline uint32_t add(elf_t *elf, size_t func = 0) // script id, ready for the next tick. UINT32_MAX: watched elsewhere
+        {
+            if (watch(elf) == false)
+                return UINT32_MAX;
+            scripts.push_back({ elf, func });
+            uint32_t id = static_cast<uint32_t>(scripts.size() - 1);
+            wake(id);
+            return id;
+        }
+        inline void remove(uint32_t id)
+        {
+            scripts[id].elf = nullptr;
+            scripts[id].serial++;
+        }
+        inline void wake(uint32_t id)
+        {
+            script_t &s = scripts[id];
+            if (s.elf != nullptr && s.queued == false)
+            {
+                s.queued = true;
+                ready.push_back(id);
+            }
+        }
+        inline void signal(int32_t event)
+        {
+            auto it = events.find(event);
+            if (it != events.end())
+                fire(it->second);
+        }
+        size_t tick(); // runs the ready scripts, returns how many
+
+        // host functions, for scripts run outside a trigger_t they do nothing
+        static bool wait(func_t *caller);
+        static bool on(func_t *caller);
+
+        bool watch(elf_t *elf);
+        void fire(std::vector<waiter_t> &waiters);
+        void listen(std::vector<waiter_t> &waiters);
+        void collect();
+    };
+
+    // false if another trigger_t watches elf. watch follows the size of bits on every call, the elf may have been
+    // tracked again since
+    inline bool trigger_t::watch(elf_t *elf)
+    {
+        dirty_t &d = elf->dirty;
+        if (d.woken != nullptr && d.woken != &woken)
+            return false;
+        if (d.tracked() == false)
+            elf->track();
+        d.watch.resize(d.bits.size(), 0);
+        if (d.woken == nullptr)
+        {
+            d.watch_id = static_cast<uint32_t>(elfs.size());
+            d.woken = &woken;
+            elfs.push_back(elf);
+        }
+        return true;
+    }
+    inline void trigger_t::fire(std::vector<waiter_t> &waiters)
+    {
+        for (auto &w : waiters)
+            if (scripts[w.script].serial == w.serial)
+                wake(w.script);
+        waiters.clear();
+    }
+    // the waits of older runs are dropped when a list doubles, they would only pile up on words never written
+    inline void trigger_t::listen(std::vector<waiter_t> &waiters)
+    {
+        size_t n = waiters.size();
+        if (n >= 8 && (n & (n - 1)) == 0)
+            waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                [this](const waiter_t &w) { return scripts[w.script].serial != w.serial; }), waiters.end());
+        script_t &s = scripts[current];
+        waiters.push_back({ current, s.serial });
+        s.waits++;
+    }
+    inline void trigger_t::collect()
+    {
+        for (uint64_t key : woken)
+        {
+            auto it = words.find(key);
+            if (it != words.end())
+                fire(it->second);
+        }
+        woken.clear();
+    }
+    inline bool trigger_t::wait(func_t *caller)
+    {
+        trigger_t *t = triggering;
+        int32_t *off;
+        if (caller->addressing_esp(off) == false)
+            return false;
+        elf_t *elf = caller->elf_local;
+        if (elf == nullptr || *off < 0 || static_cast<uint32_t>(*off) + sizeof(int32_t) > elf->data.size())
+            return false;
+        if (t == nullptr)
+            return true;
+        uint32_t word = static_cast<uint32_t>(*off) >> 2;
+        if (t->watch(elf) == false || (word >> 6) >= elf->dirty.watch.size())
+            return false;
+        elf->dirty.watch[word >> 6] |= uint64_t(1) << (word & 63);
+        t->listen(t->words[uint64_t(elf->dirty.watch_id) << 32 | word]);
+        return true;
+    }
+    inline bool trigger_t::on(func_t *caller)
+    {
+        trigger_t *t = triggering;
+        int32_t *event;
+        if (caller->addressing_esp(event) == false)
+            return false;
+        if (t != nullptr)
+            t->listen(t->events[*event]);
+        return true;
+    }
+    inline size_t trigger_t::tick()
+    {
+        collect();
+        batch.swap(ready);
+        ready.clear();
+        std::sort(batch.begin(), batch.end());
+        trigger_t *outer = triggering;
+        triggering = this;
+        for (uint32_t id : batch)
+        {
+            script_t &s = scripts[id];
+            s.queued = false;
+            if (s.elf == nullptr)
+                continue;
+            s.serial++;
+            s.waits = 0;
+            current = id;
+            elf_t *elf = s.elf;
+            bool ok = s.func < elf->text.size() && elf->text[s.func](elf, nullptr);
+            script_t &after = scripts[id]; // a host function may have added scripts
+            runs++;
+            after.failed = !ok;
+            if (ok == false)
+                after.serial++, faults++;
+            else if (after.waits == 0)
+                wake(id); // polled
+        }
+        triggering = outer;
+        size_t ran = batch.size();
+        batch.clear();
+        return ran;
+    }
+}
@@ -1,7 +1,13 @@
 #pragma once
 #include <stdint.h>
+#include <algorithm>
 #include <vector>
 #include <atomic>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <type_traits>
+#include <utility>
 
 namespace asc{
     constexpr size_t namelen = 8;
@@ -37,10 +43,14 @@ namespace asc{
         RET = 0xC3,  // ():return
         NOP = 0x90,  // ():null operation
         INT = 0xCC,  // ():interrupt, dump core like segment fault.
+        YIELD = 0xF4, // ():hand control back to the host, a resumed exec_t continues after it. NOP when called recursively.
 
         CMP = 0x39,   // (op1,op2):compare op1 == op2, save result to [ESP]
         CMPG = 0x7D,  // (op1,op2):compare op1 > op2, save result to [ESP]
         CMPGE = 0x7E, // (op1,op2):compare op1 >= op2, save result to [ESP]
+
+        ALLOC = 0x68, // (op1):allocate op1 bytes of heap, push the handle (0 if the heap is exhausted)
+        FREE = 0x8F,  // (op1):free the heap block of handle op1, a freed or invalid handle faults
         // LEA = 0x8D,   // no need lea.
     };
     //all operands are deemed as int32_t
@@ -52,18 +62,449 @@ namespace asc{
         ESP_IA = 3,     // op = [esp + op]
         // EBP = 4,     // EBP cannot be altered, and cannot be read. EBP in the callee function means the caller fucntion ESP.
         EBP_IA = 5,     // op = [ebp + op]
-        DATA_IA = 6     // op = [data + op]
+        DATA_IA = 6,    // op = [data + op]
+        HEAP_IA = 7     // op = [heap block of the handle at [ESP - 4] + op], bounds and generation checked
     };
+    struct func_t;
     struct elf_t;
+    struct exec_t;
+    struct exttable_t;
+    // how a run of one activation ended
+    enum class state_t : uint8_t
+    {
+        FAULT,  // EIP at the faulting instruction
+        RET,    // EIP at the RET
+        FRAME,  // frame mode only: a CALL or RET changed the exec_t frame stack, continue with the top frame
+        BUDGET, // frame mode only: exec_t::fuel ran out, EIP at the next instruction, resumable
+        YIELD,  // frame mode only: YIELD executed, EIP after it, resumable
+    };
+    // why a run faulted at EIP, see AS32_fault.h
+    enum class fault_t : uint8_t
+    {
+        NONE,       // the instruction at EIP runs
+        EIP,        // no whole instruction at EIP
+        OPCODE,     // undefined opcode or INT
+        MODE,       // addressing mode unknown or EBP, or IMM/ESP written
+        ADDRESS,    // operand outside assembly, the caller's assembly (or no caller) or data
+        HEAP,       // HEAP_IA or FREE with a freed, stale or forged handle, outside the block
+        STACK,      // [ESP] outside assembly, POP at 0
+        DIVIDE,     // DIV by 0
+        CALL,       // CALL index without a function
+        CALLEE,     // the called function faulted (or exec_t::max_frames)
+        EXT,        // CALLEXT index without a host function
+        HOST,       // the host function returned false
+    };
+    using binary_t = int64_t (*)(func_t *, int32_t, int32_t);  // the result written to [ESP], or binary_fault
+    constexpr int64_t binary_fault = INT64_MIN;
+    using native_t = bool (*)(func_t *self, elf_t *elf, func_t *caller); // compiled function, see AS32_jit.h
+    // pre-decoded instruction, see func_t::predecode
+    struct insn_t
+    {
+        enum kind_t : uint8_t
+        {
+            FAULT, MOV, MOVE, XCHG, INC, DEC, NEG,
+            ADD, SUB, MUL, DIV, AND, OR, XOR, SHL, CMP, CMPG, CMPGE, NOT,
+            PUSH, POP, JMP, JZ, JNZ, CALL, CALLEXT, RET, NOP, YIELD, ALLOC, FREE,
+            GOTO,   // decoder generated, joins a straight run to an already decoded instruction
+            // superinstruction handlers, see func_t::fuse(). never a kind, the fused insns keep their own
+            BINARY_JZ, BINARY_JNZ, PUSH_RUN,
+            KIND_COUNT
+        };
+        const void *handler;    // resolved label of the threaded dispatch loop
+        binary_t binary;        // ADD..CMPGE: specialized handler, see binary_table
+        int32_t op1;
+        int32_t op2;            // jumps: decoded index + 1 of an IMM target, 0 if unresolved
+        uint32_t eip;           // EIP of the source instruction
+        kind_t kind;
+        oprand_t oprandT1;
+        oprand_t oprandT2;
+    };
+    // bytes of a function's assembly or of a data section, owned or shared. share() points them at the bytes of
+    // another bytes_t, a module's (context_t), or at read-only bytes, a mapped image's (image_t), without copying
+    // them, own() copies them. every non-const access owns first, except bytes(): the engines read through it and
+    // own before they write (func_t::touch(), elf_t::touch()). a copy of shared bytes shares them too. shared bytes
+    // must neither change nor go away while they are shared.
+    struct bytes_t
+    {
+        bytes_t() = default;
+        inline bytes_t(std::initializer_list<uint8_t> init) : owned(init) { sync(); }
+        inline bytes_t(const bytes_t &o) { *this = o; }
+        inline bytes_t(bytes_t &&o) noexcept { *this = std::move(o); }
+        inline bytes_t &operator=(const bytes_t &o)
+        {
+            if (this == &o)
+                return *this;
+            if (o.shared)
+                share(o);
+            else
+                assign(o.begin(), o.end());
+            return *this;
+        }
+        inline bytes_t &operator=(bytes_t &&o) noexcept
+        {
+            if (this == &o)
+                return *this;
+            owned = std::move(o.owned);
+            shared = o.shared;
+            ptr = shared ? o.ptr : owned.data();
+            len = o.len;
+            o.owned.clear();
+            o.shared = false;
+            o.sync();
+            return *this;
+        }
+        inline bytes_t &operator=(std::vector<uint8_t> v)
+        {
+            owned = std::move(v);
+            shared = false;
+            sync();
+            return *this;
+        }
+        inline bytes_t &operator=(std::initializer_list<uint8_t> init)
+        {
+            return *this = std::vector<uint8_t>(init);
+        }
+        inline void share(const bytes_t &o)
+        {
+            owned = {};
+            ptr = o.ptr;
+            len = o.len;
+            shared = true;
+        }
+        inline void share(const uint8_t *p, size_t n)
+        {
+            owned = {};
+            ptr = const_cast<uint8_t *>(p);
+            len = n;
+            shared = true;
+        }
+        inline void own() // a copy of the bytes shared, nothing if they are owned
+        {
+            if (shared)
+            {
+                owned.assign(ptr, ptr + len);
+                shared = false;
+                sync();
+            }
+        }
+        inline bool shares() const { return shared; }
+        inline uint8_t *bytes() const { return ptr; } // read, or write after own()
+        inline size_t size() const { return len; }
+        inline bool empty() const { return len == 0; }
+        inline const uint8_t *data() const { return ptr; }
+        inline uint8_t *data() { own(); return ptr; }
+        inline const uint8_t &operator[](size_t i) const { return ptr[i]; }
+        inline uint8_t &operator[](size_t i) { own(); return ptr[i]; }
+        inline const uint8_t *begin() const { return ptr; }
+        inline const uint8_t *end() const { return ptr + len; }
+        inline uint8_t *begin() { own(); return ptr; }
+        inline uint8_t *end() { own(); return ptr + len; }
+        inline void resize(size_t n, uint8_t v = 0) { own(); owned.resize(n, v); sync(); }
+        inline void assign(size_t n, uint8_t v) { edit().assign(n, v); sync(); }
+        template <typename I>
+        inline void assign(I first, I last) { edit().assign(first, last); sync(); }
+        template <typename I>
+        inline void insert(const uint8_t *at, I first, I last)
+        {
+            size_t i = at - ptr;
+            own();
+            owned.insert(owned.begin() + i, first, last);
+            sync();
+        }
+        inline void push_back(uint8_t v) { own(); owned.push_back(v); sync(); }
+        inline void reserve(size_t n) { own(); owned.reserve(n); sync(); }
+        inline void clear() { edit().clear(); sync(); }
+        inline bool operator==(const bytes_t &o) const { return len == o.len && std::equal(ptr, ptr + len, o.ptr); }
+        inline bool operator!=(const bytes_t &o) const { return !(*this == o); }
+        inline bool operator==(const std::vector<uint8_t> &v) const { return len == v.size() && std::equal(ptr, ptr + len, v.data()); }
+        inline bool operator!=(const std::vector<uint8_t> &v) const { return !(*this == v); }
+
+    private:
+        std::vector<uint8_t> owned;
+        uint8_t *ptr = nullptr;     // owned.data() or the bytes shared
+        size_t len = 0;
+        bool shared = false;
+        inline void sync()
+        {
+            ptr = owned.data();
+            len = owned.size();
+        }
+        inline std::vector<uint8_t> &edit() // owned, replaced as a whole: the shared bytes are not copied
+        {
+            shared = false;
+            return owned;
+        }
+    };
+    // 4-byte words written since the last clear(), one bit each, see AS32_sync.h, and per 4k page the serial of its
+    // last write, see AS32_hash.h. untracked while bits is empty, track() again after resizing the memory.
+    struct dirty_t
+    {
+        std::vector<uint64_t> bits;
+        std::vector<uint64_t> pages;            // writes when the page was last written, track() counts as one
+        uint64_t writes = 0;                    // marks so far, never goes back
+        std::vector<uint64_t> watch;            // words a trigger_t waits on, see AS32_trigger.h
+        std::vector<uint64_t> *woken = nullptr; // gets watch_id << 32 | word of the first write to a watched word
+        uint32_t watch_id = 0;
+        inline void wake(uint32_t word)
+        {
+            uint64_t bit = uint64_t(1) << (word & 63);
+            if ((word >> 6) < watch.size() && (watch[word >> 6] & bit) != 0)
+            {
+                watch[word >> 6] &= ~bit;
+                woken->push_back(uint64_t(watch_id) << 32 | word);
+            }
+        }
+        inline bool tracked() const { return bits.size() != 0; }
+        inline void track(size_t size) // every page counts as written, writes may have gone unmarked before
+        {
+            bits.assign(size / 256 + 2, 0);
+            pages.assign(size / 4096 + 2, ++writes);
+        }
+        inline void grow(size_t size) // track() for a memory grown to size, keeping the marks
+        {
+            std::vector<uint64_t> marked = std::move(bits);
+            track(size);
+            std::copy(marked.begin(), marked.end(), bits.begin());
+        }
+        inline void untrack() { bits = {}, pages = {}; }
+        inline void clear() { std::fill(bits.begin(), bits.end(), 0); }
+        inline bool test(size_t word) const { return (word >> 6) < bits.size() && (bits[word >> 6] >> (word & 63) & 1); }
+        // a 4-byte write at off, may straddle two words. only tracked runs and host writes get here, see func_t::touch.
+        // delta() clears bits, pages are only ever stamped: each digest_t compares them with the writes it has seen.
+        // watched: may wake a trigger_t, only data sections are watched, assembly is marked without the test
+        template <bool watched = true>
+        inline void mark(uint32_t off)
+        {
+            uint32_t lo = off >> 2, hi = (off + 3) >> 2;
+            if ((hi >> 6) >= bits.size())
+                return;
+            uint64_t serial = ++writes;
+            bits[lo >> 6] |= uint64_t(1) << (lo & 63);
+            pages[lo >> 10] = serial;
+            if (hi != lo) // unaligned
+            {
+                bits[hi >> 6] |= uint64_t(1) << (hi & 63);
+                pages[hi >> 10] = serial;
+            }
+            if (watched && woken != nullptr)
+                wake(lo), wake(hi);
+        }
+        inline void mark(uint32_t off, uint32_t len) // host writes of len bytes
+        {
+            for (uint32_t w = off >> 2; len != 0 && w <= (off + len - 1) >> 2; w++)
+                mark(w << 2);
+        }
+    };
+    // script heap of ALLOC, FREE and HEAP_IA, one per elf_t, so every context_t instance has its own. blocks are
+    // carved from one arena: a size is rounded up to a power of two class (16 bytes at least), a freed block goes
+    // on the free list of its class and the next ALLOC of that class takes it back. a handle is generation(15) |
+    // slot(16), positive and never 0. every slot keeps its own generation: FREE moves it on, and so does the next
+    // ALLOC of a slot that was live at reset(), which drops every block at once. a freed, stale or forged handle
+    // faults instead of reaching memory, until its slot was reused 32767 times. new blocks read as zeros.
+    struct heap_t
+    {
+        struct block_t
+        {
+            uint32_t off;       // in arena
+            uint32_t size;      // addressable bytes, a multiple of 4
+            uint16_t gen;       // of the slot, 1..0x7FFF
+            uint8_t cls;        // size class, log2 of the arena bytes
+            bool live;
+        };
+        static constexpr uint32_t min_class = 4;
+        static constexpr uint32_t classes = 32;
+        static constexpr uint32_t max_blocks = 0x10000;
+        static inline uint16_t next(uint16_t gen) { return static_cast<uint16_t>(gen % 0x7FFF + 1); }
+        std::vector<uint8_t> arena;
+        std::vector<block_t> blocks;            // [0, used) in use since reset(), the rest keeps its generations
+        std::vector<uint32_t> slots;            // free slots below used
+        std::vector<uint32_t> lists[classes];   // offsets of free blocks per class
+        uint32_t used = 0;
+        uint32_t top = 0;                       // arena bytes handed out so far
+        uint32_t limit = 1 << 20;               // arena bytes at most
+        uint32_t live = 0;                      // blocks allocated
+        uint64_t layout = 0;                    // ALLOC, FREE, reset() and restores so far, see digest_t
+        uint64_t synced = 0;                    // layout at the last delta(), see AS32_sync.h
+        dirty_t dirty;                          // written words of arena, tracked with its elf (elf_t::track)
+        inline int32_t alloc(int32_t size) // handle, 0 if size is not positive or the heap is exhausted
+        {
+            if (size <= 0 || static_cast<uint32_t>(size) > limit || (slots.size() == 0 && used >= max_blocks))
+                return 0;
+            uint32_t cls = min_class;
+            while ((uint32_t(1) << cls) < static_cast<uint32_t>(size))
+                cls++;
+            uint32_t bytes = uint32_t(1) << cls;
+            uint32_t off;
+            if (lists[cls].size() != 0)
+            {
+                off = lists[cls].back();
+                lists[cls].pop_back();
+            }
+            else
+            {
+                if (top > limit || bytes > limit - top)
+                    return 0;
+                off = top;
+                top += bytes;
+                if (arena.size() < top)
+                {
+                    arena.resize(std::max<size_t>(top, std::min<size_t>(limit, arena.size() * 2)));
+                    if (dirty.tracked())
+                        dirty.grow(arena.size());
+                }
+            }
+            uint32_t slot;
+            if (slots.size() != 0)
+            {
+                slot = slots.back();
+                slots.pop_back();
+            }
+            else
+            {
+                if (used == blocks.size())
+                    blocks.push_back({ 0, 0, 1, 0, false });
+                slot = used++;
+            }
+            block_t &b = blocks[slot];
+            uint16_t gen = b.live ? next(b.gen) : b.gen; // live: dropped by reset()
+            b = { off, (static_cast<uint32_t>(size) + 3) & ~uint32_t(3), gen, static_cast<uint8_t>(cls), true };
+            std::memset(&arena[off], 0, bytes);
+            if (dirty.tracked())
+                dirty.mark(off, bytes);
+            live++;
+            layout++;
+            return static_cast<int32_t>(uint32_t(gen) << 16 | slot);
+        }
+        inline block_t *find(int32_t handle)
+        {
+            uint32_t slot = static_cast<uint32_t>(handle) & 0xFFFF, gen = static_cast<uint32_t>(handle) >> 16;
+            if (slot >= used || blocks[slot].live == false || blocks[slot].gen != gen)
+                return nullptr;
+            return &blocks[slot];
+        }
+        inline bool free(int32_t handle)
+        {
+            block_t *b = find(handle);
+            if (b == nullptr)
+                return false;
+            b->live = false;
+            b->gen = next(b->gen);
+            lists[b->cls].push_back(b->off);
+            slots.push_back(static_cast<uint32_t>(b - blocks.data()));
+            live--;
+            layout++;
+            return true;
+        }
+        inline int32_t *address(int32_t handle, int32_t op) // the int32 at op of the block, nullptr outside
+        {
+            block_t *b = find(handle);
+            uint32_t off = static_cast<uint32_t>(op);
+            if (b == nullptr || off > b->size - sizeof(int32_t))
+                return nullptr;
+            return (int32_t *)&arena[b->off + off];
+        }
+        inline void touch(const int32_t *at) // a tracked HEAP_IA write, host writes too
+        {
+            dirty.mark<false>(static_cast<uint32_t>((const uint8_t *)at - arena.data()));
+        }
+        inline void reset() // frees every block in O(1), the arena memory and the slot generations are kept
+        {
+            for (auto &it : lists)
+                it.clear();
+            slots.clear();
+            used = 0;
+            top = 0;
+            live = 0;
+            layout++;
+        }
+    };
+    // execution profiler hooks, see AS32_profile.h. compiled in only with AS32_PROFILE 1 (set it for the whole
+    // program), otherwise every hook is empty and a run costs exactly what it did without them.
+#ifndef AS32_PROFILE
+#define AS32_PROFILE 0
+#endif
+    struct profile_t;
+    inline thread_local profile_t *profiling = nullptr;    // profile_t recording this thread, see profile_t::start()
+    inline void profile_insn(uint16_t opcode, oprand_t t1, oprand_t t2);
+    inline void profile_decoded(const func_t *src, const insn_t *ip);
+    inline void profile_enter(const func_t *f, const elf_t *elf);
+    inline void profile_leave();
+    inline void profile_jump(const func_t *f, uint32_t from, uint32_t to);
+#if AS32_PROFILE
+#define AS32_PROFILING() (asc::profiling != nullptr)
+#define AS32_PROFILE_INSN(opcode, t1, t2) do { if (asc::profiling != nullptr) asc::profile_insn(static_cast<uint16_t>(opcode), t1, t2); } while (0)
+#define AS32_PROFILE_DECODED(src, ip) do { if (asc::profiling != nullptr) asc::profile_decoded(src, ip); } while (0)
+#define AS32_PROFILE_ENTER(f, elf) do { if (asc::profiling != nullptr) asc::profile_enter(f, elf); } while (0)
+#define AS32_PROFILE_LEAVE() do { if (asc::profiling != nullptr) asc::profile_leave(); } while (0)
+#define AS32_PROFILE_JUMP(f, from, to)                                                          \
+    do {                                                                                        \
+        if (asc::profiling != nullptr && static_cast<uint32_t>(to) <= (from))                  \
+            asc::profile_jump(f, from, static_cast<uint32_t>(to));                              \
+    } while (0)
+#else
+#define AS32_PROFILING() false
+#define AS32_PROFILE_INSN(opcode, t1, t2) ((void)0)
+#define AS32_PROFILE_DECODED(src, ip) ((void)0)
+#define AS32_PROFILE_ENTER(f, elf) ((void)0)
+#define AS32_PROFILE_LEAVE() ((void)0)
+#define AS32_PROFILE_JUMP(f, from, to) ((void)0)
+#endif
+    // execution trace hooks, see AS32_trace.h. compiled in only with AS32_TRACE 1, like the profiler hooks.
+#ifndef AS32_TRACE
+#define AS32_TRACE 0
+#endif
+    struct trace_t;
+    inline thread_local trace_t *tracing = nullptr;        // trace_t recording this thread, see trace_t::start()
+    inline trace_t *trace_insns();                         // tracing, if it records every instruction
+    inline void trace_insn(trace_t *t, const func_t *f, uint32_t eip, uint16_t opcode);
+    inline void trace_decoded(trace_t *t, const func_t *f, const insn_t *ip);
+    inline void trace_enter(const func_t *f, const func_t *caller);
+    inline void trace_leave(func_t *f, bool ok);
+    inline void trace_ext(const func_t *f, uint32_t eip, int32_t ind);
+#if AS32_TRACE
+#define AS32_TRACING() (asc::tracing != nullptr)
+// an engine loop reads tracing once, into its local trace_t *trace (AS32_TRACE_LOCAL), a run traces its instructions
+// if it began while tracing
+#define AS32_TRACE_LOCAL() asc::trace_t *const trace = asc::tracing != nullptr ? asc::trace_insns() : nullptr
+#define AS32_TRACE_INSN(f, eip, opcode) do { if (trace != nullptr) asc::trace_insn(trace, f, eip, static_cast<uint16_t>(opcode)); } while (0)
+#define AS32_TRACE_DECODED(f, ip) do { if (trace != nullptr) asc::trace_decoded(trace, f, ip); } while (0)
+#define AS32_TRACE_ENTER(f, caller) do { if (asc::tracing != nullptr) asc::trace_enter(f, caller); } while (0)
+#define AS32_TRACE_LEAVE(f, ok) do { if (asc::tracing != nullptr) asc::trace_leave(f, ok); } while (0)
+#define AS32_TRACE_EXT(f, eip, ind) do { if (asc::tracing != nullptr) asc::trace_ext(f, eip, ind); } while (0)
+#else
+#define AS32_TRACING() false
+#define AS32_TRACE_LOCAL() ((void)0)
+#define AS32_TRACE_INSN(f, eip, opcode) ((void)0)
+#define AS32_TRACE_DECODED(f, ip) ((void)0)
+#define AS32_TRACE_ENTER(f, caller) ((void)0)
+#define AS32_TRACE_LEAVE(f, ok) ((void)0)
+#define AS32_TRACE_EXT(f, eip, ind) ((void)0)
+#endif
+    // native code (JIT, AOT) and lockstep batches run no hooks, they are skipped while one of them records
+#define AS32_INSTRUMENTED() (AS32_PROFILING() || AS32_TRACING())
     struct func_t {
-        inline bool addressing_esp(int32_t *&ret)
+        inline bool addressing_esp(int32_t *&ret) // [ESP] to read, see addressing_esp_w to write it
         {
             if (ESP >= assembly.size())
                 return false;
-            ret = (int32_t *)&assembly[ESP];
+            ret = (int32_t *)(assembly.bytes() + ESP);
             return true;
         }
-        bool addressing_w(oprand_t opt, int32_t op, int32_t* &ret);
+        template <bool tracked = true>
+        inline bool addressing_esp_w(int32_t *&ret)
+        {
+            if (ESP >= assembly.size())
+                return false;
+            touch<tracked>(ESP);
+            ret = (int32_t *)(assembly.bytes() + ESP);
+            return true;
+        }
+        template <bool proven = false, bool tracked = true>
+        inline bool addressing_w(oprand_t opt, int32_t op, int32_t *&ret)
+        {
+            return addressing<true, proven, tracked>(opt, op, ret);
+        }
+        template <bool proven = false>
         inline bool addressing_r(oprand_t opt, int32_t op, int32_t &ret)
         {
             switch (opt)
@@ -79,7 +520,7 @@ namespace asc{
             default:
             {
                 int32_t *addr = nullptr;
-                if (addressing_w(opt, op, addr))
+                if (addressing<false, proven>(opt, op, addr))
                 {
                     ret = *addr;
                     return true;
@@ -88,6 +529,12 @@ namespace asc{
             }
             return false;
         }
+        // proven: IA and DATA_IA offsets were checked by verify(), only ESP/EBP relative ones are guarded
+        // tracked: a write is marked in dirty, the engines pick it once per run (tracking()), host code always does
+        template <bool write, bool proven = false, bool tracked = true>
+        bool addressing(oprand_t opt, int32_t op, int32_t *&ret);
+        template <oprand_t opt, bool proven>
+        bool operand(int32_t op, int32_t &ret);     // addressing_r with the mode known at compile time
         bool callable_addressing(oprand_t opt, int32_t op, func_t*& ret, elf_t*& elf_callee);
 
         elf_t *elf_local;
@@ -96,33 +543,120 @@ namespace asc{
         uint32_t ESP;
         uint32_t EIP;
         uint32_t EIP_Begin;
-        std::vector<uint8_t> assembly;
+        bytes_t assembly;
+        fault_t fault = fault_t::NONE;          // of the last run, recorded by fail() where it stopped
         bool operator()(elf_t* elf, func_t* caller);
+        bool call(elf_t* elf, func_t* caller);  // operator() without the profiler hooks
+        bool fail();                            // records why the instruction at EIP cannot run, false
+
+        // threaded code, optional. predecode() again after editing assembly by hand.
+        std::vector<insn_t> decoded;
+        std::vector<uint32_t> decoded_at;   // EIP -> decoded index + 1
+        uint32_t code_lo = 0;               // decoded byte range, a write into it makes decoded stale
+        uint32_t code_len = 0;
+        uint32_t generation = 0;            // counts the predecodes, keys copies of decoded (batch_t)
+        bool stale = false;
+        elf_t *verified = nullptr;          // elf this function was verified against, see verify()
+        native_t native = nullptr;          // native code of the verified function, run instead of decoded
+        const func_t *origin = nullptr;     // instance or activation copy: decoded belongs to origin
+        bytes_t compact;                    // compact code decoded comes from, assembly then holds the stack only, see compact_load()
+        std::vector<uint64_t> compact_at;   // every COMPACT_INDEX-th of its records, EIP << 32 | offset, see compact_load()
+        inline const func_t &code() const
+        {
+            return origin != nullptr ? *origin : *this;
+        }
+        inline bool in_stream() const // compact code whose instructions are not in assembly, see compact_unfold()
+        {
+            return code().compact.size() != 0 && assembly.size() < code().decoded_at.size();
+        }
+        void predecode();
+        template <typename F>
+        void predecode(uint32_t size, F fetch);         // from the bytes fetch(eip, at) gives for the EIPs below size
+        bool fetch(uint32_t eip, uint8_t *at) const;    // the 3 words at eip, from assembly or compact, false past the end
+        bool verify(elf_t *elf);
+        uint32_t fuse();
+        uint32_t fused = 0;                 // superinstructions in decoded, see fuse()
+        dirty_t dirty;                      // written words of assembly, see elf_t::track()
+        // writes must be marked: the engines run their tracked variant, chosen once per run, native code does not run
+        inline bool tracking(const func_t *caller) const
+        {
+            return dirty.tracked() || (caller != nullptr && caller->dirty.tracked());
+        }
+        template <bool tracked = true>
+        inline void touch(uint32_t off) // before a write at off
+        {
+            assembly.own();
+            if (off - code_lo < code_len)
+                stale = true;
+            if constexpr (tracked)
+                dirty.mark<false>(off);
+        }
+        uint32_t active = 0;                // activations on exec_t frame stacks
+        bool run_switch();
+        state_t run(exec_t *exec);          // switch interpreter from EIP, CALL recurses unless exec is given
+        template <bool tracked>
+        state_t run_code(exec_t *exec);     // run(), marking writes if tracked
+        state_t resume(exec_t *exec);       // continue at EIP with the fastest engine that is still valid
+        template <bool proven>
+        inline bool decoded_valid()         // run_decoded<proven> may run this activation
+        {
+            return code().decoded.size() != 0 && stale == false && (verified != nullptr && verified == elf_local) == proven;
+        }
+        // the handlers and binary of decoded belong to run_decoded<true, false> if code() is verified, otherwise
+        // to run_decoded<false, false>. any other loop dispatches on insn_t::kind, so a verified function running
+        // against another elf never reaches the unchecked handlers
+        template <bool proven, bool tracked = false>
+        state_t run_decoded(exec_t *exec = nullptr, uint32_t start = 0, const void *const **table = nullptr);
     };
     using extfunc_t = bool (*)(func_t*);
+    // compact code, see AS32_compact.h
+    inline bool compact_fetch(const func_t &c, uint32_t eip, uint8_t *at);
+    inline void compact_predecode(func_t &f);
+    inline bool compact_unfold(func_t &f);
     struct elf_t
     {
         struct dependency_t {
             name_t name;
             elf_t* ptr;
         };
+        // ptr and func change while other threads CALL through them (reload() in AS32_reload.h): written with
+        // release stores, a CALL loads each of them once, with acquire
         struct import_t{
             int dependency_index;
             int func_index;     // func index in target dependency elf
-            elf_t* ptr;
+            std::atomic<elf_t*> ptr;
+            std::atomic<func_t*> func; // bound &ptr->text[func_index], CALL skips all checks. see bind()
+            import_t(int dependency_index = 0, int func_index = 0, elf_t *ptr = nullptr, func_t *func = nullptr)
+                : dependency_index(dependency_index), func_index(func_index), ptr(ptr), func(func) {}
+            import_t(const import_t &it) : import_t(it.dependency_index, it.func_index, it.target(), it.bound()) {}
+            inline import_t &operator=(const import_t &it)
+            {
+                dependency_index = it.dependency_index;
+                func_index = it.func_index;
+                retarget(it.target());
+                rebind(it.bound());
+                return *this;
+            }
+            inline elf_t *target() const { return ptr.load(std::memory_order_acquire); }
+            inline func_t *bound() const { return func.load(std::memory_order_acquire); }
+            inline void retarget(elf_t *elf) { ptr.store(elf, std::memory_order_release); }
+            inline void rebind(func_t *f) { func.store(f, std::memory_order_release); }
         };
         name_t name;
         std::vector<dependency_t> dependency;   // name of external elf
         std::vector<import_t> imports;
         std::atomic<int> referenced;
-        std::vector<uint8_t> data;
+        std::atomic<int> suspended{ 0 };        // frames of exec_t runs suspended in it, see exec_t::hold()
+        bytes_t data;
         std::vector<func_t> text;
+        const exttable_t *ext = nullptr;        // host functions of CALLEXT, nullptr: the static extlib
+        heap_t heap;                            // ALLOC/FREE and HEAP_IA of its functions
         inline bool load_elf(elf_t * elf)
         {
             size_t i = 0;
             for (auto& it : dependency)
             {
-                if (std::strcmp(elf->name, it.name) == 0)
+                if (std::strncmp(elf->name, it.name, namelen) == 0)
                 {
                     it.ptr = elf;
                     break;
@@ -135,15 +669,30 @@ namespace asc{
             elf->referenced.fetch_add(1);
             for (auto& it : imports)
             {
-                if (it.dependency_index == i)
-                    it.ptr = elf;
+                if (it.dependency_index == static_cast<int>(i))
+                {
+                    it.retarget(elf);
+                    bind(it);
+                }
             }
+            return true;
+        }
+        // resolve an import to its function once, the callee's text must not be resized while bound
+        static inline bool bind(import_t &it)
+        {
+            it.rebind(nullptr);
+            elf_t *elf = it.target();
+            if (elf == nullptr || it.func_index < 0 || static_cast<size_t>(it.func_index) >= elf->text.size())
+                return false;
+            it.rebind(&elf->text[it.func_index]);
+            return true;
         }
         inline void unload_elf()
         {
             for (auto& it : imports)
             {
-                it.ptr = nullptr;
+                it.rebind(nullptr);
+                it.retarget(nullptr);
             }
             for (auto& it : dependency)
             {
@@ -160,17 +709,422 @@ namespace asc{
                 return false;
             return text[0](this, nullptr);
         }
+        bool operator()(exec_t &exec); // execute index 0 function on an explicit frame stack
+        inline void predecode()
+        {
+            for (auto& it : text)
+                it.predecode();
+        }
+        inline bool verify() // predecode and verify every function, true if all of them passed
+        {
+            bool ret = true;
+            for (auto& it : text)
+                ret = it.verify(this) && ret;
+            return ret;
+        }
+        dirty_t dirty;  // written words of data
+        template <bool tracked = true>
+        inline void touch(uint32_t off) // before a write at off into data
+        {
+            data.own();
+            if constexpr (tracked)
+                dirty.mark(off);
+        }
+        inline void track(bool on = true) // mark every write into data, assembly and the heap, see AS32_sync.h
+        {
+            if (on)
+            {
+                dirty.track(data.size());
+                heap.dirty.track(heap.arena.size());
+            }
+            else
+            {
+                dirty.untrack();
+                heap.dirty.untrack();
+            }
+            for (auto &it : text)
+                if (on)
+                    it.dirty.track(it.assembly.size());
+                else
+                    it.dirty.untrack();
+        }
+    };
+
+
+
+    // non-recursive call engine
+    // exec_t runs CALL and RET of a whole call tree in one dispatch loop over an explicit frame stack, instead
+    // of one func_t::operator() C++ frame per CALL. the first activation of a function runs in place, exactly
+    // like the recursive engine. a function that is already active (recursion, re-entry) gets a pooled
+    // activation: a fresh copy of its assembly with its own ESP/EIP/caller, which is dropped on RET, so the
+    // outer activations are never overwritten. state shared between activations belongs in the data section.
+    // frames and activations are reused LIFO, depth is bounded by max_frames (CALL faults beyond it).
+    struct exec_t
+    {
+        struct frame_t
+        {
+            func_t *f;          // the activation running
+            func_t *code;       // the function called
+            const insn_t *ip;   // threaded code resume point, if the CALL continued in the same run_decoded
+        };
+        std::vector<frame_t> frames;
+        std::deque<func_t> pool;        // activations, [0, pooled) in use
+        size_t pooled = 0;
+        size_t max_frames = 4096;
+        size_t base = 0;                // frames below belong to an outer operator() on the same exec_t
+        int64_t fuel = INT64_MAX;       // instructions left for run(), every executed instruction costs 1
+        bool share = false;             // re-entry runs in the active function itself, like the recursive engine
+        func_t *activation(func_t *code) // fresh copy of an active function, sharing its threaded code
+        {
+            if (pooled == pool.size())
+                pool.emplace_back();
+            func_t *f = &pool[pooled++];
+            const bytes_t &from = code->assembly;
+            f->assembly.assign(from.begin(), from.end());
+            f->EIP_Begin = code->EIP_Begin;
+            f->origin = &code->code();
+            f->code_lo = code->code_lo;
+            f->code_len = code->code_len;
+            f->stale = code->stale;
+            f->verified = code->verified;
+            return f;
+        }
+        inline bool enter(func_t *code, elf_t *elf, func_t *caller)
+        {
+            if (frames.size() >= max_frames)
+                return false;
+            func_t *f = code->active == 0 || share ? code : activation(code);
+            code->active++;
+            f->ESP = 0;
+            f->EIP = f->EIP_Begin;
+            f->elf_local = elf;
+            f->caller = caller;
+            f->fault = fault_t::NONE;
+            frames.push_back({ f, code, nullptr });
+            AS32_PROFILE_ENTER(code, elf);
+            AS32_TRACE_ENTER(f, caller);
+            return true;
+        }
+        inline void leave()
+        {
+            AS32_PROFILE_LEAVE();
+            frame_t &fr = frames.back();
+            fr.code->active--;
+            if (fr.f != fr.code)
+                pooled--;
+            frames.pop_back();
+        }
+        // a fault: recorded in the top frame, every frame below it stopped at the CALL of a faulted callee
+        inline void unwind()
+        {
+            frames.back().f->fail();
+            while (frames.size() > base)
+            {
+                AS32_TRACE_LEAVE(frames.back().f, false);
+                leave();
+                if (frames.size() > base)
+                    frames.back().f->fault = fault_t::CALLEE;
+            }
+        }
+        // pops a returned frame, false if it was the outermost one of this operator()
+        inline bool ret()
+        {
+            AS32_TRACE_LEAVE(frames.back().f, true);
+            leave();
+            if (frames.size() == base)
+                return false;
+            frames.back().ip = nullptr;
+            frames.back().f->EIP += 2 * sizeof(uint32_t);
+            return true;
+        }
+        // runs to completion, a nested call (e.g. from an extlib) cannot suspend: no budget, YIELD continues
+        inline bool operator()(func_t *f, elf_t *elf, func_t *caller = nullptr)
+        {
+            size_t outer = base;
+            int64_t outer_fuel = fuel;
+            base = frames.size();
+            fuel = INT64_MAX;
+            bool ret_value = enter(f, elf, caller);
+            while (ret_value)
+            {
+                state_t state = frames.back().f->resume(this);
+                if (state == state_t::FRAME || state == state_t::YIELD)
+                    continue;
+                if (state == state_t::FAULT)
+                {
+                    unwind();
+                    ret_value = false;
+                }
+                else if (ret() == false)
+                    break;
+            }
+            base = outer;
+            fuel = outer_fuel - (INT64_MAX - fuel); // the nested run is charged to the outer budget
+            if (fuel < 0)
+                fuel = 0;
+            return ret_value;
+        }
+
+        // resumable execution
+        // start() pushes the first frame, run(budget) executes at most budget instructions and returns
+        // RET (finished), FAULT (frames unwound), BUDGET (out of fuel) or YIELD. after BUDGET and YIELD the
+        // whole frame stack stays as it is, and the next run() continues exactly there.
+        inline bool start(func_t *f, elf_t *elf, func_t *caller = nullptr)
+        {
+            if (suspended())
+                return false;
+            return enter(f, elf, caller);
+        }
+        inline bool start(elf_t *elf) // index 0 function
+        {
+            return elf->text.size() != 0 && start(&elf->text[0], elf);
+        }
+        inline bool suspended() { return frames.size() > base; }
+        inline state_t run(int64_t budget = INT64_MAX)
+        {
+            fuel = budget;
+            state_t state = state_t::FAULT; // nothing started
+            while (suspended())
+            {
+                state = frames.back().f->resume(this);
+                if (state == state_t::FAULT)
+                    unwind();
+                else if (state == state_t::RET && ret())
+                    continue;
+                else if (state != state_t::FRAME) // RET of the first frame, BUDGET, YIELD
+                    break;
+            }
+            hold();
+            return state;
+        }
+        inline void drop() // ends a suspended run where it stands, without running it any further
+        {
+            while (suspended())
+            {
+                AS32_TRACE_LEAVE(frames.back().f, false);
+                leave();
+            }
+            hold();
+        }
+        // between two run() calls no pin (epoch_t) covers the frames of a suspended run. the elfs they are in
+        // count them in elf_t::suspended from the end of the run() that suspended until the end of the one that
+        // finished, so reload() sees them. a run() that suspends again counts before it releases
+        std::vector<elf_t *> held;
+        inline void hold()
+        {
+            size_t before = held.size();
+            for (size_t i = base; i < frames.size(); i++)
+            {
+                elf_t *e = frames[i].f->elf_local;
+                if (e != nullptr && (held.size() == before || held.back() != e))
+                {
+                    e->suspended.fetch_add(1);
+                    held.push_back(e);
+                }
+            }
+            for (size_t i = 0; i < before; i++)
+                held[i]->suspended.fetch_sub(1);
+            held.erase(held.begin(), held.begin() + before);
+        }
     };
+    inline bool elf_t::operator()(exec_t &exec)
+    {
+        if (text.size() == 0)
+            return false;
+        return exec(&text[0], this);
+    }
+
+    // execution context
+    // a loaded elf_t is a shared, read-only module. context_t instantiates it together with every elf it
+    // depends on: an instance has its own registers, and its assembly (it holds the stack) and data section
+    // point at the module's bytes until the first write into them copies them (bytes_t), per function and per
+    // data section. functions an instance never writes and native code never enters stay shared. the threaded
+    // code stays with the module functions (func_t::origin) and verified functions stay verified.
+    // predecode()/verify() the modules before instantiating and leave them alone while instances exist; instances
+    // share nothing mutable, so any number of them can run on different threads at once. spawn() only records
+    // the module, the first run or elf() instantiates it. the module must outlive its instances.
+    inline void ext_freeze(const elf_t *module);
+    struct context_t
+    {
+        std::deque<elf_t> elfs;                 // elfs[0] is the instantiated module, then its dependencies
+        std::vector<const elf_t *> modules;     // module of each elfs entry
+        const elf_t *spawned = nullptr;         // module of spawn(), instantiated on first use
+        exec_t exec;
+        bool result = false;                    // of the last run
+
+        context_t() = default;
+        inline explicit context_t(const elf_t &module) { instantiate(&module); }
+        context_t(const context_t &) = delete;
+        context_t &operator=(const context_t &) = delete;
+        elf_t *instantiate(const elf_t *module);
+        inline bool spawn(const elf_t &module) // false unless the context_t is empty
+        {
+            if (elfs.size() != 0 || spawned != nullptr)
+                return false;
+            ext_freeze(&module); // not when a worker instantiates it
+            spawned = &module;
+            return true;
+        }
+        inline elf_t *elf() // the instantiated module, nullptr if there is none
+        {
+            if (spawned != nullptr)
+            {
+                instantiate(spawned);
+                spawned = nullptr;
+            }
+            return elfs.size() != 0 ? &elfs[0] : nullptr;
+        }
+        inline bool operator()() // execute index 0 function of the instantiated module
+        {
+            elf_t *e = elf();
+            result = e != nullptr && (*e)(exec);
+            return result;
+        }
+        inline state_t run(int64_t budget) // resumable, starts the index 0 function when nothing is suspended
+        {
+            if (exec.suspended() == false && (elf() == nullptr || exec.start(&elfs[0]) == false))
+                return state_t::FAULT;
+            state_t state = exec.run(budget);
+            if (state == state_t::RET || state == state_t::FAULT)
+                result = state == state_t::RET;
+            return state;
+        }
+        inline void release() // frees the heap of every elf, e.g. once a script finished
+        {
+            for (auto &it : elfs)
+                it.heap.reset();
+        }
+    };
+    inline elf_t *context_t::instantiate(const elf_t *module)
+    {
+        for (size_t i = 0; i < modules.size(); i++)
+            if (modules[i] == module)
+                return &elfs[i];
+        modules.push_back(module);
+        elf_t &elf = elfs.emplace_back();
+        for (size_t i = 0; i < namelen; i++)
+            elf.name[i] = module->name[i];
+        elf.referenced = 0;
+        elf.data.share(module->data);
+        ext_freeze(module);
+        elf.ext = module->ext;
+        elf.text.resize(module->text.size());
+        for (size_t i = 0; i < module->text.size(); i++)
+        {
+            const func_t &m = module->text[i];
+            func_t &f = elf.text[i];
+            f.assembly.share(m.assembly);
+            f.EIP_Begin = m.EIP_Begin;
+            f.ESP = m.ESP;
+            f.EIP = m.EIP;
+            f.elf_local = &elf;
+            f.caller = nullptr;
+            f.origin = &m.code();
+            f.code_lo = m.code_lo;
+            f.code_len = m.code_len;
+            f.stale = m.stale;
+            f.verified = m.verified == module ? &elf : nullptr;
+        }
+        elf.dependency = module->dependency;
+        elf.imports = module->imports;
+        for (auto &it : elf.dependency)
+            if (it.ptr != nullptr)
+                it.ptr = instantiate(it.ptr);
+        for (auto &it : elf.imports)
+            if (it.target() != nullptr)
+            {
+                it.retarget(instantiate(it.target()));
+                if (it.bound() != nullptr)
+                    elf_t::bind(it);
+            }
+        return &elf;
+    }
 
 
 
     //extlib
 #include "AS32_extlib.h"
+    constexpr size_t extlib_count = sizeof(extlib) / sizeof(extlib[0]);
+
+    // typed host functions
+    // an exttable_t starts as a copy of extlib and takes more at run time. a module selects its table
+    // (elf_t::ext), its context_t instances share it. the first instance made or spawned freezes the table,
+    // add() then fails, so instances on other threads read it without a lock. add<F>() generates the thunk of a
+    // typed function such as int32_t(int32_t, int32_t): argument i is read from [ESP + 4 * i] of the calling
+    // function after one bound check for all of them, a non-void result is written to [ESP]. arguments and
+    // results are 32-bit integers.
+    template <typename T>
+    inline T ext_arg(const uint8_t *p)
+    {
+        static_assert((std::is_integral<T>::value || std::is_enum<T>::value) && sizeof(T) <= sizeof(int32_t), "extlib arguments are int32");
+        int32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return static_cast<T>(v);
+    }
+    template <auto F, typename R, typename... A, size_t... I>
+    inline bool ext_invoke(func_t *caller, R (*)(A...), std::index_sequence<I...>)
+    {
+        constexpr size_t slots = sizeof...(A) != 0 ? sizeof...(A) : std::is_void<R>::value ? 0 : 1;
+        uint32_t esp = caller->ESP;
+        auto fits = [&] { return esp <= caller->assembly.size() && caller->assembly.size() - esp >= slots * sizeof(int32_t); };
+        if (fits() == false && (compact_unfold(*caller) == false || fits() == false))
+            return false;
+        const uint8_t *p = caller->assembly.bytes() + esp;
+        if constexpr (std::is_void<R>::value)
+            F(ext_arg<A>(p + I * sizeof(int32_t))...);
+        else
+        {
+            static_assert(std::is_integral<R>::value && sizeof(R) <= sizeof(int32_t), "extlib results are int32");
+            int32_t r = static_cast<int32_t>(F(ext_arg<A>(p + I * sizeof(int32_t))...));
+            caller->touch(esp);
+            std::memcpy(caller->assembly.data() + esp, &r, sizeof(r));
+        }
+        return true;
+    }
+    template <typename R, typename... A>
+    constexpr size_t ext_arity(R (*)(A...)) { return sizeof...(A); }
+    template <auto F>
+    inline bool ext_thunk(func_t *caller)
+    {
+        return ext_invoke<F>(caller, F, std::make_index_sequence<ext_arity(F)>{});
+    }
+    struct exttable_t
+    {
+        std::vector<extfunc_t> funcs;
+        mutable std::atomic<bool> frozen{ false };  // an instance of a module using it exists, see ext_freeze()
+        inline exttable_t() : funcs(extlib, extlib + extlib_count) {}
+        inline exttable_t(const exttable_t &o) : funcs(o.funcs) {} // not frozen
+        inline int32_t add(extfunc_t f) // CALLEXT index of f, -1 once frozen
+        {
+            if (frozen.load(std::memory_order_acquire))
+                return -1;
+            funcs.push_back(f);
+            return static_cast<int32_t>(funcs.size() - 1);
+        }
+        template <auto F>
+        inline int32_t add()
+        {
+            return add(&ext_thunk<F>);
+        }
+    };
+    inline void ext_freeze(const elf_t *module)
+    {
+        if (module->ext != nullptr)
+            module->ext->frozen.store(true, std::memory_order_release);
+    }
+    inline extfunc_t ext_find(const elf_t *elf, int32_t ind) // nullptr if ind is out of range
+    {
+        const exttable_t *t = elf != nullptr ? elf->ext : nullptr;
+        if (t != nullptr)
+            return ind >= 0 && static_cast<size_t>(ind) < t->funcs.size() ? t->funcs[ind] : nullptr;
+        return ind >= 0 && static_cast<size_t>(ind) < extlib_count ? extlib[ind] : nullptr;
+    }
 
 
 
     // definitions
-    inline bool func_t::addressing_w(oprand_t opt, int32_t op, int32_t *&ret)
+    template <bool write, bool proven, bool tracked>
+    inline bool func_t::addressing(oprand_t opt, int32_t op, int32_t *&ret)
     {
         switch (opt)
         {
@@ -179,9 +1133,11 @@ namespace asc{
         case oprand_t::IA:
         {
             uint32_t off = static_cast<uint32_t>(op);
-            if (off >= assembly.size())
-                return false;
-            ret = (int32_t *)&assembly[off];
+            if (!proven && off >= assembly.size() && (compact_unfold(*this) == false || off >= assembly.size()))
+                return false; // a host function's address above the stack of compact code expands it
+            if (write)
+                touch<tracked>(off);
+            ret = (int32_t *)(assembly.bytes() + off);
         }
             return true;
         case oprand_t::ESP:
@@ -191,34 +1147,157 @@ namespace asc{
         case oprand_t::ESP_IA:
         {
             uint32_t off = ESP + op;
-            if (off >= assembly.size())
+            if (off >= assembly.size() && (compact_unfold(*this) == false || off >= assembly.size()))
                 return false;
-            ret = (int32_t *)&assembly[off];
+            if (write)
+                touch<tracked>(off);
+            ret = (int32_t *)(assembly.bytes() + off);
         }
             return true;
         case oprand_t::EBP_IA:
         {
             if (caller == nullptr)
                 return false;
+            // above the stack of a compact caller: expanded, unless it is this function, whose instruction may
+            // hold a pointer into its assembly already
             uint32_t off = caller->ESP + op;
-            if (off >= caller->assembly.size())
+            if (off >= caller->assembly.size() &&
+                (caller == this || compact_unfold(*caller) == false || off >= caller->assembly.size()))
                 return false;
-            ret = (int32_t *)&caller->assembly[off];
+            if (write)
+                caller->touch<tracked>(off);
+            ret = (int32_t *)(caller->assembly.bytes() + off);
         }
             return true;
         case oprand_t::DATA_IA:
         {
-            if (elf_local == nullptr)
-                return false;
             uint32_t off = op;
-            if (off >= elf_local->data.size())
+            if (!proven && (elf_local == nullptr || off >= elf_local->data.size()))
                 return false;
-            ret = (int32_t *)&elf_local->data[off];
+            if (write)
+                elf_local->touch<tracked>(off);
+            ret = (int32_t *)(elf_local->data.bytes() + off);
         }
             return true;
+        case oprand_t::HEAP_IA: // never proven, handles only exist at run time
+        {
+            if (ESP < sizeof(int32_t) || ESP > assembly.size() || elf_local == nullptr)
+                return false;
+            int32_t handle;
+            std::memcpy(&handle, assembly.bytes() + ESP - sizeof(int32_t), sizeof(handle));
+            ret = elf_local->heap.address(handle, op);
+            if (ret == nullptr)
+                return false;
+            if (write && tracked)
+                elf_local->heap.touch(ret);
+            return true;
+        }
         }
         return false;
     }
+    template <oprand_t opt, bool proven>
+    inline bool func_t::operand(int32_t op, int32_t &ret)
+    {
+        if constexpr (opt == oprand_t::IMM)
+        {
+            ret = op;
+            return true;
+        }
+        else if constexpr (opt == oprand_t::ESP)
+        {
+            ret = ESP + op;
+            return true;
+        }
+        else
+        {
+            int32_t *addr;
+            if (addressing<false, proven>(opt, op, addr) == false)
+                return false;
+            ret = *addr;
+            return true;
+        }
+    }
+
+    // binary operations ADD..CMPGE, one handler per opcode x oprand_t x oprand_t generated at compile time,
+    // so both operands are fetched without a switch on the addressing mode and the operation without a switch
+    // on the opcode. same results as addressing_r twice + addressing_esp_w + the operation.
+    constexpr opcode_t binary_opcodes[] = {
+        opcode_t::ADD, opcode_t::SUB, opcode_t::MUL, opcode_t::DIV, opcode_t::AND, opcode_t::OR,
+        opcode_t::XOR, opcode_t::SHL, opcode_t::CMP, opcode_t::CMPG, opcode_t::CMPGE };
+    constexpr size_t binary_count = sizeof(binary_opcodes) / sizeof(binary_opcodes[0]);
+    constexpr size_t oprand_count = 8;  // IMM..HEAP_IA, larger mode bytes never address
+    template <opcode_t opcode>
+    inline bool binary_op(int32_t lv, int32_t lv2, int32_t *espad)
+    {
+        if constexpr (opcode == opcode_t::ADD)
+            *espad = lv + lv2;
+        else if constexpr (opcode == opcode_t::SUB)
+            *espad = lv - lv2;
+        else if constexpr (opcode == opcode_t::MUL)
+            *espad = lv * lv2;
+        else if constexpr (opcode == opcode_t::DIV)
+        {
+            if (lv2 == 0)
+                return false;
+            *espad = lv / lv2;
+        }
+        else if constexpr (opcode == opcode_t::AND)
+            *espad = lv & lv2;
+        else if constexpr (opcode == opcode_t::OR)
+            *espad = lv | lv2;
+        else if constexpr (opcode == opcode_t::XOR)
+            *espad = lv ^ lv2;
+        else if constexpr (opcode == opcode_t::SHL)
+        {
+            if (lv2 > 0)
+                *espad = lv << lv2;
+            else if (lv2 < 0)
+                *espad = lv >> -lv2;
+        }
+        else if constexpr (opcode == opcode_t::CMP)
+            *espad = lv == lv2;
+        else if constexpr (opcode == opcode_t::CMPG)
+            *espad = lv > lv2;
+        else if constexpr (opcode == opcode_t::CMPGE)
+            *espad = lv >= lv2;
+        return true;
+    }
+    template <opcode_t opcode, oprand_t opt1, oprand_t opt2, bool proven, bool tracked>
+    inline int64_t binary(func_t *f, int32_t op1, int32_t op2)
+    {
+        int32_t *espad;
+        int32_t lv;
+        int32_t lv2;
+        if (f->operand<opt1, proven>(op1, lv) && f->operand<opt2, proven>(op2, lv2) && f->addressing_esp_w<tracked>(espad) &&
+            binary_op<opcode>(lv, lv2, espad))
+            return *espad;
+        return binary_fault;
+    }
+    template <bool proven, bool tracked, size_t... I>
+    constexpr std::array<binary_t, sizeof...(I)> binary_make(std::index_sequence<I...>)
+    {
+        return { { &binary<binary_opcodes[I / (oprand_count * oprand_count)],
+                           static_cast<oprand_t>(I / oprand_count % oprand_count),
+                           static_cast<oprand_t>(I % oprand_count), proven, tracked>... } };
+    }
+    template <bool proven, bool tracked = false>
+    constexpr std::array<binary_t, binary_count * oprand_count * oprand_count> binary_table =
+        binary_make<proven, tracked>(std::make_index_sequence<binary_count * oprand_count * oprand_count>());
+    constexpr std::array<uint8_t, 256> binary_index = [] {
+        std::array<uint8_t, 256> ret = {};
+        for (size_t i = 0; i < binary_count; i++)
+            ret[static_cast<uint8_t>(binary_opcodes[i])] = static_cast<uint8_t>(i);
+        return ret;
+    }();
+    template <bool proven, bool tracked = false>
+    inline binary_t binary_find(opcode_t opcode, oprand_t opt1, oprand_t opt2) // opcode must be ADD..CMPGE
+    {
+        uint8_t t1 = static_cast<uint8_t>(opt1);
+        uint8_t t2 = static_cast<uint8_t>(opt2);
+        if (t1 >= oprand_count || t2 >= oprand_count)
+            return nullptr;
+        return binary_table<proven, tracked>[(binary_index[static_cast<uint8_t>(opcode)] * oprand_count + t1) * oprand_count + t2];
+    }
     inline bool func_t::callable_addressing(oprand_t opt, int32_t op, func_t*& ret, elf_t*& elf_callee)
     {
         int32_t ind;
@@ -231,10 +1310,15 @@ namespace asc{
                 if (ind >= elf_local->imports.size())
                     return false;
                 auto &impo = elf_local->imports[ind];
-                if (impo.ptr == nullptr)
-                    return false;
-                elf_callee = impo.ptr;
-                if (impo.func_index >= elf_callee->text.size())
+                func_t *bound = impo.bound(); // each field read once, see reload() in AS32_reload.h
+                if (bound != nullptr)
+                {
+                    elf_callee = impo.target();
+                    ret = bound;
+                    return true;
+                }
+                elf_callee = impo.target();
+                if (elf_callee == nullptr || impo.func_index >= elf_callee->text.size())
                     return false;
                 ret = &elf_callee->text[impo.func_index];
                 return true;
@@ -251,40 +1335,106 @@ namespace asc{
             return false;
     }
     inline bool func_t::operator()(elf_t* elf, func_t* caller)
+    {
+#if AS32_PROFILE || AS32_TRACE
+        if (AS32_INSTRUMENTED())
+        {
+            AS32_PROFILE_ENTER(this, elf);
+            AS32_TRACE_ENTER(this, caller);
+            bool ret = call(elf, caller);
+            AS32_TRACE_LEAVE(this, ret);
+            AS32_PROFILE_LEAVE();
+            return ret;
+        }
+#endif
+        return call(elf, caller);
+    }
+    inline bool func_t::call(elf_t* elf, func_t* caller)
     {
         ESP = 0;
         EIP = EIP_Begin;
         this->elf_local = elf;
         this->caller = caller;
+        fault = fault_t::NONE;
+        if (code().decoded.size() != 0 && stale == false)
+        {
+            if (verified != nullptr && verified == elf)
+            {
+                if (tracking(caller))
+                    return run_decoded<true, true>() == state_t::RET || fail();
+                if (native != nullptr && AS32_INSTRUMENTED() == false)
+                    return native(this, elf, caller); // records its faults itself
+                return run_decoded<true>() == state_t::RET || fail();
+            }
+            if (tracking(caller))
+                return run_decoded<false, true>() == state_t::RET || fail();
+            return run_decoded<false>() == state_t::RET || fail();
+        }
+        return run_switch();
+    }
+    inline bool func_t::run_switch()
+    {
+        return run(nullptr) == state_t::RET || fail();
+    }
+    inline state_t func_t::resume(exec_t *exec)
+    {
+        const func_t &c = code();
+        if (c.decoded.size() != 0 && stale == false && EIP < c.decoded_at.size() && c.decoded_at[EIP] != 0)
+        {
+            bool tracked = tracking(caller);
+            if (verified != nullptr && verified == elf_local)
+                return tracked ? run_decoded<true, true>(exec, c.decoded_at[EIP] - 1) : run_decoded<true>(exec, c.decoded_at[EIP] - 1);
+            return tracked ? run_decoded<false, true>(exec, c.decoded_at[EIP] - 1) : run_decoded<false>(exec, c.decoded_at[EIP] - 1);
+        }
+        return run(exec);
+    }
+    inline state_t func_t::run(exec_t *exec)
+    {
+        const func_t &c = code();
+        if (in_stream()) // no instruction bytes to interpret, the threaded code goes on if it can
+            return stale == false && EIP < c.decoded_at.size() && c.decoded_at[EIP] != 0 ? resume(exec) : state_t::FAULT;
+        return tracking(caller) ? run_code<true>(exec) : run_code<false>(exec);
+    }
+    template <bool tracked>
+    inline state_t func_t::run_code(exec_t *exec)
+    {
+        AS32_TRACE_LOCAL();
         while (1)
         {
+            if (exec != nullptr && --exec->fuel < 0)
+            {
+                exec->fuel = 0;
+                return state_t::BUDGET;
+            }
             if (EIP + 3 * sizeof(uint32_t) > assembly.size())
-                return false; // #Seg Fault
+                return state_t::FAULT; // #Seg Fault
 
-            opcode_t& opcode = *(opcode_t*)&assembly[EIP];
-            oprand_t& oprandT1 = *(oprand_t*)&assembly[EIP + sizeof(opcode_t)];
-            oprand_t& oprandT2 = *(oprand_t*)&assembly[EIP + sizeof(opcode_t) + sizeof(oprand_t)];
+            const uint8_t *at = assembly.bytes() + EIP;
+            opcode_t opcode = *(opcode_t*)at;
+            oprand_t oprandT1 = *(oprand_t*)(at + sizeof(opcode_t));
+            oprand_t oprandT2 = *(oprand_t*)(at + sizeof(opcode_t) + sizeof(oprand_t));
+            int32_t op1 = *(int32_t*)(at + sizeof(opcode_t) + 2 * sizeof(oprand_t));
+            int32_t op2 = *(int32_t*)(at + sizeof(opcode_t) + 2 * sizeof(oprand_t) + sizeof(int32_t));
+            AS32_PROFILE_INSN(opcode, oprandT1, oprandT2);
+            AS32_TRACE_INSN(this, EIP, opcode);
             bool isJump = false;
             switch (opcode)
             {
             case opcode_t::MOV:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
-                int32_t op2 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t) + sizeof(int32_t)];
                 int32_t* rv;
                 int32_t lv;
-                if (addressing_w(oprandT1, op1, rv) && addressing_r(oprandT2, op2, lv))
+                if (addressing_w<false, tracked>(oprandT1, op1, rv) && addressing_r(oprandT2, op2, lv))
                 {
                     *rv = lv;
                     EIP += 2 * sizeof(uint32_t);
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::MOVE:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
                 int32_t lv;
                 if (addressing_r(oprandT2, op1, lv))
                 {
@@ -292,16 +1442,14 @@ namespace asc{
                     EIP += 1 * sizeof(uint32_t);
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::XCHG:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
-                int32_t op2 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t) + sizeof(int32_t)];
                 int32_t* rv1;
                 int32_t* rv2;
-                if (addressing_w(oprandT1, op1, rv1) && addressing_w(oprandT2, op2, rv2))
+                if (addressing_w<false, tracked>(oprandT1, op1, rv1) && addressing_w<false, tracked>(oprandT2, op2, rv2))
                 {
                     int32_t tmp = *rv1;
                     *rv1 = *rv2;
@@ -309,16 +1457,15 @@ namespace asc{
                     EIP += 2 * sizeof(uint32_t);
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::INC:
             case opcode_t::NEG:
             case opcode_t::DEC:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
                 int32_t* rv;
-                if (addressing_w(oprandT1, op1, rv))
+                if (addressing_w<false, tracked>(oprandT1, op1, rv))
                 {
                     switch (opcode)
                     {
@@ -334,7 +1481,7 @@ namespace asc{
                     EIP += 1 * sizeof(uint32_t);
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::ADD:
@@ -349,115 +1496,62 @@ namespace asc{
             case opcode_t::CMPG:
             case opcode_t::CMPGE:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
-                int32_t op2 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t) + sizeof(int32_t)];
-                int32_t* espad;
-                int32_t lv;
-                int32_t lv2;
-                if (addressing_r(oprandT1, op1, lv) && addressing_r(oprandT2, op2, lv2) && addressing_esp(espad))
-                {
-                    switch (opcode)
-                    {
-                    case opcode_t::ADD:
-                        *espad = lv + lv2;
-                        break;
-                    case opcode_t::SUB:
-                        *espad = lv - lv2;
-                        break;
-                    case opcode_t::MUL:
-                        *espad = lv * lv2;
-                        break;
-                    case opcode_t::DIV:
-                        if (lv2 == 0)
-                            return false;
-                        *espad = lv / lv2;
-                        break;
-                    case opcode_t::AND:
-                        *espad = lv & lv2;
-                        break;
-                    case opcode_t::OR:
-                        *espad = lv | lv2;
-                        break;
-                    case opcode_t::XOR:
-                        *espad = lv ^ lv2;
-                        break;
-                    case opcode_t::SHL:
-                        if (lv2 > 0) {
-                            *espad = lv << lv2;
-                        }
-                        else if (lv2 < 0) {
-                            *espad = lv >> -lv2;
-                        }
-                        break;
-                    case opcode_t::CMP:
-                        *espad = lv == lv2;
-                        break;
-                    case opcode_t::CMPG:
-                        *espad = lv > lv2;
-                        break;
-                    case opcode_t::CMPGE:
-                        *espad = lv >= lv2;
-                        break;
-                    }
+                auto binary = binary_find<false, tracked>(opcode, oprandT1, oprandT2);
+                if (binary != nullptr && binary(this, op1, op2) != binary_fault)
                     EIP += 2 * sizeof(uint32_t);
-                }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
-            break;
             case opcode_t::NOT:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
                 int32_t* espad;
                 int32_t lv;
-                if (addressing_r(oprandT1, op1, lv) && addressing_esp(espad))
+                if (addressing_r(oprandT1, op1, lv) && addressing_esp_w<tracked>(espad))
                 {
                     *espad = ~lv;
                     EIP += 1 * sizeof(uint32_t);
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::PUSH:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
                 int32_t* espad;
                 int32_t lv;
-                if (addressing_r(oprandT1, op1, lv) && addressing_esp(espad))
+                if (addressing_r(oprandT1, op1, lv) && addressing_esp_w<tracked>(espad))
                 {
                     *espad = lv;
                     ESP += 4;
                     EIP += 1 * sizeof(uint32_t);
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::POP:
                 if (ESP >= 4)
                     ESP -= 4;
                 else
-                    return false;
+                    return state_t::FAULT;
                 break;
             case opcode_t::JMP:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
                 int32_t lv;
                 if (addressing_r(oprandT1, op1, lv))
                 {
+                    AS32_PROFILE_JUMP(this, EIP, lv);
                     EIP = lv;
                     isJump = true;
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::JNZ:
             case opcode_t::JZ:
             {
-                int32_t op1 = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
                 int32_t* espad;
                 int32_t lv;
                 if (addressing_r(oprandT1, op1, lv) && addressing_esp(espad))
@@ -467,6 +1561,7 @@ namespace asc{
                     case opcode_t::JNZ:
                         if (*espad != 0)
                         {
+                            AS32_PROFILE_JUMP(this, EIP, lv);
                             EIP = lv;
                             isJump = true;
                         }
@@ -476,6 +1571,7 @@ namespace asc{
                     case opcode_t::JZ:
                         if (*espad == 0)
                         {
+                            AS32_PROFILE_JUMP(this, EIP, lv);
                             EIP = lv;
                             isJump = true;
                         }
@@ -485,54 +1581,766 @@ namespace asc{
                     }
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::CALL:
             {
-                int32_t op = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
                 func_t* callable;
                 elf_t* elf_callee = this->elf_local;
-                if (callable_addressing(oprandT1, op, callable, elf_callee))
+                if (callable_addressing(oprandT1, op1, callable, elf_callee))
                 {
+                    if (exec != nullptr)
+                        return exec->enter(callable, elf_callee, this) ? state_t::FRAME : state_t::FAULT;
                     if (callable->operator()(elf_callee, this) == false)
-                        return false;
+                        return state_t::FAULT;
                     EIP += 1 * sizeof(uint32_t);
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::CALLEXT:
             {
-                int32_t op = *(int32_t*)&assembly[EIP + sizeof(opcode_t) + 2 * sizeof(oprand_t)];
                 int32_t ind;
-                if (addressing_r(oprandT1, op, ind))
+                if (addressing_r(oprandT1, op1, ind))
                 {
-                    if (ind < 0 || ind >= sizeof(extlib))
-                        return false;
-                    if (extlib[ind](this) == false)
-                        return false;
+                    extfunc_t ext = ext_find(elf_local, ind);
+                    AS32_TRACE_EXT(this, EIP, ind);
+                    if (ext == nullptr || ext(this) == false)
+                        return state_t::FAULT;
                     EIP += 1 * sizeof(uint32_t);
                 }
                 else
-                    return false;
+                    return state_t::FAULT;
+            }
+            break;
+            case opcode_t::ALLOC:
+            {
+                int32_t* espad;
+                int32_t lv;
+                if (addressing_r(oprandT1, op1, lv) && elf_local != nullptr && addressing_esp_w<tracked>(espad))
+                {
+                    *espad = elf_local->heap.alloc(lv);
+                    ESP += 4;
+                    EIP += 1 * sizeof(uint32_t);
+                }
+                else
+                    return state_t::FAULT;
+            }
+            break;
+            case opcode_t::FREE:
+            {
+                int32_t lv;
+                if (addressing_r(oprandT1, op1, lv) && elf_local != nullptr && elf_local->heap.free(lv))
+                    EIP += 1 * sizeof(uint32_t);
+                else
+                    return state_t::FAULT;
             }
             break;
             case opcode_t::RET:
-                return true;
+                return state_t::RET;
                 break;
             case opcode_t::NOP:
                 break;
+            case opcode_t::YIELD:
+                if (exec != nullptr)
+                {
+                    EIP += 1 * sizeof(uint32_t);
+                    return state_t::YIELD;
+                }
+                break;
             case opcode_t::INT:
-                return false;
+                return state_t::FAULT;
                 break;
             default:
-                return false; // #Undefined Opcode
+                return state_t::FAULT; // #Undefined Opcode
             }
 
             if (isJump == false)
                 EIP += sizeof(uint32_t);
         }
     }
-};
\ No newline at end of file
+
+    // threaded code
+    // assembly (or compact code, see compact_load) is translated once into an insn_t array, reachable instructions
+    // only. each insn_t carries the resolved handler, the addressing modes and the operands, so the loop below never
+    // touches the instruction bytes again. whatever cannot be proven ahead (dynamic jump target, self-modified code,
+    // re-entered function) hands the current EIP over to run_switch(), results stay exactly the same. compact code
+    // has no instruction bytes to interpret, run() goes on in the threaded code at EIP or faults.
+    inline void func_t::predecode()
+    {
+        if (compact.size() != 0 && in_stream())
+            return compact_predecode(*this);
+        predecode(static_cast<uint32_t>(assembly.size()), [this](uint32_t eip, uint8_t *at) { return fetch(eip, at); });
+    }
+    inline bool func_t::fetch(uint32_t eip, uint8_t *at) const
+    {
+        if (in_stream())
+            return compact_fetch(code(), eip, at);
+        if (uint64_t(eip) + 3 * sizeof(uint32_t) > assembly.size())
+            return false;
+        std::memcpy(at, assembly.bytes() + eip, 3 * sizeof(uint32_t));
+        return true;
+    }
+    template <typename F>
+    inline void func_t::predecode(uint32_t size, F fetch)
+    {
+        const void *const *handlers = nullptr;
+        run_decoded<false>(nullptr, 0, &handlers);
+        origin = nullptr;
+        generation++;
+        decoded.clear();
+        decoded_at.assign(size, 0);
+        uint32_t lo = UINT32_MAX, hi = 0;
+        std::vector<uint32_t> work = { EIP_Begin };
+        while (work.size() != 0)
+        {
+            uint32_t e = work.back();
+            work.pop_back();
+            while (1)
+            {
+                insn_t in = {};
+                in.eip = e;
+                if (e < size && decoded_at[e] != 0)
+                {
+                    in.kind = insn_t::GOTO;
+                    in.op2 = decoded_at[e];
+                    decoded.push_back(in);
+                    break;
+                }
+                uint8_t at[3 * sizeof(uint32_t)];
+                if (fetch(e, at) == false)
+                {
+                    in.kind = insn_t::FAULT; // #Seg Fault
+                    decoded.push_back(in);
+                    break;
+                }
+                opcode_t opcode = *(opcode_t *)at;
+                in.oprandT1 = *(oprand_t *)(at + sizeof(opcode_t));
+                in.oprandT2 = *(oprand_t *)(at + sizeof(opcode_t) + sizeof(oprand_t));
+                in.op1 = *(int32_t *)(at + sizeof(opcode_t) + 2 * sizeof(oprand_t));
+                in.op2 = *(int32_t *)(at + sizeof(opcode_t) + 2 * sizeof(oprand_t) + sizeof(int32_t));
+                uint32_t len = 1;
+                bool end = false;
+                switch (opcode)
+                {
+                case opcode_t::MOV: in.kind = insn_t::MOV; len = 3; break;
+                case opcode_t::MOVE: in.kind = insn_t::MOVE; len = 2; break;
+                case opcode_t::XCHG: in.kind = insn_t::XCHG; len = 3; break;
+                case opcode_t::INC: in.kind = insn_t::INC; len = 2; break;
+                case opcode_t::DEC: in.kind = insn_t::DEC; len = 2; break;
+                case opcode_t::NEG: in.kind = insn_t::NEG; len = 2; break;
+                case opcode_t::ADD: in.kind = insn_t::ADD; len = 3; break;
+                case opcode_t::SUB: in.kind = insn_t::SUB; len = 3; break;
+                case opcode_t::MUL: in.kind = insn_t::MUL; len = 3; break;
+                case opcode_t::DIV: in.kind = insn_t::DIV; len = 3; break;
+                case opcode_t::AND: in.kind = insn_t::AND; len = 3; break;
+                case opcode_t::OR: in.kind = insn_t::OR; len = 3; break;
+                case opcode_t::XOR: in.kind = insn_t::XOR; len = 3; break;
+                case opcode_t::SHL: in.kind = insn_t::SHL; len = 3; break;
+                case opcode_t::CMP: in.kind = insn_t::CMP; len = 3; break;
+                case opcode_t::CMPG: in.kind = insn_t::CMPG; len = 3; break;
+                case opcode_t::CMPGE: in.kind = insn_t::CMPGE; len = 3; break;
+                case opcode_t::NOT: in.kind = insn_t::NOT; len = 2; break;
+                case opcode_t::PUSH: in.kind = insn_t::PUSH; len = 2; break;
+                case opcode_t::POP: in.kind = insn_t::POP; break;
+                case opcode_t::JMP: in.kind = insn_t::JMP; len = 2; end = true; break;
+                case opcode_t::JZ: in.kind = insn_t::JZ; len = 2; break;
+                case opcode_t::JNZ: in.kind = insn_t::JNZ; len = 2; break;
+                case opcode_t::CALL: in.kind = insn_t::CALL; len = 2; break;
+                case opcode_t::CALLEXT: in.kind = insn_t::CALLEXT; len = 2; break;
+                case opcode_t::RET: in.kind = insn_t::RET; end = true; break;
+                case opcode_t::NOP: in.kind = insn_t::NOP; break;
+                case opcode_t::YIELD: in.kind = insn_t::YIELD; break;
+                case opcode_t::ALLOC: in.kind = insn_t::ALLOC; len = 2; break;
+                case opcode_t::FREE: in.kind = insn_t::FREE; len = 2; break;
+                default: in.kind = insn_t::FAULT; end = true; break; // INT, #Undefined Opcode
+                }
+                if (in.kind >= insn_t::ADD && in.kind <= insn_t::CMPGE)
+                {
+                    in.binary = binary_find<false>(opcode, in.oprandT1, in.oprandT2);
+                    if (in.binary == nullptr) // mode never addresses
+                    {
+                        in.kind = insn_t::FAULT;
+                        end = true;
+                    }
+                }
+                if (in.kind == insn_t::JMP || in.kind == insn_t::JZ || in.kind == insn_t::JNZ)
+                {
+                    in.op2 = 0;
+                    if (in.oprandT1 == oprand_t::IMM && static_cast<uint32_t>(in.op1) < size)
+                        work.push_back(in.op1);
+                }
+                decoded_at[e] = decoded.size() + 1;
+                decoded.push_back(in);
+                if (e < lo)
+                    lo = e;
+                if (e + len * sizeof(uint32_t) > hi)
+                    hi = e + len * sizeof(uint32_t);
+                if (end)
+                    break;
+                e += len * sizeof(uint32_t);
+            }
+        }
+        for (auto &it : decoded)
+        {
+            if ((it.kind == insn_t::JMP || it.kind == insn_t::JZ || it.kind == insn_t::JNZ) &&
+                it.oprandT1 == oprand_t::IMM && static_cast<uint32_t>(it.op1) < size)
+                it.op2 = decoded_at[it.op1];
+            it.handler = handlers ? handlers[it.kind] : nullptr;
+        }
+        // widened by 3 bytes, an int32 access starting there still overlaps the instructions.
+        code_lo = lo >= 3 ? lo - 3 : 0;
+        code_len = hi > lo ? hi - code_lo : 0;
+        stale = false;
+        verified = nullptr;
+        native = nullptr;
+        fuse();
+    }
+    // peephole pass over the threaded code, run by predecode() and verify(): a binary operation followed by JZ or
+    // JNZ to an IMM target becomes one compare and branch, which jumps on the result it just computed instead of
+    // reading [ESP] back and looking the target up, and every PUSH followed by another PUSH runs the pushes
+    // without dispatching in between. each insn keeps its slot and kind, so jump targets need no rewriting and
+    // the stale, budget and fault checks between the parts stay the same: the memory written and the EIP left
+    // behind are those of the unfused code. returns the number fused.
+    inline uint32_t func_t::fuse()
+    {
+        const void *const *handlers = nullptr;
+        if (verified != nullptr)
+            run_decoded<true>(nullptr, 0, &handlers);
+        else
+            run_decoded<false>(nullptr, 0, &handlers);
+        fused = 0;
+        if (handlers == nullptr) // switch dispatch, nothing to fuse
+            return 0;
+        for (size_t i = 0; i + 1 < decoded.size(); i++)
+        {
+            insn_t &in = decoded[i];
+            insn_t::kind_t next = decoded[i + 1].kind;
+            insn_t::kind_t super = insn_t::KIND_COUNT;
+            bool resolved = decoded[i + 1].oprandT1 == oprand_t::IMM && decoded[i + 1].op2 != 0; // static jump target
+            if (in.kind >= insn_t::ADD && in.kind <= insn_t::CMPGE && next == insn_t::JZ && resolved)
+                super = insn_t::BINARY_JZ;
+            else if (in.kind >= insn_t::ADD && in.kind <= insn_t::CMPGE && next == insn_t::JNZ && resolved)
+                super = insn_t::BINARY_JNZ;
+            else if (in.kind == insn_t::PUSH && next == insn_t::PUSH)
+                super = insn_t::PUSH_RUN;
+            if (super == insn_t::KIND_COUNT)
+                continue;
+            in.handler = handlers[super];
+            fused++;
+        }
+        return fused;
+    }
+    // verifier
+    // proves ahead what the checked engines test on every instruction: IMM jump targets land on decoded
+    // instructions, IA and DATA_IA operands lie inside assembly and elf->data, no rvalue is written, IMM CALL
+    // and CALLEXT indices exist. a function that passes runs run_decoded<true>, only ESP/EBP relative and heap
+    // accesses, dynamic targets and import links are still checked at runtime.
+    // assembly, elf->data and elf->text must not be resized after verify().
+    inline bool func_t::verify(elf_t *elf)
+    {
+        predecode();
+        auto operand = [&](oprand_t opt, int32_t op, bool write) -> bool {
+            uint32_t off = static_cast<uint32_t>(op);
+            switch (opt)
+            {
+            case oprand_t::IMM:
+            case oprand_t::ESP:
+                return write == false;
+            case oprand_t::IA:
+                return off < assembly.size() && assembly.size() - off >= sizeof(int32_t);
+            case oprand_t::ESP_IA:
+            case oprand_t::EBP_IA:
+            case oprand_t::HEAP_IA:
+                return true;
+            case oprand_t::DATA_IA:
+                return elf != nullptr && off < elf->data.size() && elf->data.size() - off >= sizeof(int32_t);
+            }
+            return false;
+        };
+        for (auto &it : decoded)
+        {
+            bool ok = true;
+            switch (it.kind)
+            {
+            case insn_t::MOV:
+                ok = operand(it.oprandT1, it.op1, true) && operand(it.oprandT2, it.op2, false);
+                break;
+            case insn_t::MOVE:
+                ok = operand(it.oprandT2, it.op1, false);
+                break;
+            case insn_t::XCHG:
+                ok = operand(it.oprandT1, it.op1, true) && operand(it.oprandT2, it.op2, true);
+                break;
+            case insn_t::INC:
+            case insn_t::DEC:
+            case insn_t::NEG:
+                ok = operand(it.oprandT1, it.op1, true);
+                break;
+            case insn_t::ADD: case insn_t::SUB: case insn_t::MUL: case insn_t::DIV:
+            case insn_t::AND: case insn_t::OR: case insn_t::XOR: case insn_t::SHL:
+            case insn_t::CMP: case insn_t::CMPG: case insn_t::CMPGE:
+                ok = operand(it.oprandT1, it.op1, false) && operand(it.oprandT2, it.op2, false);
+                break;
+            case insn_t::NOT:
+            case insn_t::PUSH:
+            case insn_t::ALLOC:
+            case insn_t::FREE:
+                ok = operand(it.oprandT1, it.op1, false);
+                break;
+            case insn_t::JMP:
+            case insn_t::JZ:
+            case insn_t::JNZ:
+                ok = operand(it.oprandT1, it.op1, false) && (it.oprandT1 != oprand_t::IMM || it.op2 != 0);
+                break;
+            case insn_t::CALL:
+                ok = operand(it.oprandT1, it.op1, false);
+                if (ok && it.oprandT1 == oprand_t::IMM)
+                {
+                    if (elf == nullptr)
+                        ok = false;
+                    else if (it.op1 < 0)
+                        ok = -static_cast<int64_t>(it.op1) - 1 < static_cast<int64_t>(elf->imports.size());
+                    else
+                        ok = static_cast<uint32_t>(it.op1) < elf->text.size();
+                }
+                break;
+            case insn_t::CALLEXT:
+                ok = operand(it.oprandT1, it.op1, false) && (it.oprandT1 != oprand_t::IMM || ext_find(elf, it.op1) != nullptr);
+                break;
+            default:
+                break;
+            }
+            if (ok == false)
+                return false;
+        }
+        const void *const *handlers = nullptr;
+        run_decoded<true>(nullptr, 0, &handlers);
+        for (auto &it : decoded)
+        {
+            it.handler = handlers ? handlers[it.kind] : nullptr;
+            if (it.kind >= insn_t::ADD && it.kind <= insn_t::CMPGE)
+                it.binary = binary_find<true>(binary_opcodes[it.kind - insn_t::ADD], it.oprandT1, it.oprandT2);
+        }
+        verified = elf;
+        fuse();
+        return true;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+#define AS32_THREADED 1
+#define AS32_NEXT()                                                                             \
+    do {                                                                                        \
+        if (self->stale)                                                                        \
+            goto bail;                                                                          \
+        if (--fuel < 0)                                                                         \
+            goto budget;                                                                        \
+        AS32_PROFILE_DECODED(src, ip);                                                          \
+        AS32_TRACE_DECODED(self, ip);                                                           \
+        goto *(own ? ip->handler : labels[ip->kind]);                                           \
+    } while (0)
+#else
+#define AS32_THREADED 0
+#define AS32_NEXT() goto dispatch
+#endif
+// every exit hands the remaining fuel back to exec_t first
+#define AS32_EXIT(state)                                                                        \
+    do {                                                                                        \
+        if (exec != nullptr)                                                                    \
+            exec->fuel = fuel;                                                                  \
+        return state;                                                                           \
+    } while (0)
+#define AS32_JUMP(lv)                                                                           \
+    do {                                                                                        \
+        AS32_PROFILE_JUMP(self, ip->eip, lv);                                                   \
+        uint32_t t = ip->op2;                                                                   \
+        if (t == 0 && static_cast<uint32_t>(lv) < src->decoded_at.size())                       \
+            t = src->decoded_at[static_cast<uint32_t>(lv)];                                     \
+        if (t == 0)                                                                             \
+        {                                                                                       \
+            self->EIP = lv;                                                                     \
+            AS32_EXIT(self->run(exec));                                                         \
+        }                                                                                       \
+        ip = &src->decoded[t - 1];                                                              \
+    } while (0)
+// compare and branch superinstruction, see l_BINARY_JZ
+#define AS32_BINARY_BRANCH(taken)                                                               \
+    do {                                                                                        \
+        int64_t v = ip->binary(self, ip->op1, ip->op2);                                         \
+        if (v == binary_fault)                                                                  \
+            goto fault;                                                                         \
+        ++ip;                                                                                   \
+        if (self->stale)                                                                        \
+            goto bail;                                                                          \
+        if (--fuel < 0)                                                                         \
+            goto budget;                                                                        \
+        AS32_PROFILE_DECODED(src, ip);                                                          \
+        AS32_TRACE_DECODED(self, ip);                                                           \
+        if (taken)                                                                              \
+        {                                                                                       \
+            AS32_PROFILE_JUMP(self, ip->eip, ip->op1);                                          \
+            ip = &src->decoded[ip->op2 - 1];                                                    \
+        }                                                                                       \
+        else                                                                                    \
+            ++ip;                                                                               \
+        AS32_NEXT();                                                                            \
+    } while (0)
+    template <bool proven, bool tracked>
+    inline state_t func_t::run_decoded(exec_t *exec, uint32_t start, const void *const **table)
+    {
+#if AS32_THREADED
+        static const void *const labels[insn_t::KIND_COUNT] = {
+            &&l_FAULT, &&l_MOV, &&l_MOVE, &&l_XCHG, &&l_INC, &&l_DEC, &&l_NEG,
+            &&l_BINARY, &&l_BINARY, &&l_BINARY, &&l_BINARY, &&l_BINARY, &&l_BINARY,
+            &&l_BINARY, &&l_BINARY, &&l_BINARY, &&l_BINARY, &&l_BINARY, &&l_NOT,
+            &&l_PUSH, &&l_POP, &&l_JMP, &&l_JZ, &&l_JNZ, &&l_CALL, &&l_CALLEXT, &&l_RET, &&l_NOP, &&l_YIELD,
+            &&l_ALLOC, &&l_FREE, &&l_GOTO, &&l_BINARY_JZ, &&l_BINARY_JNZ, &&l_PUSH_RUN };
+        if (table != nullptr)
+        {
+            *table = labels;
+            return state_t::RET;
+        }
+#else
+        if (table != nullptr)
+        {
+            *table = nullptr;
+            return state_t::RET;
+        }
+#endif
+        int64_t fuel = exec != nullptr ? exec->fuel : INT64_MAX;
+        func_t *self = this;    // frame mode switches activations inside this loop
+        const func_t *src = &code();
+        const insn_t *ip = &src->decoded[start];
+        bool own = tracked == false && (src->verified != nullptr) == proven; // the handlers in decoded are ours
+        AS32_TRACE_LOCAL();
+#if AS32_THREADED
+        AS32_NEXT();
+#else
+    dispatch:
+        if (self->stale)
+            goto bail;
+        if (--fuel < 0)
+            goto budget;
+        AS32_PROFILE_DECODED(src, ip);
+        AS32_TRACE_DECODED(self, ip);
+        switch (ip->kind)
+        {
+        case insn_t::FAULT: goto l_FAULT;
+        case insn_t::MOV: goto l_MOV;
+        case insn_t::MOVE: goto l_MOVE;
+        case insn_t::XCHG: goto l_XCHG;
+        case insn_t::INC: goto l_INC;
+        case insn_t::DEC: goto l_DEC;
+        case insn_t::NEG: goto l_NEG;
+        case insn_t::ADD: case insn_t::SUB: case insn_t::MUL: case insn_t::DIV:
+        case insn_t::AND: case insn_t::OR: case insn_t::XOR: case insn_t::SHL:
+        case insn_t::CMP: case insn_t::CMPG: case insn_t::CMPGE:
+            goto l_BINARY;
+        case insn_t::NOT: goto l_NOT;
+        case insn_t::PUSH: goto l_PUSH;
+        case insn_t::POP: goto l_POP;
+        case insn_t::JMP: goto l_JMP;
+        case insn_t::JZ: goto l_JZ;
+        case insn_t::JNZ: goto l_JNZ;
+        case insn_t::CALL: goto l_CALL;
+        case insn_t::CALLEXT: goto l_CALLEXT;
+        case insn_t::RET: goto l_RET;
+        case insn_t::NOP: goto l_NOP;
+        case insn_t::YIELD: goto l_YIELD;
+        case insn_t::ALLOC: goto l_ALLOC;
+        case insn_t::FREE: goto l_FREE;
+        case insn_t::GOTO: goto l_GOTO;
+        default: goto l_FAULT;
+        }
+#endif
+    l_MOV:
+    {
+        int32_t *rv;
+        int32_t lv;
+        if (!(self->addressing_w<proven, tracked>(ip->oprandT1, ip->op1, rv) && self->addressing_r<proven>(ip->oprandT2, ip->op2, lv)))
+            goto fault;
+        *rv = lv;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_MOVE:
+    {
+        int32_t lv;
+        if (!self->addressing_r<proven>(ip->oprandT2, ip->op1, lv))
+            goto fault;
+        self->ESP = lv;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_XCHG:
+    {
+        int32_t *rv1;
+        int32_t *rv2;
+        if (!(self->addressing_w<proven, tracked>(ip->oprandT1, ip->op1, rv1) && self->addressing_w<proven, tracked>(ip->oprandT2, ip->op2, rv2)))
+            goto fault;
+        int32_t tmp = *rv1;
+        *rv1 = *rv2;
+        *rv2 = tmp;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_INC:
+    {
+        int32_t *rv;
+        if (!self->addressing_w<proven, tracked>(ip->oprandT1, ip->op1, rv))
+            goto fault;
+        (*rv)++;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_DEC:
+    {
+        int32_t *rv;
+        if (!self->addressing_w<proven, tracked>(ip->oprandT1, ip->op1, rv))
+            goto fault;
+        (*rv)--;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_NEG:
+    {
+        int32_t *rv;
+        if (!self->addressing_w<proven, tracked>(ip->oprandT1, ip->op1, rv))
+            goto fault;
+        (*rv) *= -1;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_BINARY:
+    {
+        binary_t binary = ip->binary;
+        if (own == false)
+            binary = binary_find<proven, tracked>(binary_opcodes[ip->kind - insn_t::ADD], ip->oprandT1, ip->oprandT2);
+        if (binary(self, ip->op1, ip->op2) == binary_fault)
+            goto fault;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_NOT:
+    {
+        int32_t *espad;
+        int32_t lv;
+        if (!(self->addressing_r<proven>(ip->oprandT1, ip->op1, lv) && self->addressing_esp_w<tracked>(espad)))
+            goto fault;
+        *espad = ~lv;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_PUSH:
+    {
+        int32_t *espad;
+        int32_t lv;
+        if (!(self->addressing_r<proven>(ip->oprandT1, ip->op1, lv) && self->addressing_esp_w<tracked>(espad)))
+            goto fault;
+        *espad = lv;
+        self->ESP += 4;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_POP:
+        if (self->ESP < 4)
+            goto fault;
+        self->ESP -= 4;
+        ++ip;
+        AS32_NEXT();
+    l_JMP:
+    {
+        int32_t lv;
+        if (!self->addressing_r<proven>(ip->oprandT1, ip->op1, lv))
+            goto fault;
+        AS32_JUMP(lv);
+        AS32_NEXT();
+    }
+    l_JZ:
+    {
+        int32_t *espad;
+        int32_t lv;
+        if (!(self->addressing_r<proven>(ip->oprandT1, ip->op1, lv) && self->addressing_esp(espad)))
+            goto fault;
+        if (*espad == 0)
+            AS32_JUMP(lv);
+        else
+            ++ip;
+        AS32_NEXT();
+    }
+    l_JNZ:
+    {
+        int32_t *espad;
+        int32_t lv;
+        if (!(self->addressing_r<proven>(ip->oprandT1, ip->op1, lv) && self->addressing_esp(espad)))
+            goto fault;
+        if (*espad != 0)
+            AS32_JUMP(lv);
+        else
+            ++ip;
+        AS32_NEXT();
+    }
+    l_CALL:
+    {
+        func_t *callable;
+        elf_t *elf_callee = self->elf_local;
+        if (proven && ip->oprandT1 == oprand_t::IMM && ip->op1 >= 0)
+            callable = &self->elf_local->text[ip->op1];
+        else if (proven && ip->oprandT1 == oprand_t::IMM && (callable = self->elf_local->imports[-1 - ip->op1].bound()) != nullptr)
+            elf_callee = self->elf_local->imports[-1 - ip->op1].target();
+        else if (!self->callable_addressing(ip->oprandT1, ip->op1, callable, elf_callee))
+            goto fault;
+        self->EIP = ip->eip;
+        if (exec != nullptr)
+        {
+            if (exec->enter(callable, elf_callee, self) == false)
+                AS32_EXIT(state_t::FAULT); // out of frames
+            func_t *f = exec->frames.back().f;
+            if (f->decoded_valid<proven>() == false || f->tracking(self) != tracked)
+                AS32_EXIT(state_t::FRAME);
+            exec->frames[exec->frames.size() - 2].ip = ip + 1;
+            self = f;
+            src = &self->code();
+            own = tracked == false && (src->verified != nullptr) == proven;
+            ip = &src->decoded[0];
+            AS32_NEXT();
+        }
+        if (callable->operator()(elf_callee, self) == false)
+            AS32_EXIT(state_t::FAULT);
+        if (self->EIP != ip->eip) // re-entered, registers are not ours any more
+        {
+            self->EIP += 2 * sizeof(uint32_t);
+            AS32_EXIT(self->run(exec));
+        }
+        ++ip;
+        AS32_NEXT();
+    }
+    l_CALLEXT:
+    {
+        int32_t ind;
+        if (!self->addressing_r<proven>(ip->oprandT1, ip->op1, ind))
+            goto fault;
+        extfunc_t ext = ext_find(self->elf_local, ind);
+        AS32_TRACE_EXT(self, ip->eip, ind);
+        if (ext == nullptr)
+            goto fault;
+        self->EIP = ip->eip;
+        if (ext(self) == false)
+            AS32_EXIT(state_t::FAULT);
+        if (self->EIP != ip->eip)
+        {
+            self->EIP += 2 * sizeof(uint32_t);
+            AS32_EXIT(self->run(exec));
+        }
+        ++ip;
+        AS32_NEXT();
+    }
+    l_RET:
+        self->EIP = ip->eip;
+        if (exec != nullptr && exec->frames.size() > exec->base + 1)
+        {
+            AS32_TRACE_LEAVE(self, true);
+            exec->leave();
+            exec_t::frame_t &fr = exec->frames.back();
+            if (fr.ip == nullptr)
+            {
+                fr.f->EIP += 2 * sizeof(uint32_t);
+                AS32_EXIT(state_t::FRAME);
+            }
+            self = fr.f;    // EIP stays at the CALL, as after a recursive call
+            src = &self->code();
+            own = tracked == false && (src->verified != nullptr) == proven;
+            ip = fr.ip;
+            fr.ip = nullptr;
+            AS32_NEXT();
+        }
+        AS32_EXIT(state_t::RET);
+    l_NOP:
+        ++ip;
+        AS32_NEXT();
+    l_YIELD:
+        if (exec == nullptr)
+        {
+            ++ip;
+            AS32_NEXT();
+        }
+        self->EIP = ip->eip + sizeof(uint32_t);
+        AS32_EXIT(state_t::YIELD);
+    l_ALLOC:
+    {
+        int32_t *espad;
+        int32_t lv;
+        if (!(self->addressing_r<proven>(ip->oprandT1, ip->op1, lv) && self->elf_local != nullptr && self->addressing_esp_w<tracked>(espad)))
+            goto fault;
+        *espad = self->elf_local->heap.alloc(lv);
+        self->ESP += 4;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_FREE:
+    {
+        int32_t lv;
+        if (!(self->addressing_r<proven>(ip->oprandT1, ip->op1, lv) && self->elf_local != nullptr && self->elf_local->heap.free(lv)))
+            goto fault;
+        ++ip;
+        AS32_NEXT();
+    }
+    l_GOTO:
+        ip = &src->decoded[ip->op2 - 1];
+        ++fuel;     // not an instruction
+        AS32_NEXT();
+#if AS32_THREADED
+    // superinstructions: the first part, then the checks AS32_NEXT would make, then the second without a dispatch.
+    // only reached through the handlers, so never in the tracked loop.
+    // compare and branch: the jump tests the result the operation returned, [ESP] was just written by it and the
+    // target is a resolved IMM (see fuse)
+    l_BINARY_JZ:
+        AS32_BINARY_BRANCH(v == 0);
+    l_BINARY_JNZ:
+        AS32_BINARY_BRANCH(v != 0);
+    l_PUSH_RUN:
+        do
+        {
+            int32_t *espad;
+            int32_t lv;
+            if (!(self->addressing_r<proven>(ip->oprandT1, ip->op1, lv) && self->addressing_esp_w<tracked>(espad)))
+                goto fault;
+            *espad = lv;
+            self->ESP += 4;
+            ++ip;
+            if (self->stale)
+                goto bail;
+            if (--fuel < 0)
+                goto budget;
+            AS32_PROFILE_DECODED(src, ip);
+            AS32_TRACE_DECODED(self, ip);
+        } while (ip->handler == &&l_PUSH_RUN);
+        goto l_PUSH;
+#endif
+    l_FAULT:
+    fault:
+        self->EIP = ip->eip;
+        AS32_EXIT(state_t::FAULT);
+    bail:
+        self->EIP = ip->eip;
+        AS32_EXIT(self->run(exec));
+    budget:
+        self->EIP = ip->eip;
+        fuel = 0;
+        AS32_EXIT(state_t::BUDGET);
+    }
+#undef AS32_BINARY_BRANCH
+#undef AS32_JUMP
+#undef AS32_EXIT
+#undef AS32_NEXT
+#undef AS32_THREADED
+};
+#include "AS32_fault.h"
+#include "AS32_compact.h"
+#if AS32_PROFILE
+#include "AS32_profile.h"
+#endif
+#if AS32_TRACE
+#include "AS32_trace.h"
+#endif
\ No newline at end of file